@@ -101,6 +101,11 @@ PIDX_variable variable;
 char type_name[512];
 static PIDX_point global_bounds;
 unsigned char *data;
+static int thread_count = 1;
+static int aggregation_backend = PIDX_RMA_AGGREGATION;
+static int shm_aggregation = 0;
+static unsigned long long agg_memory_limit = 0;
+static int io_backend = PIDX_MPI_IO_BACKEND;
 
 static char *usage = "Serial Usage: ./idx_read -g 32x32x32 -l 32x32x32 -v 0 -f input_idx_file_name\n"
                      "Parallel Usage: mpirun -n 8 ./idx_read -g 32x32x32 -l 16x16x16 -f -v 0 input_idx_file_name\n"
@@ -108,7 +113,12 @@ static char *usage = "Serial Usage: ./idx_read -g 32x32x32 -l 32x32x32 -v 0 -f i
                      "  -l: local (per-process) dimensions\n"
                      "  -f: IDX input filename\n"
                      "  -t: time step index to read\n"
-                     "  -v: variable index to read";
+                     "  -v: variable index to read\n"
+                     "  -T: number of threads used for HZ decoding (per process)\n"
+                     "  -a: aggregation backend (0 one sided RMA, 1 alltoall, 2 point to point)\n"
+                     "  -S: combine the samples of a node in shared memory before aggregation\n"
+                     "  -M: memory limit (bytes) of the aggregation buffers of a process (0 no limit)\n"
+                     "  -B: file io backend (0 MPI-IO, 1 POSIX, 2 POSIX with O_DIRECT, 3 mmap)";
 
 static void parse_args(int argc, char **argv);
 static void set_pidx_variable_and_create_buffer();
@@ -162,7 +172,7 @@ int main(int argc, char **argv)
 
 static void parse_args(int argc, char **argv)
 {
-  char flags[] = "g:l:f:t:v:";
+  char flags[] = "g:l:f:t:v:T:a:SM:B:";
   int one_opt = 0;
   char input_file_template[512];
 
@@ -199,6 +209,30 @@ static void parse_args(int argc, char **argv)
         terminate_with_error_msg("Invalid variable file\n%s", usage);
       break;
 
+    case('T'): // number of threads
+      if ((sscanf(optarg, "%d", &thread_count) == EOF) || thread_count < 1)
+        terminate_with_error_msg("Invalid number of threads\n%s", usage);
+      break;
+
+    case('a'): // aggregation backend
+      if ((sscanf(optarg, "%d", &aggregation_backend) == EOF) || aggregation_backend < PIDX_RMA_AGGREGATION || aggregation_backend > PIDX_P2P_AGGREGATION)
+        terminate_with_error_msg("Invalid aggregation backend\n%s", usage);
+      break;
+
+    case('S'): // shared memory pre-aggregation
+      shm_aggregation = 1;
+      break;
+
+    case('M'): // aggregation memory limit
+      if (sscanf(optarg, "%llu", &agg_memory_limit) == EOF)
+        terminate_with_error_msg("Invalid aggregation memory limit\n%s", usage);
+      break;
+
+    case('B'): // file io backend
+      if ((sscanf(optarg, "%d", &io_backend) == EOF) || io_backend < PIDX_MPI_IO_BACKEND || io_backend > PIDX_MMAP_IO_BACKEND)
+        terminate_with_error_msg("Invalid io backend\n%s", usage);
+      break;
+
     default:
       terminate_with_error_msg("Wrong arguments\n%s", usage);
     }
@@ -265,6 +299,14 @@ static void set_pidx_file(int ts)
 
   // Set the current timestep
   PIDX_set_current_time_step(file, ts);
+  // Number of threads used for HZ decoding
+  PIDX_set_thread_count(file, thread_count);
+
+  // How the aggregators hand the data back
+  PIDX_set_aggregation_backend(file, aggregation_backend);
+  PIDX_set_shared_memory_aggregation(file, shm_aggregation);
+  PIDX_set_aggregation_memory_limit(file, agg_memory_limit);
+  PIDX_set_io_backend(file, io_backend);
   // Get the total number of variables
   PIDX_get_variable_count(file, &variable_count);
 }
@@ -99,6 +99,17 @@ char output_file_template[512];
 char var_list[512];
 char output_file_name[512];
 unsigned char **data;
+int thread_count = 1;
+int aggregation_backend = PIDX_RMA_AGGREGATION;
+int shm_aggregation = 0;
+int aggregators_per_node = 0;
+int print_aggregator_map = 0;
+unsigned long long agg_memory_limit = 0;
+int io_backend = PIDX_MPI_IO_BACKEND;
+int async_flush = 0;
+int collective_io = 0;
+MPI_Info io_hints = MPI_INFO_NULL;
+char staging_directory[512] = "";
 
 char *usage = "Serial Usage: ./idx_write -g 32x32x32 -l 32x32x32 -v 2 -t 4 -f output_idx_file_name\n"
                      "Parallel Usage: mpirun -n 8 ./idx_write -g 64x64x64 -l 32x32x32 -v 2 -t 4 -f output_idx_file_name\n"
@@ -107,7 +118,18 @@ char *usage = "Serial Usage: ./idx_write -g 32x32x32 -l 32x32x32 -v 2 -t 4 -f ou
                      "  -r: restructured box dimension\n"
                      "  -f: file name template (without .idx)\n"
                      "  -t: number of timesteps\n"
-                     "  -v: number of variables (or file containing a list of variables)\n";
+                     "  -v: number of variables (or file containing a list of variables)\n"
+                     "  -T: number of threads used for HZ encoding (per process)\n"
+                     "  -a: aggregation backend (0 one sided RMA, 1 alltoall, 2 point to point)\n"
+                     "  -N: maximum number of aggregators per node (0 no limit)\n"
+                     "  -m: print the aggregator map of every timestep\n"
+                     "  -S: combine the samples of a node in shared memory before aggregation\n"
+                     "  -M: memory limit (bytes) of the aggregation buffers of a process (0 no limit)\n"
+                     "  -w: write in the background (PIDX_flush_async), a timestep drains while the next one is set up\n"
+                     "  -c: the aggregators of a file write it with collective MPI-IO\n"
+                     "  -H: MPI-IO hint key=value used when opening the files (can be repeated)\n"
+                     "  -B: file io backend (0 MPI-IO, 1 POSIX, 2 POSIX with O_DIRECT)\n"
+                     "  -D: node local staging directory, the files are drained to the output by PIDX_close_access\n";
 
 static int generate_vars();
 static void parse_args(int argc, char **argv);
@@ -116,6 +138,7 @@ static void create_synthetic_simulation_data();
 static void set_pidx_variable(int var);
 static void set_pidx_file(int ts);
 static void destroy_synthetic_simulation_data();
+static void print_agg_map(int ts);
 
 int main(int argc, char **argv)
 {
@@ -140,6 +163,11 @@ int main(int argc, char **argv)
 
   // Create variables
   create_pidx_point_and_access();
+  if (io_hints != MPI_INFO_NULL)
+  {
+    PIDX_set_mpi_info(p_access, io_hints);
+    MPI_Info_free(&io_hints);
+  }
   variable = (PIDX_variable*)malloc(sizeof(*variable) * variable_count);
   memset(variable, 0, sizeof(*variable) * variable_count);
 
@@ -152,12 +180,24 @@ int main(int argc, char **argv)
     for (var = 0; var < variable_count; var++)
       set_pidx_variable(var);
 
-    // PIDX_close triggers the actual write on the disk
+    // PIDX_flush (or PIDX_close) triggers the actual write on the disk
     // of the variables that we just set
+    if (async_flush == 1)
+    {
+      // the writes left pending here are completed by the next timestep or by PIDX_close_access
+      PIDX_flush_async(file);
+      if (print_aggregator_map == 1)
+        print_agg_map(ts);
+    }
+    else if (print_aggregator_map == 1)
+    {
+      PIDX_flush(file);
+      print_agg_map(ts);
+    }
     PIDX_close(file);
   }
 
-  // Close access and free memory
+  // Close access (completes the pending writes) and free memory
   if (PIDX_close_access(p_access) != PIDX_success)
     terminate_with_error_msg("PIDX_close_access");
 
@@ -178,7 +218,7 @@ int main(int argc, char **argv)
 //----------------------------------------------------------------
 static void parse_args(int argc, char **argv)
 {
-  char flags[] = "g:l:f:t:v:";
+  char flags[] = "g:l:f:t:v:T:a:N:mSM:wcH:B:D:";
   int one_opt = 0;
 
   while ((one_opt = getopt(argc, argv, flags)) != EOF)
@@ -221,6 +261,64 @@ static void parse_args(int argc, char **argv)
       }
       break;
 
+    case('T'): // number of threads
+      if ((sscanf(optarg, "%d", &thread_count) == EOF) || thread_count < 1)
+        terminate_with_error_msg("Invalid number of threads\n%s", usage);
+      break;
+
+    case('a'): // aggregation backend
+      if ((sscanf(optarg, "%d", &aggregation_backend) == EOF) || aggregation_backend < PIDX_RMA_AGGREGATION || aggregation_backend > PIDX_P2P_AGGREGATION)
+        terminate_with_error_msg("Invalid aggregation backend\n%s", usage);
+      break;
+
+    case('S'): // shared memory pre-aggregation
+      shm_aggregation = 1;
+      break;
+
+    case('M'): // aggregation memory limit
+      if (sscanf(optarg, "%llu", &agg_memory_limit) == EOF)
+        terminate_with_error_msg("Invalid aggregation memory limit\n%s", usage);
+      break;
+
+    case('B'): // file io backend
+      if ((sscanf(optarg, "%d", &io_backend) == EOF) || io_backend < PIDX_MPI_IO_BACKEND || io_backend > PIDX_DIRECT_IO_BACKEND)
+        terminate_with_error_msg("Invalid io backend\n%s", usage);
+      break;
+
+    case('D'): // staging directory
+      if (sprintf(staging_directory, "%s", optarg) < 0)
+        terminate_with_error_msg("Invalid staging directory\n%s", usage);
+      break;
+
+    case('N'): // aggregators per node
+      if ((sscanf(optarg, "%d", &aggregators_per_node) == EOF) || aggregators_per_node < 0)
+        terminate_with_error_msg("Invalid number of aggregators per node\n%s", usage);
+      break;
+
+    case('m'): // print the aggregator map
+      print_aggregator_map = 1;
+      break;
+
+    case('w'): // non-blocking flush
+      async_flush = 1;
+      break;
+
+    case('c'): // collective writes
+      collective_io = 1;
+      break;
+
+    case('H'): // MPI-IO hint
+    {
+      char *value = strchr(optarg, '=');
+      if (value == NULL)
+        terminate_with_error_msg("Invalid MPI-IO hint\n%s", usage);
+      *value = '\0';
+      if (io_hints == MPI_INFO_NULL)
+        MPI_Info_create(&io_hints);
+      MPI_Info_set(io_hints, optarg, value + 1);
+      break;
+    }
+
     default:
       terminate_with_error_msg("Wrong arguments\n%s", usage);
     }
@@ -454,6 +552,18 @@ static void set_pidx_file(int ts)
   // Advanced settings
   PIDX_set_meta_data_cache(file, cache);
 
+  // Number of threads used for HZ encoding
+  PIDX_set_thread_count(file, thread_count);
+
+  // How the HZ encoded data is moved to the aggregators
+  PIDX_set_aggregation_backend(file, aggregation_backend);
+  PIDX_set_shared_memory_aggregation(file, shm_aggregation);
+  PIDX_set_aggregators_per_node(file, aggregators_per_node);
+  PIDX_set_aggregation_memory_limit(file, agg_memory_limit);
+  PIDX_set_io_backend(file, io_backend);
+  PIDX_set_collective_io(file, collective_io);
+  PIDX_set_staging_directory(file, staging_directory);
+
   // Select I/O mode (PIDX_IDX_IO for the multires, PIDX_RAW_IO for non-multires)
   PIDX_set_io_mode(file, PIDX_IDX_IO);
 
@@ -481,3 +591,23 @@ static void destroy_synthetic_simulation_data()
   free(data);
   data = 0;
 }
+
+static void print_agg_map(int ts)
+{
+  // only the processes taking part in the aggregation know the map, print it from the lowest of them
+  int aggregator_count = 0;
+  PIDX_get_aggregator_count(file, &aggregator_count);
+
+  int printer = (aggregator_count > 0) ? rank : process_count;
+  MPI_Allreduce(MPI_IN_PLACE, &printer, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (rank != printer)
+    return;
+
+  int a = 0;
+  for (a = 0; a < aggregator_count; a++)
+  {
+    int file_number, variable_index, aggregator_rank, node;
+    PIDX_get_aggregator(file, a, &file_number, &variable_index, &aggregator_rank, &node);
+    fprintf(stderr, "[T %d] file %d variable %d -> rank %d node %d\n", ts, file_number, variable_index, aggregator_rank, node);
+  }
+}
@@ -169,6 +169,36 @@ PIDX_return_code PIDX_query_box(PIDX_file file, PIDX_point box_dims);
 
 
 
+/*
+ * Implementation in PIDX_block_view.c
+ */
+///
+/// \brief PIDX_get_block_view Points data to the block block_number (in HZ order, samples_per_block samples each) of
+/// the variable in the binary file of the current time step, without copying it. The file stays mapped until the view
+/// is given back with PIDX_release_block_view, and at most until the next write or PIDX_close. The values are as
+/// stored (byte order of the dataset, compressed if the dataset is) and size is the stored size (it varies from block
+/// to block with the variable size ZFP modes). A block that was not written has size 0 and data NULL. Needs an IDX dataset read with the PIDX_MMAP_IO_BACKEND (see PIDX_set_io_backend).
+/// \param file
+/// \param variable_index
+/// \param block_number
+/// \param data
+/// \param size
+/// \return
+///
+PIDX_return_code PIDX_get_block_view(PIDX_file file, int variable_index, int block_number, const unsigned char** data, uint64_t* size);
+
+
+
+///
+/// \brief PIDX_release_block_view
+/// \param file
+/// \param data
+/// \return
+///
+PIDX_return_code PIDX_release_block_view(PIDX_file file, const unsigned char* data);
+
+
+
 /*
  * Implementation in PIDX_close.c
  */
@@ -181,6 +211,59 @@ PIDX_return_code PIDX_flush(PIDX_file file);
 
 
 
+///
+/// \brief PIDX_flush_async Same as PIDX_flush, but returns as soon as the data is in the aggregation buffers, the
+/// writes of the binary files complete in the background. They are kept in the access of the file (they outlive
+/// PIDX_close) and are completed by PIDX_wait, PIDX_test or PIDX_close_access. At most two sets of aggregation buffers
+/// exist at a time, the writes of the previous set are completed before the next set is written. Only the IDX and
+/// the local partition IDX io modes write in the background, the others and reading behave like PIDX_flush.
+/// \param file
+/// \return
+///
+PIDX_return_code PIDX_flush_async(PIDX_file file);
+
+
+
+///
+/// \brief PIDX_wait Completes all the writes started by PIDX_flush_async on files of the access
+/// \param access
+/// \return
+///
+PIDX_return_code PIDX_wait(PIDX_access access);
+
+
+
+///
+/// \brief PIDX_test Completes the writes started by PIDX_flush_async that are done, without blocking
+/// \param access
+/// \param flag set to 1 when no write is left, 0 otherwise
+/// \return
+///
+PIDX_return_code PIDX_test(PIDX_access access, int* flag);
+
+
+
+///
+/// \brief PIDX_drain_wait Completes the copies of the staged binary files of the access to the dataset (see
+/// PIDX_set_staging_directory) and removes the staged files. Readers of the dataset must wait for it.
+/// \param access
+/// \return
+///
+PIDX_return_code PIDX_drain_wait(PIDX_access access);
+
+
+
+///
+/// \brief PIDX_drain_resume Completes the drains recorded in the manifests of a staging directory that did not finish
+/// (the writers crashed or stopped before PIDX_drain_wait), call it from one process of the node while no writer uses
+/// the directory. A process that starts a drain also resumes its own manifest first.
+/// \param staging_directory
+/// \return
+///
+PIDX_return_code PIDX_drain_resume(const char* staging_directory);
+
+
+
 ///
 /// \brief PIDX_close Calls PIDX_flush and perform all the necessary cleanups
 /// \param file
@@ -469,6 +552,47 @@ PIDX_return_code PIDX_get_compression_type(PIDX_file file, int *compression_type
 
 
 
+///
+/// \brief PIDX_set_zfp_accuracy sets the absolute error tolerance of PIDX_CHUNKING_ZFP_ACCURACY (floating point
+/// variables only)
+/// \param file
+/// \param accuracy
+/// \return
+///
+PIDX_return_code PIDX_set_zfp_accuracy(PIDX_file file, double accuracy);
+
+
+
+///
+/// \brief PIDX_get_zfp_accuracy
+/// \param file
+/// \param accuracy
+/// \return
+///
+PIDX_return_code PIDX_get_zfp_accuracy(PIDX_file file, double* accuracy);
+
+
+
+///
+/// \brief PIDX_set_zfp_precision sets the number of bit planes (1 to 64) kept by PIDX_CHUNKING_ZFP_PRECISION
+/// \param file
+/// \param precision
+/// \return
+///
+PIDX_return_code PIDX_set_zfp_precision(PIDX_file file, int precision);
+
+
+
+///
+/// \brief PIDX_get_zfp_precision
+/// \param file
+/// \param precision
+/// \return
+///
+PIDX_return_code PIDX_get_zfp_precision(PIDX_file file, int* precision);
+
+
+
 ///
 /// \brief PIDX_set_lossy_compression_bit_rate
 /// \param file
@@ -620,6 +744,279 @@ PIDX_return_code PIDX_get_cache_time_step(PIDX_file file, int* ts);
 
 
 
+///
+/// \brief PIDX_set_thread_count Sets the number of threads used (per process) for HZ encoding and decoding
+/// Has no effect if PIDX is built without OpenMP (PIDX_OPTION_OPENMP)
+/// \param file
+/// \param thread_count Number of threads (default 1)
+/// \return
+///
+PIDX_return_code PIDX_set_thread_count(PIDX_file file, int thread_count);
+
+
+
+///
+/// \brief PIDX_get_thread_count
+/// \param file
+/// \param thread_count
+/// \return
+///
+PIDX_return_code PIDX_get_thread_count(PIDX_file file, int* thread_count);
+
+
+
+///
+/// \brief PIDX_set_fused_restructure Enables (default) or disables the fused restructuring and HZ encoding of uncompressed
+/// writes, the restructured patches are then HZ encoded directly which avoids two full in memory copies of every variable
+/// \param file
+/// \param fused_restructure 1 to enable, 0 to disable
+/// \return
+///
+PIDX_return_code PIDX_set_fused_restructure(PIDX_file file, int fused_restructure);
+
+
+
+///
+/// \brief PIDX_get_fused_restructure
+/// \param file
+/// \param fused_restructure
+/// \return
+///
+PIDX_return_code PIDX_get_fused_restructure(PIDX_file file, int* fused_restructure);
+
+
+
+///
+/// \brief PIDX_set_aggregation_backend Selects how the HZ encoded data is moved to the aggregators
+/// \param file
+/// \param backend PIDX_RMA_AGGREGATION (default, one sided), PIDX_ALLTOALL_AGGREGATION (collective two sided) or
+/// PIDX_P2P_AGGREGATION (sparse point to point)
+/// \return
+///
+PIDX_return_code PIDX_set_aggregation_backend(PIDX_file file, int backend);
+
+
+
+///
+/// \brief PIDX_get_aggregation_backend
+/// \param file
+/// \param backend
+/// \return
+///
+PIDX_return_code PIDX_get_aggregation_backend(PIDX_file file, int* backend);
+
+
+
+///
+/// \brief PIDX_set_aggregators_per_node Limits the number of aggregators placed on one node (shared memory domain),
+/// the aggregators are always spread across the nodes first, the limit is ignored when the nodes can not hold all the
+/// aggregators. Setting PIDX_RANKS_PER_NODE=n in the environment treats every n consecutive ranks as a node.
+/// \param file
+/// \param aggregators_per_node 0 (default) for no limit
+/// \return
+///
+PIDX_return_code PIDX_set_aggregators_per_node(PIDX_file file, int aggregators_per_node);
+
+
+
+///
+/// \brief PIDX_get_aggregators_per_node
+/// \param file
+/// \param aggregators_per_node
+/// \return
+///
+PIDX_return_code PIDX_get_aggregators_per_node(PIDX_file file, int* aggregators_per_node);
+
+
+
+///
+/// \brief PIDX_set_shared_memory_aggregation Enables a shared memory stage before the aggregation, the processes of a
+/// node stage their HZ samples in an MPI-3 shared memory window and only the first process of every node sends them to
+/// (receives them from) the aggregators. Applies to PIDX_RMA_AGGREGATION only, the nodes are the ones of
+/// PIDX_set_aggregators_per_node (PIDX_RANKS_PER_NODE must not group processes that do not share memory).
+/// \param file
+/// \param shm_aggregation 1 to enable, 0 (default) to disable
+/// \return
+///
+PIDX_return_code PIDX_set_shared_memory_aggregation(PIDX_file file, int shm_aggregation);
+
+
+
+///
+/// \brief PIDX_get_shared_memory_aggregation
+/// \param file
+/// \param shm_aggregation
+/// \return
+///
+PIDX_return_code PIDX_get_shared_memory_aggregation(PIDX_file file, int* shm_aggregation);
+
+
+
+///
+/// \brief PIDX_set_aggregation_memory_limit Bounds the memory of the aggregation buffers held by one process at once,
+/// when the buffers of a file do not fit the file is aggregated and written (read) in rounds of consecutive blocks, every
+/// round still writes one contiguous region per variable. A round holds at least one block.
+/// \param file
+/// \param agg_memory_limit bytes, 0 (default) for no limit
+/// \return
+///
+PIDX_return_code PIDX_set_aggregation_memory_limit(PIDX_file file, unsigned long long agg_memory_limit);
+
+
+
+///
+/// \brief PIDX_get_aggregation_memory_limit
+/// \param file
+/// \param agg_memory_limit
+/// \return
+///
+PIDX_return_code PIDX_get_aggregation_memory_limit(PIDX_file file, unsigned long long* agg_memory_limit);
+
+
+
+///
+/// \brief PIDX_set_collective_io The aggregators writing to the same binary file open it together and write their
+/// buffers with MPI_File_write_at_all through a file view, so that the MPI-IO hints of the access (PIDX_set_mpi_info,
+/// e.g. cb_nodes or romio_cb_write) take effect. These writes are blocking, also for PIDX_flush_async.
+/// \param file
+/// \param collective_io 1 to enable, 0 (default) for independent writes
+/// \return
+///
+PIDX_return_code PIDX_set_collective_io(PIDX_file file, int collective_io);
+
+
+
+///
+/// \brief PIDX_get_collective_io
+/// \param file
+/// \param collective_io
+/// \return
+///
+PIDX_return_code PIDX_get_collective_io(PIDX_file file, int* collective_io);
+
+
+
+///
+/// \brief PIDX_set_io_backend Selects how the aggregators read and write the binary files: PIDX_MPI_IO_BACKEND
+/// (default), PIDX_POSIX_IO_BACKEND (pread/pwrite), PIDX_DIRECT_IO_BACKEND (pread/pwrite with O_DIRECT, bypassing
+/// the page cache) or PIDX_MMAP_IO_BACKEND (reads from the mapped files, default of PIDX_serial_file_open, needed by
+/// PIDX_get_block_view). The collective and the background (PIDX_flush_async) writes always use MPI-IO.
+/// \param file
+/// \param io_backend
+/// \return
+///
+PIDX_return_code PIDX_set_io_backend(PIDX_file file, int io_backend);
+
+
+
+///
+/// \brief PIDX_get_io_backend
+/// \param file
+/// \param io_backend
+/// \return
+///
+PIDX_return_code PIDX_get_io_backend(PIDX_file file, int* io_backend);
+
+
+
+///
+/// \brief PIDX_set_read_access_pattern Tells the system how the binary files will be read (madvise or posix_fadvise of
+/// the PIDX_MMAP_IO_BACKEND and PIDX_POSIX_IO_BACKEND files): PIDX_READ_ACCESS_NORMAL (default),
+/// PIDX_READ_ACCESS_SEQUENTIAL (full resolution reads, scans of all the blocks) or PIDX_READ_ACCESS_RANDOM (small box
+/// and block queries, no read ahead)
+/// \param file
+/// \param read_access_pattern
+/// \return
+///
+PIDX_return_code PIDX_set_read_access_pattern(PIDX_file file, int read_access_pattern);
+
+
+
+///
+/// \brief PIDX_get_read_access_pattern
+/// \param file
+/// \param read_access_pattern
+/// \return
+///
+PIDX_return_code PIDX_get_read_access_pattern(PIDX_file file, int* read_access_pattern);
+
+
+
+///
+/// \brief PIDX_set_file_cache_limits Sets how many binary files a reader keeps open and how many binary file headers
+/// it keeps (at least as many as open files), least recently used first out. Defaults are PIDX_FILE_CACHE_OPEN_LIMIT
+/// and PIDX_FILE_CACHE_HEADER_LIMIT, the files are closed by PIDX_close.
+/// \param file
+/// \param open_file_limit
+/// \param header_limit
+/// \return
+///
+PIDX_return_code PIDX_set_file_cache_limits(PIDX_file file, int open_file_limit, int header_limit);
+
+
+
+///
+/// \brief PIDX_get_file_cache_limits
+/// \param file
+/// \param open_file_limit
+/// \param header_limit
+/// \return
+///
+PIDX_return_code PIDX_get_file_cache_limits(PIDX_file file, int* open_file_limit, int* header_limit);
+
+
+
+///
+/// \brief PIDX_set_staging_directory Writes the binary files of the flushes to a node local directory (e.g. on NVMe),
+/// in a directory of each process named after its rank, and returns. A thread of each process then copies the pieces it
+/// wrote to the binary files of the dataset in the background, recording them in a manifest in the directory so that a
+/// drain that did not finish can be completed with PIDX_drain_resume. The data is in the dataset only after
+/// PIDX_drain_wait or PIDX_close_access, the .idx file is written to the dataset directly. The staged files of a file
+/// are removed as soon as they are copied once it is closed (PIDX_close). The binary files are written with blocking independent IO (no collective IO, PIDX_flush_async behaves like PIDX_flush). NULL or an empty
+/// string (the default) writes the dataset directly.
+/// \param file
+/// \param staging_directory
+/// \return
+///
+PIDX_return_code PIDX_set_staging_directory(PIDX_file file, const char* staging_directory);
+
+
+
+///
+/// \brief PIDX_get_staging_directory
+/// \param file
+/// \param staging_directory at least PIDX_FILE_PATH_LENGTH characters
+/// \return
+///
+PIDX_return_code PIDX_get_staging_directory(PIDX_file file, char* staging_directory);
+
+
+
+///
+/// \brief PIDX_get_aggregator_count Number of aggregators of the last flush known to this process, only the processes
+/// that take part in the aggregation know the aggregator map
+/// \param file
+/// \param aggregator_count
+/// \return
+///
+PIDX_return_code PIDX_get_aggregator_count(PIDX_file file, int* aggregator_count);
+
+
+
+///
+/// \brief PIDX_get_aggregator Gets one entry of the aggregator map of the last flush
+/// \param file
+/// \param aggregator_index 0 to aggregator_count - 1
+/// \param file_number index of the file (of the time step) aggregated
+/// \param variable_index variable aggregated
+/// \param rank rank of the aggregator in the communicator of the file
+/// \param node node of the aggregator, nodes are numbered in the order of their lowest rank
+/// \return
+///
+PIDX_return_code PIDX_get_aggregator(PIDX_file file, int aggregator_index, int* file_number, int* variable_index, int* rank, int* node);
+
+
+
 #if 0
 ///
 /// \brief PIDX_set_process_decomposition
@@ -868,7 +1265,8 @@ PIDX_return_code PIDX_write_variable(PIDX_file file, PIDX_variable variable, PID
  * Implementation in PIDX_meta_data.c
  */
 ///
-/// \brief PIDX_set_meta_data_cache
+/// \brief PIDX_set_meta_data_cache Caches the HZ addressing metadata of the patches of this file in cache
+/// The same cache can be set on several files (and time steps), patches with the same geometry then skip the address computation
 /// \param file
 /// \param cache
 /// \return
@@ -0,0 +1,123 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#include "PIDX_file_handler.h"
+
+
+// binary file of the current time step that holds block_number
+static PIDX_return_code block_file_name(PIDX_file file, int block_number, char* file_name)
+{
+  char filename_template[PIDX_FILE_PATH_LENGTH];
+  int maxh = strlen(file->idx->bitSequence);
+
+  if (generate_file_name_template(maxh, file->idx->bits_per_block, file->idx->filename, file->idx->filename_time_template, file->idx->current_time_step, filename_template) == 1)
+  {
+    fprintf(stderr, "[%s] [%d] generate_file_name_template() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_name;
+  }
+
+  if (generate_file_name(file->idx->blocks_per_file, filename_template, block_number / file->idx->blocks_per_file, file_name, PATH_MAX) == 1)
+  {
+    fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_name;
+  }
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_block_view(PIDX_file file, int variable_index, int block_number, const unsigned char** data, uint64_t* size)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (file->idx->io_type != PIDX_IDX_IO || file->idx->io_backend != PIDX_MMAP_IO_BACKEND)
+    return PIDX_err_file;
+
+  if (variable_index < 0 || variable_index >= file->idx->variable_count || block_number < 0)
+    return PIDX_err_size;
+
+  char file_name[PATH_MAX];
+  if (block_file_name(file, block_number, file_name) != PIDX_success)
+    return PIDX_err_name;
+
+  PIDX_file_io_handle fh;
+  uint32_t* headers;
+  if (PIDX_file_io_cache_get(file->idx, file->idx_c, file_name, &fh, &headers) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_cache_get() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  uint64_t data_offset = PIDX_header_block_offset(file->idx, headers, variable_index, block_number % file->idx->blocks_per_file);
+  uint64_t data_size = PIDX_header_block_size(file->idx, headers, variable_index, block_number % file->idx->blocks_per_file);
+
+  // the block was not written
+  if (data_size == 0)
+  {
+    *data = NULL;
+    *size = 0;
+    return PIDX_success;
+  }
+
+  if (PIDX_file_io_cache_view(file->idx, file->idx_c, file_name, data_offset, data_size, data) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_cache_view() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+  *size = data_size;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_release_block_view(PIDX_file file, const unsigned char* data)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (data == NULL)
+    return PIDX_success;
+
+  return PIDX_file_io_cache_release(file->idx->file_cache, data);
+}
@@ -44,10 +44,65 @@
 static void PIDX_debug_output(PIDX_file file, int svi, int evi, int io_type);
 static PIDX_return_code PIDX_dump_state_finalize (PIDX_file file);
 static int approx_maxh(PIDX_file file);
+static PIDX_return_code flush(PIDX_file file, int async_write);
 
 int pidx_global_variable = 0;
 
 PIDX_return_code PIDX_flush(PIDX_file file)
+{
+  return flush(file, 0);
+}
+
+
+
+PIDX_return_code PIDX_flush_async(PIDX_file file)
+{
+  return flush(file, 1);
+}
+
+
+
+PIDX_return_code PIDX_wait(PIDX_access access)
+{
+  if (access == NULL)
+    return PIDX_err_access;
+
+  return PIDX_file_io_pending_wait(access);
+}
+
+
+
+PIDX_return_code PIDX_test(PIDX_access access, int* flag)
+{
+  if (access == NULL)
+    return PIDX_err_access;
+
+  return PIDX_file_io_pending_test(access, flag);
+}
+
+
+
+PIDX_return_code PIDX_drain_wait(PIDX_access access)
+{
+  if (access == NULL)
+    return PIDX_err_access;
+
+  return PIDX_file_io_drain_wait(access);
+}
+
+
+
+PIDX_return_code PIDX_drain_resume(const char* staging_directory)
+{
+  if (staging_directory == NULL)
+    return PIDX_err_file;
+
+  return PIDX_file_io_drain_resume(staging_directory);
+}
+
+
+
+static PIDX_return_code flush(PIDX_file file, int async_write)
 {
   PIDX_time time = file->time;
 
@@ -58,12 +113,17 @@ PIDX_return_code PIDX_flush(PIDX_file file)
     return PIDX_err_variable;
   }
 
+  // nothing was added since the last flush (PIDX_close right after PIDX_flush)
+  if (file->local_variable_count == 0)
+    return PIDX_success;
+
   file->io = PIDX_io_init(file->idx, file->idx_c, file->idx_dbg, file->meta_data_cache, file->idx_b, file->restructured_grid, file->time, file->fs_block_size, file->variable_index_tracker);
   if (file->io == NULL)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_flush;
   }
+  file->io->async_write = async_write;
 
   // this is an approximate calculation of total number of aggregation
   // groups so that timming buffers can be populated properly
@@ -74,6 +134,9 @@ PIDX_return_code PIDX_flush(PIDX_file file)
   PIDX_init_timming_buffers1(time, file->idx->variable_count, agg_group_count);
 
 
+  // the aggregator map describes the last flush only
+  file->idx->agg_map_count = 0;
+
   // index range of variables within a flush
   int lvi = file->local_variable_index;
   int lvc = file->local_variable_count;
@@ -134,6 +197,13 @@ PIDX_return_code PIDX_close(PIDX_file file)
     return PIDX_err_io;
   }
 
+  // the staged binary files of this file are complete, they are removed as soon as they are drained
+  if (file->idx->staging_directory[0] != '\0' && PIDX_file_io_drain_seal(file->idx_c->access) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
   PIDX_time time = file->time;
   time->sim_end = PIDX_get_time();
 
@@ -152,6 +222,10 @@ PIDX_return_code PIDX_close(PIDX_file file)
 
   PIDX_dump_state_finalize(file);
 
+  PIDX_hz_index_free(file->idx->hz_index);
+  PIDX_file_io_cache_free(file->idx->file_cache);
+  free(file->idx->agg_map);
+  free(file->idx->packed_file_end);
   free(file->idx);
   free(file->restructured_grid);
   free(file->time);
@@ -229,6 +303,13 @@ static void PIDX_debug_output(PIDX_file file, int svi, int evi, int io_type)
 
   if (io_type == PIDX_IDX_IO || io_type == PIDX_LOCAL_PARTITION_IDX_IO)
   {
+#if DETAIL_OUTPUT
+    // aggregation RMA traffic summed over all the processes
+    uint64_t rma_local[3] = {time->agg_rma_segment_count, time->agg_rma_op_count, time->agg_rma_byte_count};
+    uint64_t rma_global[3] = {0, 0, 0};
+    MPI_Allreduce(rma_local, rma_global, 3, MPI_UINT64_T, MPI_SUM, file->idx_c->simulation_comm);
+#endif
+
     if (max_time == total_time)
     {
       double group_init = time->init_end - time->init_start;
@@ -412,6 +493,7 @@ static void PIDX_debug_output(PIDX_file file, int svi, int evi, int io_type)
       grp_rst_hz_chunk_agg_io = grp_rst_hz_chunk_agg_io + rst_all + hz_all + hz_io_all + chunk_all + compression_all + agg_all + io_all;
 
 #if DETAIL_OUTPUT
+      fprintf(stderr, "AGG RMA          :[pieces %llu (%.1f bytes each)] [puts %llu (%.1f bytes each)]\n", (unsigned long long)rma_global[0], rma_global[0] ? (double)rma_global[2] / rma_global[0] : 0.0, (unsigned long long)rma_global[1], rma_global[1] ? (double)rma_global[2] / rma_global[1] : 0.0);
       fprintf(stderr, "XIRPICCHHAI      :[%.4f + %.4f + %.4f + %.4f + %.4f + %.4f + %.4f + %.4f + %.4f + %.4f = %.4f] + %.4f [%.4f %.4f]\n", pre_group_total, rst_all, partition_time, post_group_total, chunk_all, compression_all, hz_all, hz_io_all, agg_all, io_all, grp_rst_hz_chunk_agg_io, (time->SX - time->sim_start), grp_rst_hz_chunk_agg_io + (time->SX - time->sim_start), max_time);
 #else
 
@@ -49,7 +49,8 @@ extern "C" {
 #define O_BINARY 0
 #endif
 
-#define PIDX_CURR_METADATA_VERSION "6.1"
+/// 6.2: the block offsets and sizes in the binary files are 64 bit (see PIDX_header_io.h)
+#define PIDX_CURR_METADATA_VERSION "6.2"
   
 #define PIDX_MAX_DIMENSIONS 3
 #define MULTI_BOX 0
@@ -104,6 +105,52 @@ enum boundary_type {power_two_block = 1,
 #define PIDX_CHUNKING_ONLY 1
 #define PIDX_CHUNKING_ZFP 2
 
+// ZFP with a fixed accuracy (PIDX_set_zfp_accuracy), a fixed precision (PIDX_set_zfp_precision) or lossless. The
+// blocks of these modes have a variable size: the aggregators compress each IDX block, the blocks of a file are
+// packed one after the other and their sizes are kept in the header of the file.
+#define PIDX_CHUNKING_ZFP_ACCURACY 3
+#define PIDX_CHUNKING_ZFP_PRECISION 4
+#define PIDX_CHUNKING_ZFP_REVERSIBLE 5
+
+// Aggregation with one sided communication (MPI_Put and MPI_Get into a dynamic window)
+#define PIDX_RMA_AGGREGATION 0
+
+// Aggregation with MPI_Alltoall (counts), MPI_Alltoallv (piece descriptions) and MPI_Alltoallw (data)
+#define PIDX_ALLTOALL_AGGREGATION 1
+
+// Aggregation with point to point messages between the processes that exchange data only
+#define PIDX_P2P_AGGREGATION 2
+
+// The aggregators read and write their files with independent MPI-IO
+#define PIDX_MPI_IO_BACKEND 0
+
+// The aggregators read and write their files with pread and pwrite
+#define PIDX_POSIX_IO_BACKEND 1
+
+// Same as PIDX_POSIX_IO_BACKEND, with O_DIRECT for the transfers aligned to PIDX_DIRECT_IO_ALIGNMENT
+#define PIDX_DIRECT_IO_BACKEND 2
+
+// The readers map their files (mmap) and copy from or hand out views of the mapped pages, the writers use
+// PIDX_POSIX_IO_BACKEND
+#define PIDX_MMAP_IO_BACKEND 3
+
+// Expected access pattern of the readers (see PIDX_set_read_access_pattern)
+#define PIDX_READ_ACCESS_NORMAL 0
+#define PIDX_READ_ACCESS_SEQUENTIAL 1
+#define PIDX_READ_ACCESS_RANDOM 2
+
+// Alignment of the aggregation buffers and of the O_DIRECT transfers
+#define PIDX_DIRECT_IO_ALIGNMENT 4096
+
+// Binary files a reader keeps open by default (see PIDX_set_file_cache_limits)
+#define PIDX_FILE_CACHE_OPEN_LIMIT 64
+
+// Binary file headers a reader keeps by default
+#define PIDX_FILE_CACHE_HEADER_LIMIT 1024
+
+// Largest read the blocking reader makes of contiguous blocks (within the int count of MPI_File_read_at)
+#define PIDX_COALESCED_READ_LIMIT (1 << 30)
+
 // Data in buffer is in row order
 #define PIDX_row_major                           0
 
@@ -132,6 +179,8 @@ enum PIDX_endian_type{
 
 #define PIDX_default_bits_per_block              15
 #define PIDX_default_blocks_per_file             256
+#define PIDX_default_zfp_accuracy                1e-3
+#define PIDX_default_zfp_precision               32
 
 #define PIDX_FILE_PATH_LENGTH                    1024
 
@@ -142,6 +142,8 @@ PIDX_return_code PIDX_file_create(const char* filename, PIDX_flags flags, PIDX_a
 
   (*file)->idx_c->simulation_comm = access_type->comm;
   (*file)->idx_c->partition_comm = access_type->comm;
+  (*file)->idx_c->access = access_type;
+  (*file)->idx_c->uses_access_comm = 1;
   MPI_Comm_rank((*file)->idx_c->simulation_comm, &((*file)->idx_c->simulation_rank));
   MPI_Comm_size((*file)->idx_c->simulation_comm, &((*file)->idx_c->simulation_nprocs));
   MPI_Comm_rank((*file)->idx_c->partition_comm, &((*file)->idx_c->partition_rank));
@@ -154,6 +156,7 @@ PIDX_return_code PIDX_file_create(const char* filename, PIDX_flags flags, PIDX_a
   (*file)->idx->variable_count = -1;
 
   (*file)->idx->pidx_version = 1;
+  strncpy((*file)->idx->metadata_version, PIDX_CURR_METADATA_VERSION, 8);
 
   (*file)->idx->restructuring_factor[0] = 1;
   (*file)->idx->restructuring_factor[1] = 1;
@@ -180,9 +183,25 @@ PIDX_return_code PIDX_file_create(const char* filename, PIDX_flags flags, PIDX_a
 
   (*file)->idx->compression_factor = 1;
   (*file)->idx->compression_bit_rate = 64;
+  (*file)->idx->zfp_accuracy = PIDX_default_zfp_accuracy;
+  (*file)->idx->zfp_precision = PIDX_default_zfp_precision;
   for (i=0;i<PIDX_MAX_DIMENSIONS;i++)
     (*file)->idx->chunk_size[i] = 1;
 
+  (*file)->idx->thread_count = 1;
+  (*file)->idx->fused_restructure = 1;
+  (*file)->idx->aggregation_backend = PIDX_RMA_AGGREGATION;
+  (*file)->idx->aggregators_per_node = 0;
+  (*file)->idx->shm_aggregation = 0;
+  (*file)->idx->agg_memory_limit = 0;
+  (*file)->idx->collective_io = 0;
+  (*file)->idx->io_backend = PIDX_MPI_IO_BACKEND;
+  (*file)->idx->read_access_pattern = PIDX_READ_ACCESS_NORMAL;
+  memset((*file)->idx->staging_directory, 0, PIDX_FILE_PATH_LENGTH);
+  (*file)->idx->file_cache_open_limit = PIDX_FILE_CACHE_OPEN_LIMIT;
+  (*file)->idx->file_cache_header_limit = PIDX_FILE_CACHE_HEADER_LIMIT;
+  (*file)->idx->file_cache = NULL;
+
   (*file)->idx->particles_position_variable_index = 0;
   (*file)->idx->particle_res_base = 32;
   (*file)->idx->particle_res_factor = 2;
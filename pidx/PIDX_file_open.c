@@ -70,14 +70,16 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
   memset((*file)->time, 0, sizeof (*((*file)->time)));
   (*file)->time->sim_start = PIDX_get_time();
 
-  (*file)->meta_data_cache = malloc(sizeof (*((*file)->meta_data_cache)));
-  memset((*file)->meta_data_cache, 0, sizeof (*((*file)->meta_data_cache)));
+  // No caching unless the application sets a cache (PIDX_set_meta_data_cache)
+  (*file)->meta_data_cache = NULL;
 
   (*file)->restructured_grid = malloc(sizeof(*(*file)->restructured_grid ));
   memset((*file)->restructured_grid , 0, sizeof(*(*file)->restructured_grid));
 
   (*file)->idx_c->simulation_comm = access_type->comm;
   (*file)->idx_c->partition_comm = access_type->comm;
+  (*file)->idx_c->access = access_type;
+  (*file)->idx_c->uses_access_comm = 1;
   MPI_Comm_rank((*file)->idx_c->simulation_comm, &((*file)->idx_c->simulation_rank));
   MPI_Comm_size((*file)->idx_c->simulation_comm, &((*file)->idx_c->simulation_nprocs));
   MPI_Comm_rank((*file)->idx_c->partition_comm, &((*file)->idx_c->partition_rank));
@@ -131,10 +133,26 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
   memset((*file)->idx->bitSequence, 0, 512);
 
   (*file)->idx->compression_bit_rate = 64;
+  (*file)->idx->zfp_accuracy = PIDX_default_zfp_accuracy;
+  (*file)->idx->zfp_precision = PIDX_default_zfp_precision;
   (*file)->idx->compression_factor = 1;
   for (i=0;i<PIDX_MAX_DIMENSIONS;i++)
     (*file)->idx->chunk_size[i] = 1;
 
+  (*file)->idx->thread_count = 1;
+  (*file)->idx->fused_restructure = 1;
+  (*file)->idx->aggregation_backend = PIDX_RMA_AGGREGATION;
+  (*file)->idx->aggregators_per_node = 0;
+  (*file)->idx->shm_aggregation = 0;
+  (*file)->idx->agg_memory_limit = 0;
+  (*file)->idx->collective_io = 0;
+  (*file)->idx->io_backend = PIDX_MPI_IO_BACKEND;
+  (*file)->idx->read_access_pattern = PIDX_READ_ACCESS_NORMAL;
+  memset((*file)->idx->staging_directory, 0, PIDX_FILE_PATH_LENGTH);
+  (*file)->idx->file_cache_open_limit = PIDX_FILE_CACHE_OPEN_LIMIT;
+  (*file)->idx->file_cache_header_limit = PIDX_FILE_CACHE_HEADER_LIMIT;
+  (*file)->idx->file_cache = NULL;
+
   (*file)->idx->samples_per_block = (int)pow(2, PIDX_default_bits_per_block);
   (*file)->idx->maxh = 0;
   (*file)->idx->max_file_count = 0;
@@ -190,7 +208,7 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
   MPI_Bcast((*file)->idx->chunk_size, PIDX_MAX_DIMENSIONS, MPI_UNSIGNED_LONG_LONG, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->endian), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->pidx_version), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
-  MPI_Bcast(&((*file)->idx->metadata_version), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast((*file)->idx->metadata_version, 8, MPI_CHAR, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->blocks_per_file), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->bits_per_block), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->variable_count), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
@@ -200,6 +218,8 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
   MPI_Bcast((*file)->idx->partition_offset, PIDX_MAX_DIMENSIONS, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->compression_bit_rate), 1, MPI_FLOAT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->compression_type), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast(&((*file)->idx->zfp_accuracy), 1, MPI_DOUBLE, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast(&((*file)->idx->zfp_precision), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->io_type), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->fs_block_size), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
 
@@ -330,8 +350,8 @@ PIDX_return_code PIDX_serial_file_open(const char* filename, PIDX_flags flags, P
   memset((*file)->time, 0, sizeof (*((*file)->time)));
   (*file)->time->sim_start = 0;
   
-  (*file)->meta_data_cache = malloc(sizeof (*((*file)->meta_data_cache)));
-  memset((*file)->meta_data_cache, 0, sizeof (*((*file)->meta_data_cache)));
+  // No caching unless the application sets a cache (PIDX_set_meta_data_cache)
+  (*file)->meta_data_cache = NULL;
   
   (*file)->restructured_grid = malloc(sizeof(*(*file)->restructured_grid ));
   memset((*file)->restructured_grid , 0, sizeof(*(*file)->restructured_grid));
@@ -387,10 +407,27 @@ PIDX_return_code PIDX_serial_file_open(const char* filename, PIDX_flags flags, P
   memset((*file)->idx->bitSequence, 0, 512);
 
   (*file)->idx->compression_bit_rate = 64;
+  (*file)->idx->zfp_accuracy = PIDX_default_zfp_accuracy;
+  (*file)->idx->zfp_precision = PIDX_default_zfp_precision;
   (*file)->idx->compression_factor = 1;
   for (i=0;i<PIDX_MAX_DIMENSIONS;i++)
     (*file)->idx->chunk_size[i] = 1;
 
+  (*file)->idx->thread_count = 1;
+  (*file)->idx->fused_restructure = 1;
+  (*file)->idx->aggregation_backend = PIDX_RMA_AGGREGATION;
+  (*file)->idx->aggregators_per_node = 0;
+  (*file)->idx->shm_aggregation = 0;
+  (*file)->idx->agg_memory_limit = 0;
+  (*file)->idx->collective_io = 0;
+  // serial readers map their files
+  (*file)->idx->io_backend = PIDX_MMAP_IO_BACKEND;
+  (*file)->idx->read_access_pattern = PIDX_READ_ACCESS_NORMAL;
+  memset((*file)->idx->staging_directory, 0, PIDX_FILE_PATH_LENGTH);
+  (*file)->idx->file_cache_open_limit = PIDX_FILE_CACHE_OPEN_LIMIT;
+  (*file)->idx->file_cache_header_limit = PIDX_FILE_CACHE_HEADER_LIMIT;
+  (*file)->idx->file_cache = NULL;
+
   (*file)->idx->samples_per_block = (int)pow(2, PIDX_default_bits_per_block);
   (*file)->idx->maxh = 0;
   (*file)->idx->max_file_count = 0;
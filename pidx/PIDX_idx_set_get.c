@@ -588,14 +588,14 @@ PIDX_return_code PIDX_set_compression_type(PIDX_file file, int compression_type)
   if (!file)
     return PIDX_err_file;
 
-  if (compression_type != PIDX_NO_COMPRESSION && compression_type != PIDX_CHUNKING_ONLY && compression_type != PIDX_CHUNKING_ZFP)
+  if (compression_type != PIDX_NO_COMPRESSION && compression_type != PIDX_CHUNKING_ONLY && compression_type != PIDX_CHUNKING_ZFP && compression_type != PIDX_CHUNKING_ZFP_ACCURACY && compression_type != PIDX_CHUNKING_ZFP_PRECISION && compression_type != PIDX_CHUNKING_ZFP_REVERSIBLE)
     return PIDX_err_unsupported_compression_type;
 
   file->idx->compression_type = compression_type;
 
   if (file->idx->compression_type == PIDX_NO_COMPRESSION)
     return PIDX_success;
-  else if (file->idx->compression_type == PIDX_CHUNKING_ONLY || file->idx->compression_type == PIDX_CHUNKING_ZFP)
+  else
   {
     file->idx->chunk_size[0] = 4;
     file->idx->chunk_size[1] = 4;
@@ -634,6 +634,59 @@ PIDX_return_code PIDX_get_compression_type(PIDX_file file, int *compression_type
 }
 
 
+PIDX_return_code PIDX_set_zfp_accuracy(PIDX_file file, double accuracy)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (accuracy <= 0)
+    return PIDX_err_size;
+
+  file->idx->zfp_accuracy = accuracy;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_zfp_accuracy(PIDX_file file, double* accuracy)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  *accuracy = file->idx->zfp_accuracy;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_zfp_precision(PIDX_file file, int precision)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (precision <= 0 || precision > 64)
+    return PIDX_err_size;
+
+  file->idx->zfp_precision = precision;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_zfp_precision(PIDX_file file, int* precision)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  *precision = file->idx->zfp_precision;
+
+  return PIDX_success;
+}
+
+
 PIDX_return_code PIDX_set_average_compression_factor(PIDX_file file, int compression_factor, float bit_rate)
 {
   if (!file)
@@ -899,6 +952,338 @@ PIDX_return_code PIDX_get_cache_time_step(PIDX_file file, int* ts)
 }
 
 
+
+PIDX_return_code PIDX_set_thread_count(PIDX_file file, int thread_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (thread_count < 1)
+    return PIDX_err_size;
+
+  file->idx->thread_count = thread_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_thread_count(PIDX_file file, int* thread_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *thread_count = file->idx->thread_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_fused_restructure(PIDX_file file, int fused_restructure)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (fused_restructure != 0 && fused_restructure != 1)
+    return PIDX_err_size;
+
+  file->idx->fused_restructure = fused_restructure;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_fused_restructure(PIDX_file file, int* fused_restructure)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *fused_restructure = file->idx->fused_restructure;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_aggregation_backend(PIDX_file file, int backend)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (backend != PIDX_RMA_AGGREGATION && backend != PIDX_ALLTOALL_AGGREGATION && backend != PIDX_P2P_AGGREGATION)
+    return PIDX_err_unsupported_flags;
+
+  file->idx->aggregation_backend = backend;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_aggregation_backend(PIDX_file file, int* backend)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *backend = file->idx->aggregation_backend;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_aggregators_per_node(PIDX_file file, int aggregators_per_node)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (aggregators_per_node < 0)
+    return PIDX_err_size;
+
+  file->idx->aggregators_per_node = aggregators_per_node;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_aggregators_per_node(PIDX_file file, int* aggregators_per_node)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *aggregators_per_node = file->idx->aggregators_per_node;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_shared_memory_aggregation(PIDX_file file, int shm_aggregation)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (shm_aggregation != 0 && shm_aggregation != 1)
+    return PIDX_err_size;
+
+  file->idx->shm_aggregation = shm_aggregation;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_shared_memory_aggregation(PIDX_file file, int* shm_aggregation)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *shm_aggregation = file->idx->shm_aggregation;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_aggregation_memory_limit(PIDX_file file, unsigned long long agg_memory_limit)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  file->idx->agg_memory_limit = agg_memory_limit;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_aggregation_memory_limit(PIDX_file file, unsigned long long* agg_memory_limit)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *agg_memory_limit = file->idx->agg_memory_limit;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_collective_io(PIDX_file file, int collective_io)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (collective_io != 0 && collective_io != 1)
+    return PIDX_err_size;
+
+  file->idx->collective_io = collective_io;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_collective_io(PIDX_file file, int* collective_io)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *collective_io = file->idx->collective_io;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_io_backend(PIDX_file file, int io_backend)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (io_backend != PIDX_MPI_IO_BACKEND && io_backend != PIDX_POSIX_IO_BACKEND && io_backend != PIDX_DIRECT_IO_BACKEND && io_backend != PIDX_MMAP_IO_BACKEND)
+    return PIDX_err_size;
+
+  file->idx->io_backend = io_backend;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_io_backend(PIDX_file file, int* io_backend)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *io_backend = file->idx->io_backend;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_read_access_pattern(PIDX_file file, int read_access_pattern)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (read_access_pattern != PIDX_READ_ACCESS_NORMAL && read_access_pattern != PIDX_READ_ACCESS_SEQUENTIAL && read_access_pattern != PIDX_READ_ACCESS_RANDOM)
+    return PIDX_err_size;
+
+  file->idx->read_access_pattern = read_access_pattern;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_read_access_pattern(PIDX_file file, int* read_access_pattern)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *read_access_pattern = file->idx->read_access_pattern;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_file_cache_limits(PIDX_file file, int open_file_limit, int header_limit)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (open_file_limit < 1 || header_limit < open_file_limit)
+    return PIDX_err_size;
+
+  file->idx->file_cache_open_limit = open_file_limit;
+  file->idx->file_cache_header_limit = header_limit;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_file_cache_limits(PIDX_file file, int* open_file_limit, int* header_limit)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *open_file_limit = file->idx->file_cache_open_limit;
+  *header_limit = file->idx->file_cache_header_limit;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_staging_directory(PIDX_file file, const char* staging_directory)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (staging_directory == NULL)
+    staging_directory = "";
+
+  // the binary file templates are written below the staging directory
+  if (strlen(staging_directory) + strlen(file->idx->filename) + 2 > PIDX_FILE_PATH_LENGTH)
+    return PIDX_err_size;
+
+  memset(file->idx->staging_directory, 0, PIDX_FILE_PATH_LENGTH);
+  strcpy(file->idx->staging_directory, staging_directory);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_staging_directory(PIDX_file file, char* staging_directory)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  strcpy(staging_directory, file->idx->staging_directory);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_aggregator_count(PIDX_file file, int* aggregator_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *aggregator_count = file->idx->agg_map_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_aggregator(PIDX_file file, int aggregator_index, int* file_number, int* variable_index, int* rank, int* node)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (aggregator_index < 0 || aggregator_index >= file->idx->agg_map_count)
+    return PIDX_err_size;
+
+  int *entry = file->idx->agg_map + aggregator_index * PIDX_AGG_MAP_ENTRY_SIZE;
+  *file_number = entry[0];
+  *variable_index = entry[1];
+  *rank = entry[2];
+  *node = entry[3];
+
+  return PIDX_success;
+}
+
+
 /*
 PIDX_return_code PIDX_set_process_decomposition(PIDX_file file, int np_x, int np_y, int np_z)
 {
@@ -948,6 +1333,9 @@ PIDX_return_code PIDX_set_comm(PIDX_file file, MPI_Comm comm)
    file->idx_c->simulation_comm = comm;
    file->idx_c->partition_comm = comm;
 
+   // the aggregation window and node map of the access span the communicator of the access, not this one
+   file->idx_c->uses_access_comm = 0;
+
    MPI_Comm_rank(file->idx_c->simulation_comm, &(file->idx_c->simulation_rank));
    MPI_Comm_size(file->idx_c->simulation_comm, &(file->idx_c->simulation_nprocs));
    MPI_Comm_rank(file->idx_c->partition_comm, &(file->idx_c->partition_rank));
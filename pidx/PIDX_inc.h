@@ -88,6 +88,8 @@ extern "C" {
 #include "./utils/PIDX_error_codes.h"
 #include "./utils/PIDX_point.h"
 #include "./utils/PIDX_utils.h"
+#include "./utils/PIDX_hz_index.h"
+#include "./utils/PIDX_copy_kernel.h"
 #include "./utils/PIDX_file_name.h"
 #include "./utils/PIDX_file_access_modes.h"
 #include "./utils/PIDX_buffer.h"
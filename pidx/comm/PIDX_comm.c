@@ -47,6 +47,8 @@ PIDX_return_code PIDX_create_access(PIDX_access* access)
   memset(*access, 0, sizeof (*(*access)));
   
   (*access)->comm = MPI_COMM_NULL;
+  (*access)->agg_win = MPI_WIN_NULL;
+  (*access)->info = MPI_INFO_NULL;
   
   return PIDX_success;
 }
@@ -61,12 +63,56 @@ PIDX_return_code PIDX_set_mpi_access(PIDX_access access, MPI_Comm comm)
   return PIDX_success;
 }
 
+PIDX_return_code PIDX_set_mpi_info(PIDX_access access, MPI_Info info)
+{
+  if (access == NULL)
+    return PIDX_err_access;
+
+  if (access->info != MPI_INFO_NULL)
+    MPI_Info_free(&(access->info));
+
+  if (info == MPI_INFO_NULL)
+    access->info = MPI_INFO_NULL;
+  else if (MPI_Info_dup(info, &(access->info)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Info_dup() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_access;
+  }
+
+  return PIDX_success;
+}
+
 PIDX_return_code PIDX_close_access(PIDX_access access)
 {
   if (access == NULL)
     return PIDX_err_access;
-  
+
+  // the access is torn down completely even if a step fails, the failure is returned at the end
+  PIDX_return_code ret = PIDX_success;
+
+  if (PIDX_file_io_pending_wait(access) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_pending_wait() failed.\n", __FILE__, __LINE__);
+    ret = PIDX_err_access;
+  }
+
+  if (PIDX_file_io_drain_wait(access) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_wait() failed.\n", __FILE__, __LINE__);
+    ret = PIDX_err_access;
+  }
+
+  if (access->agg_win != MPI_WIN_NULL && MPI_Win_free(&(access->agg_win)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Win_free() failed.\n", __FILE__, __LINE__);
+    ret = PIDX_err_access;
+  }
+
+  if (access->info != MPI_INFO_NULL)
+    MPI_Info_free(&(access->info));
+
+  free(access->agg_node);
   free(access);
-  
-  return PIDX_success;
+
+  return ret;
 }
@@ -61,9 +61,31 @@ extern "C" {
 /// PIDX_access is neccessary to manage reading and writing by parallel MPI processes. It must
 /// be created using PIDX_create_access() prior to opening or creating a PIDX file using
 /// PIDX_file_create() or PIDX_file_open().
+struct PIDX_file_io_pending_struct;
+struct PIDX_file_io_drain_struct;
 struct PIDX_access_struct
 {
   MPI_Comm comm;
+
+  /// Dynamic RMA window used for aggregation by every file created (opened) with this access. It is created by the
+  /// first flush that aggregates with RMA and lives until PIDX_close_access(), so the aggregation buffers of later
+  /// variables, flushes and time steps are only attached to it.
+  MPI_Win agg_win;
+
+  /// Node of every process of comm (numbered in the order of their first rank), found by the first flush that
+  /// aggregates and kept until PIDX_close_access(), so placing the aggregators of a flush needs no communication.
+  int *agg_node;
+
+  /// Writes started by PIDX_flush_async() and not completed yet (see PIDX_file_io.h), they belong to the access so that
+  /// the next time step can be computed while they drain. Completed by PIDX_wait(), PIDX_test() or PIDX_close_access().
+  struct PIDX_file_io_pending_struct *pending_io;
+
+  /// Copies of the binary files staged by the flushes of the access to the dataset (see PIDX_set_staging_directory),
+  /// started by the first staged write and completed by PIDX_drain_wait() or PIDX_close_access().
+  struct PIDX_file_io_drain_struct *drain;
+
+  /// Hints passed to every MPI_File_open of the files of the access (MPI_INFO_NULL by default), see PIDX_set_mpi_info().
+  MPI_Info info;
 };
 typedef struct PIDX_access_struct* PIDX_access;
 
@@ -72,7 +94,9 @@ typedef struct PIDX_access_struct* PIDX_access;
 PIDX_return_code PIDX_create_access(PIDX_access* access);
 
 
-///
+/// Collective over the communicator of the access if any of its files were aggregated with RMA (the aggregation
+/// window is freed here), call it after closing all the files. Completes the writes left by PIDX_flush_async() and the
+/// drain of the staged files.
 PIDX_return_code PIDX_close_access(PIDX_access access);
 
 
@@ -80,6 +104,12 @@ PIDX_return_code PIDX_close_access(PIDX_access access);
 ///
 PIDX_return_code PIDX_set_mpi_access(PIDX_access access, MPI_Comm comm);
 
+
+
+/// MPI-IO hints (e.g. striping_factor, cb_nodes, romio_ds_write) used when opening the binary files of the access,
+/// the access keeps its own copy of info.
+PIDX_return_code PIDX_set_mpi_info(PIDX_access access, MPI_Info info);
+
 #ifdef __cplusplus
 } //extern C
 #endif
@@ -53,9 +53,27 @@
 #ifndef __PIDX_AGG_H
 #define __PIDX_AGG_H 
 
+/// All the pieces of the local HZ buffers that go to (come from) one aggregator, they are moved with a single transfer
+/// (a pair of hindexed datatypes) instead of one transfer per HZ level (or per block)
+struct PIDX_agg_target_struct
+{
+  int rank;                         ///< rank of the aggregator in partition_comm
+
+  int segment_count;                ///< number of contiguous pieces
+  int segment_capacity;
+  MPI_Aint *origin_address;         ///< absolute address of every piece in the HZ buffers
+  MPI_Aint *target_displacement;    ///< byte displacement of every piece in the aggregation buffer
+  int *length;                      ///< length in bytes of every piece
+};
+typedef struct PIDX_agg_target_struct* PIDX_agg_target;
+
+
 struct PIDX_agg_struct
 {
-  MPI_Win win;
+  MPI_Win win;                      ///< window of the access (or of this aggregation only) the buffers are attached to
+
+  MPI_Aint *window_base;            ///< address of the aggregation buffer of every process of partition_comm
+  int *window_rank;                 ///< rank of every process of partition_comm in the group of the window
 
   idx_comm idx_c;
 
@@ -67,12 +85,29 @@ struct PIDX_agg_struct
   int li;
 
   int **agg_r;
+
+  MPI_Comm node_comm;               ///< processes of partition_comm on the same node (shared memory pre-aggregation)
+  MPI_Win shm_win;                  ///< shared memory window the pieces of the node are staged in
+  unsigned char *shm_buffer;        ///< part of shm_win of this process
+  int shm_target_count;
+  PIDX_agg_target *shm_target;      ///< pieces of this process, in the order they are staged
+  int node_target_count;
+  PIDX_agg_target *node_target;     ///< node leader only: pieces of the whole node by aggregator
+
+  uint64_t rma_segment_count;       ///< contiguous pieces of HZ buffers moved (one MPI_Put or MPI_Get each without coalescing)
+  uint64_t rma_op_count;            ///< MPI_Put (MPI_Get) calls (or messages) issued, one per aggregator
+  uint64_t rma_byte_count;          ///< bytes moved by those calls
 };
 
 struct PIDX_agg_struct;
 typedef struct PIDX_agg_struct* PIDX_agg_id;
 
 
+/// ints per aggregator in the aggregator map of a file: file number, variable index, rank (in the simulation
+/// communicator) and node
+#define PIDX_AGG_MAP_ENTRY_SIZE 4
+
+
 /// Creates the Aggregation ID.
 /// \param idx_meta_data All infor regarding the idx file passed from PIDX.c
 /// \param idx_derived_ptr All derived idx related derived metadata passed from PIDX.c
@@ -90,6 +125,11 @@ PIDX_return_code PIDX_agg_meta_data_create(PIDX_agg_id agg_id, Agg_buffer agg_bu
 PIDX_return_code PIDX_agg_meta_data_destroy(PIDX_agg_id agg_id, PIDX_block_layout local_block_layout);
 
 
+/// Picks the aggregator (agg_r) of every file and variable, spreading them across the nodes of partition_comm, and
+/// records them in the aggregator map of the file
+PIDX_return_code PIDX_agg_place_aggregators(PIDX_agg_id agg_id, PIDX_block_layout local_block_layout);
+
+
 ///
 PIDX_return_code PIDX_agg_buf_create_local_uniform_dist(PIDX_agg_id id, Agg_buffer ab, PIDX_block_layout lbl);
 
@@ -98,10 +138,19 @@ PIDX_return_code PIDX_agg_buf_create_local_uniform_dist(PIDX_agg_id id, Agg_buff
 PIDX_return_code PIDX_agg_buf_destroy(Agg_buffer agg_buffer);
 
 
+/// Creates the dynamic RMA window of the access of the file (if not created yet), collective over the communicator
+/// of the access
+PIDX_return_code PIDX_agg_window_create(idx_comm idx_c);
+
+
 ///
 PIDX_return_code PIDX_agg_global_and_local(PIDX_agg_id agg_id, Agg_buffer agg_buffer, int layout_id, PIDX_block_layout local_block_layout, int PIDX_MODE);
 
 
+/// Aggregation with two sided communication (PIDX_ALLTOALL_AGGREGATION or PIDX_P2P_AGGREGATION)
+PIDX_return_code PIDX_agg_two_sided(PIDX_agg_id agg_id, Agg_buffer agg_buffer, PIDX_block_layout local_block_layout, int PIDX_MODE);
+
+
 ///
 PIDX_return_code PIDX_agg_create_global_partition_localized_aggregation_buffer(PIDX_agg_id id, Agg_buffer ab, PIDX_block_layout lbl, int agg_offset);
 
@@ -112,4 +161,37 @@ PIDX_return_code PIDX_agg_create_local_partition_localized_aggregation_buffer(PI
 ///
 PIDX_return_code PIDX_agg_finalize(PIDX_agg_id agg_id);
 
+
+/// Groups the pieces of the HZ buffers (variables fi to li) by aggregator
+/// \param target one PIDX_agg_target per aggregator this process sends to (receives from)
+/// \param target_count number of aggregators
+PIDX_return_code PIDX_agg_targets_create(PIDX_agg_id agg_id, PIDX_block_layout local_block_layout, PIDX_agg_target** target, int* target_count);
+
+
+///
+PIDX_return_code PIDX_agg_targets_destroy(PIDX_agg_target* target, int target_count);
+
+
+/// Appends a piece to the list of an aggregator, merging it with the previous piece when both sides are contiguous
+PIDX_return_code PIDX_agg_target_add_segment(PIDX_agg_target target, unsigned char* origin, MPI_Aint target_displacement, int length);
+
+
+/// Splits partition_comm by node (MPI_COMM_TYPE_SHARED, or PIDX_RANKS_PER_NODE consecutive ranks)
+PIDX_return_code PIDX_agg_node_comm_create(idx_comm idx_c, MPI_Comm* node_comm);
+
+
+/// Finds the node of every process of the communicator of the access (if not found yet), collective over the
+/// communicator of the access
+PIDX_return_code PIDX_agg_node_map_create(idx_comm idx_c);
+
+
+/// Stages the pieces of this process (target) in the shared memory window of its node and hands the pieces of the
+/// whole node to the node leader (node_target), takes the ownership of target
+PIDX_return_code PIDX_agg_shm_create(PIDX_agg_id agg_id, PIDX_agg_target* target, int target_count, int PIDX_MODE);
+
+
+/// Completes the shared memory stage once the transfers of the node leader are done (copies the fetched pieces out of
+/// the window for PIDX_READ) and frees it
+PIDX_return_code PIDX_agg_shm_finish(PIDX_agg_id agg_id, int PIDX_MODE);
+
 #endif //__PIDX_AGG_H
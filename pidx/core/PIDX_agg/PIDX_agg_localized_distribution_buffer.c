@@ -119,7 +119,7 @@ PIDX_return_code PIDX_agg_create_global_partition_localized_aggregation_buffer(P
             last_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (lbl->lbi[global_file_index] + 1) * id->idx->samples_per_block - 1 - s;
 
             // xyz index of the last sample of the block.
-            Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, last_index, ZYX);
+            PIDX_hz_index_hz_to_xyz(id->idx->hz_index, last_index, ZYX);
 
             // check to see if the sample is within bounds.
             for (i1 = 0; i1 < id->idx_c->partition_nprocs * max_patch_count; i1++)
@@ -142,7 +142,7 @@ PIDX_return_code PIDX_agg_create_global_partition_localized_aggregation_buffer(P
             last_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (lbl->lbi[global_file_index] + 1) * id->idx->samples_per_block - 1 - s;
 
             // xyz index of the last sample of the block.
-            Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, last_index, ZYX);
+            PIDX_hz_index_hz_to_xyz(id->idx->hz_index, last_index, ZYX);
 
             // check to see if the sample is within bounds.
             if (ZYX[0] < PIDX_MIN(id->idx->box_bounds[0], id->idx->partition_offset[0] + id->idx->partition_size[0]) &&
@@ -160,7 +160,7 @@ PIDX_return_code PIDX_agg_create_global_partition_localized_aggregation_buffer(P
             first_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (first_block) * id->idx->samples_per_block + s;
 
             // xyz index of the first sample of the block.
-            Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, first_index, ZYX);
+            PIDX_hz_index_hz_to_xyz(id->idx->hz_index, first_index, ZYX);
 
             // check to see if the sample is within bounds.
             for (i1 = 0; i1 < id->idx_c->partition_nprocs * max_patch_count; i1++)
@@ -183,7 +183,7 @@ PIDX_return_code PIDX_agg_create_global_partition_localized_aggregation_buffer(P
             first_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (first_block) * id->idx->samples_per_block + s;
 
             // xyz index of the first sample of the block.
-            Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, first_index, ZYX);
+            PIDX_hz_index_hz_to_xyz(id->idx->hz_index, first_index, ZYX);
 
             // check to see if the sample is within bounds.
             if (ZYX[0] >= id->idx->partition_offset[0] && ZYX[0] < PIDX_MIN(id->idx->box_bounds[0], id->idx->partition_offset[0] + id->idx->partition_size[0]) &&
@@ -197,8 +197,8 @@ PIDX_return_code PIDX_agg_create_global_partition_localized_aggregation_buffer(P
         uint64_t global_end_hz = last_index;
         uint64_t global_start_ZYX[PIDX_MAX_DIMENSIONS], global_end_ZYX[PIDX_MAX_DIMENSIONS];
 
-        Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, global_start_hz, global_start_ZYX);
-        Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, global_end_hz, global_end_ZYX);
+        PIDX_hz_index_hz_to_xyz(id->idx->hz_index, global_start_hz, global_start_ZYX);
+        PIDX_hz_index_hz_to_xyz(id->idx->hz_index, global_end_hz, global_end_ZYX);
 
         PIDX_patch global_start_point = (PIDX_patch)malloc(sizeof (*global_start_point));
         memset(global_start_point, 0, sizeof (*global_start_point));
@@ -426,7 +426,7 @@ PIDX_return_code PIDX_agg_create_local_partition_localized_aggregation_buffer(PI
             last_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (/*lbl->lbi[global_file_index]*/x + 1) * id->idx->samples_per_block - 1 - s;
 
             // xyz index of the last sample of the block.
-            Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, last_index, ZYX);
+            PIDX_hz_index_hz_to_xyz(id->idx->hz_index, last_index, ZYX);
 
             if (id->idx_c->partition_rank == 0)
               fprintf(stderr, "[%d] ZYX: %d %d %d\n", x, ZYX[0], ZYX[1], ZYX[2]);
@@ -446,7 +446,7 @@ PIDX_return_code PIDX_agg_create_local_partition_localized_aggregation_buffer(PI
           last_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (lbl->lbi[global_file_index] + 1) * id->idx->samples_per_block - 1 - s;
 
           // xyz index of the last sample of the block.
-          Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, last_index, ZYX);
+          PIDX_hz_index_hz_to_xyz(id->idx->hz_index, last_index, ZYX);
 
           //if (id->idx_c->partition_rank == 0)
           //  fprintf(stderr, "ZYX: %d %d %d\n", ZYX[0], ZYX[1], ZYX[2]);
@@ -464,7 +464,7 @@ PIDX_return_code PIDX_agg_create_local_partition_localized_aggregation_buffer(PI
           first_index = global_file_index * id->idx->blocks_per_file * id->idx->samples_per_block + (first_block) * id->idx->samples_per_block + s;
 
           // xyz index of the first sample of the block.
-          Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, first_index, ZYX);
+          PIDX_hz_index_hz_to_xyz(id->idx->hz_index, first_index, ZYX);
 
           // check to see if the sample is within bounds.
           if (ZYX[0] >= 0 && ZYX[0] < id->idx->box_bounds[0] / id->idx->chunk_size[0] &&
@@ -479,8 +479,8 @@ PIDX_return_code PIDX_agg_create_local_partition_localized_aggregation_buffer(PI
 
         uint64_t global_start_ZYX[PIDX_MAX_DIMENSIONS], global_end_ZYX[PIDX_MAX_DIMENSIONS];
 
-        Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, global_start_hz, global_start_ZYX);
-        Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, global_end_hz, global_end_ZYX);
+        PIDX_hz_index_hz_to_xyz(id->idx->hz_index, global_start_hz, global_start_ZYX);
+        PIDX_hz_index_hz_to_xyz(id->idx->hz_index, global_end_hz, global_end_ZYX);
 
         PIDX_patch global_start_point = (PIDX_patch)malloc(sizeof (*global_start_point));
         memset(global_start_point, 0, sizeof (*global_start_point));
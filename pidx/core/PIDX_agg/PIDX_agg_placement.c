@@ -0,0 +1,388 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+#include "../../PIDX_inc.h"
+
+// Places the aggregators node by node instead of uniformly across the rank space, consecutive ranks usually share a
+// node, so a uniform interval can put several aggregators (and their file writes) behind one NIC while other nodes
+// get none. Nodes are discovered with MPI_Comm_split_type(MPI_COMM_TYPE_SHARED), the environment variable
+// PIDX_RANKS_PER_NODE=n instead groups every n consecutive ranks of the simulation communicator into a node, which
+// makes the placement testable on a single machine.
+
+static PIDX_return_code node_map_create(PIDX_agg_id id, int* node, int* simulation_rank);
+static PIDX_return_code node_comm_split(MPI_Comm comm, int simulation_rank, int rank, MPI_Comm* node_comm);
+static void number_nodes(int* node, int count);
+static PIDX_return_code agg_map_add(idx_dataset idx, int file_number, int variable_index, int rank, int node);
+
+
+PIDX_return_code PIDX_agg_place_aggregators(PIDX_agg_id id, PIDX_block_layout lbl)
+{
+  int nprocs = id->idx_c->partition_nprocs;
+  int var_count = id->li - id->fi + 1;
+  int aggregator_count = var_count * lbl->efc;
+  assert(aggregator_count <= nprocs);
+
+  int *node = malloc(nprocs * sizeof(*node));
+  int *simulation_rank = malloc(nprocs * sizeof(*simulation_rank));
+  if (node == NULL || simulation_rank == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    free(node);
+    free(simulation_rank);
+    return PIDX_err_agg;
+  }
+
+  if (node_map_create(id, node, simulation_rank) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] node_map_create() failed.\n", __FILE__, __LINE__);
+    free(node);
+    free(simulation_rank);
+    return PIDX_err_agg;
+  }
+
+  // members of every node in rank order, node_map_create numbers the nodes in the order of their first rank
+  int node_count = 0;
+  for (int r = 0; r < nprocs; r++)
+    node_count = (node[r] + 1 > node_count) ? node[r] + 1 : node_count;
+
+  int *member_count = calloc(node_count, sizeof(*member_count));
+  int *member_offset = calloc(node_count + 1, sizeof(*member_offset));
+  int *member = malloc(nprocs * sizeof(*member));
+  int *quota = calloc(node_count, sizeof(*quota));
+  int *next = calloc(node_count, sizeof(*next));
+  PIDX_return_code ret = PIDX_success;
+  if (member_count == NULL || member_offset == NULL || member == NULL || quota == NULL || next == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    ret = PIDX_err_agg;
+    goto free_buffers;
+  }
+
+  for (int r = 0; r < nprocs; r++)
+    member_count[node[r]]++;
+  for (int n = 0; n < node_count; n++)
+    member_offset[n + 1] = member_offset[n] + member_count[n];
+  for (int r = 0; r < nprocs; r++)
+    member[member_offset[node[r]] + next[node[r]]++] = r;
+
+  // hand out the aggregators one node at a time, honouring the per node cap as long as the other nodes have room
+  int cap = id->idx->aggregators_per_node;
+  int assigned = 0;
+  while (assigned < aggregator_count)
+  {
+    int progress = 0;
+    for (int n = 0; n < node_count && assigned < aggregator_count; n++)
+    {
+      if (quota[n] < member_count[n] && (cap <= 0 || quota[n] < cap))
+      {
+        quota[n]++;
+        assigned++;
+        progress = 1;
+      }
+    }
+
+    if (progress == 0)
+    {
+      if (id->idx_c->partition_rank == 0)
+        fprintf(stderr, "[%s] [%d] Warning: %d aggregators do not fit in %d nodes with %d aggregators per node, ignoring the limit.\n", __FILE__, __LINE__, aggregator_count, node_count, cap);
+      cap = 0;
+    }
+  }
+
+  // consecutive aggregators (variables of a file and then files) go to different nodes, within a node the
+  // aggregators are spread uniformly across its ranks
+  for (int n = 0; n < node_count; n++)
+    next[n] = 0;
+
+  int n = 0;
+  for (int k = 0; k < lbl->efc; k++)
+  {
+    for (int i = id->fi; i <= id->li; i++)
+    {
+      while (next[n] == quota[n])
+        n = (n + 1) % node_count;
+
+      int interval = member_count[n] / quota[n];
+      int rank = member[member_offset[n] + next[n] * interval];
+      next[n]++;
+      n = (n + 1) % node_count;
+
+      id->agg_r[k][i - id->fi] = rank;
+
+      // the aggregators are the same in every aggregation round
+      if (id->idx_b->agg_round == 0 && agg_map_add(id->idx, lbl->existing_file_index[k], i, simulation_rank[rank], node[rank]) != PIDX_success)
+      {
+        fprintf(stderr, "[%s] [%d] agg_map_add() failed.\n", __FILE__, __LINE__);
+        ret = PIDX_err_agg;
+        goto free_buffers;
+      }
+    }
+  }
+
+free_buffers:
+  free(member_count);
+  free(member_offset);
+  free(member);
+  free(quota);
+  free(next);
+  free(node);
+  free(simulation_rank);
+
+  return ret;
+}
+
+
+
+// Splits partition_comm into one communicator per node, ordered as partition_comm
+PIDX_return_code PIDX_agg_node_comm_create(idx_comm idx_c, MPI_Comm* node_comm)
+{
+  return node_comm_split(idx_c->partition_comm, idx_c->simulation_rank, idx_c->partition_rank, node_comm);
+}
+
+
+
+// Finds the node of every process of the communicator of the access once, later placements translate the ranks of
+// their partition_comm to it locally instead of splitting and gathering again
+PIDX_return_code PIDX_agg_node_map_create(idx_comm idx_c)
+{
+  if (!idx_c->uses_access_comm || idx_c->access->agg_node != NULL)
+    return PIDX_success;
+
+  int rank, nprocs;
+  MPI_Comm_rank(idx_c->access->comm, &rank);
+  MPI_Comm_size(idx_c->access->comm, &nprocs);
+
+  // the communicator of the access is the simulation communicator
+  MPI_Comm node_comm;
+  if (node_comm_split(idx_c->access->comm, rank, rank, &node_comm) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] node_comm_split() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  int leader = rank;
+  MPI_Bcast(&leader, 1, MPI_INT, 0, node_comm);
+  MPI_Comm_free(&node_comm);
+
+  int *node = malloc(nprocs * sizeof(*node));
+  if (node == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  if (MPI_Allgather(&leader, 1, MPI_INT, node, 1, MPI_INT, idx_c->access->comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Allgather() failed.\n", __FILE__, __LINE__);
+    free(node);
+    return PIDX_err_agg;
+  }
+  number_nodes(node, nprocs);
+
+  idx_c->access->agg_node = node;
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code node_comm_split(MPI_Comm comm, int simulation_rank, int rank, MPI_Comm* node_comm)
+{
+  int ranks_per_node = 0;
+  char* env = getenv("PIDX_RANKS_PER_NODE");
+  if (env != NULL)
+    ranks_per_node = atoi(env);
+
+  int ret;
+  if (ranks_per_node > 0)
+    ret = MPI_Comm_split(comm, simulation_rank / ranks_per_node, rank, node_comm);
+  else
+    ret = MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, node_comm);
+
+  if (ret != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] Splitting the communicator by node failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  return PIDX_success;
+}
+
+
+
+// Turns the rank of the leader (lowest rank) of the node of every process into a node number, the leader of a node
+// comes before all the other members, so the nodes get numbered when their leader is met
+static void number_nodes(int* node, int count)
+{
+  int node_count = 0;
+  for (int r = 0; r < count; r++)
+  {
+    if (node[r] == r)
+      node[r] = node_count++;
+    else
+      node[r] = node[node[r]];
+  }
+}
+
+
+
+// node (numbered in the order of the first rank of partition_comm on it) and rank in the simulation communicator
+// of every process of partition_comm
+static PIDX_return_code node_map_create(PIDX_agg_id id, int* node, int* simulation_rank)
+{
+  int nprocs = id->idx_c->partition_nprocs;
+
+  // the nodes of the access are known, the ranks of partition_comm are translated locally
+  if (id->idx_c->uses_access_comm && id->idx_c->access->agg_node != NULL)
+  {
+    MPI_Group partition_group, access_group;
+    MPI_Comm_group(id->idx_c->partition_comm, &partition_group);
+    MPI_Comm_group(id->idx_c->access->comm, &access_group);
+
+    int access_nprocs;
+    MPI_Comm_size(id->idx_c->access->comm, &access_nprocs);
+
+    int *partition_rank = malloc(nprocs * sizeof(*partition_rank));
+    int *access_node = malloc(access_nprocs * sizeof(*access_node));
+    if (partition_rank == NULL || access_node == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+      MPI_Group_free(&partition_group);
+      MPI_Group_free(&access_group);
+      free(partition_rank);
+      free(access_node);
+      return PIDX_err_agg;
+    }
+    for (int r = 0; r < nprocs; r++)
+      partition_rank[r] = r;
+
+    int ret = MPI_Group_translate_ranks(partition_group, nprocs, partition_rank, access_group, simulation_rank);
+    MPI_Group_free(&partition_group);
+    MPI_Group_free(&access_group);
+    if (ret != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Group_translate_ranks() failed.\n", __FILE__, __LINE__);
+      free(partition_rank);
+      free(access_node);
+      return PIDX_err_agg;
+    }
+
+    // renumber the nodes in the order of partition_comm
+    for (int n = 0; n < access_nprocs; n++)
+      access_node[n] = -1;
+
+    int node_count = 0;
+    for (int r = 0; r < nprocs; r++)
+    {
+      int n = id->idx_c->access->agg_node[simulation_rank[r]];
+      if (access_node[n] == -1)
+        access_node[n] = node_count++;
+      node[r] = access_node[n];
+    }
+
+    free(partition_rank);
+    free(access_node);
+
+    return PIDX_success;
+  }
+
+  MPI_Comm node_comm;
+  if (PIDX_agg_node_comm_create(id->idx_c, &node_comm) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_agg_node_comm_create() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // partition rank of the first process of the node
+  int leader = id->idx_c->partition_rank;
+  MPI_Bcast(&leader, 1, MPI_INT, 0, node_comm);
+  MPI_Comm_free(&node_comm);
+
+  int local[2] = {leader, id->idx_c->simulation_rank};
+  int *exchange = malloc(2 * nprocs * sizeof(*exchange));
+  if (exchange == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  if (MPI_Allgather(local, 2, MPI_INT, exchange, 2, MPI_INT, id->idx_c->partition_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Allgather() failed.\n", __FILE__, __LINE__);
+    free(exchange);
+    return PIDX_err_agg;
+  }
+
+  for (int r = 0; r < nprocs; r++)
+  {
+    simulation_rank[r] = exchange[2 * r + 1];
+    node[r] = exchange[2 * r];
+  }
+  free(exchange);
+  number_nodes(node, nprocs);
+
+  return PIDX_success;
+}
+
+
+
+// records an aggregator in the aggregator map of the file (PIDX_get_aggregator)
+static PIDX_return_code agg_map_add(idx_dataset idx, int file_number, int variable_index, int rank, int node)
+{
+  if (idx->agg_map_count == idx->agg_map_capacity)
+  {
+    int capacity = (idx->agg_map_capacity == 0) ? 16 : 2 * idx->agg_map_capacity;
+    int *map = realloc(idx->agg_map, capacity * PIDX_AGG_MAP_ENTRY_SIZE * sizeof(*map));
+    if (map == NULL)
+      return PIDX_err_agg;
+
+    idx->agg_map = map;
+    idx->agg_map_capacity = capacity;
+  }
+
+  int *entry = idx->agg_map + idx->agg_map_count * PIDX_AGG_MAP_ENTRY_SIZE;
+  entry[0] = file_number;
+  entry[1] = variable_index;
+  entry[2] = rank;
+  entry[3] = node;
+  idx->agg_map_count++;
+
+  return PIDX_success;
+}
@@ -0,0 +1,243 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+#include "../../PIDX_inc.h"
+
+// Two level aggregation: the processes of a node first stage the pieces of their HZ buffers in an MPI-3 shared memory
+// window, the first process of the node (the node leader) then moves the pieces of the whole node with one transfer
+// per aggregator, so the number of messages that leave a node no longer grows with the number of processes on it.
+// For PIDX_READ the leader fetches the pieces into the window and every process copies its own out of it.
+
+static PIDX_return_code gather_segments(PIDX_agg_id id, int64_t* segment, int segment_count);
+
+
+PIDX_return_code PIDX_agg_shm_create(PIDX_agg_id id, PIDX_agg_target* target, int target_count, int mode)
+{
+  id->shm_target = target;
+  id->shm_target_count = target_count;
+
+  if (PIDX_agg_node_comm_create(id->idx_c, &(id->node_comm)) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_agg_node_comm_create() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // every piece of this process: aggregator, displacement in the aggregation buffer, length and offset in the window
+  int segment_count = 0;
+  MPI_Aint size = 0;
+  for (int t = 0; t < target_count; t++)
+  {
+    segment_count += target[t]->segment_count;
+    for (int s = 0; s < target[t]->segment_count; s++)
+      size += target[t]->length[s];
+  }
+
+  if (MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, id->node_comm, &(id->shm_buffer), &(id->shm_win)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Win_allocate_shared() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+  MPI_Win_fence(MPI_MODE_NOPRECEDE, id->shm_win);
+
+  int64_t *segment = malloc((4 * segment_count + 1) * sizeof(*segment));
+  if (segment == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  int64_t offset = 0;
+  int count = 0;
+  for (int t = 0; t < target_count; t++)
+  {
+    for (int s = 0; s < target[t]->segment_count; s++)
+    {
+      if (mode == PIDX_WRITE)
+        memcpy(id->shm_buffer + offset, (unsigned char*)target[t]->origin_address[s], target[t]->length[s]);
+
+      segment[4 * count + 0] = target[t]->rank;
+      segment[4 * count + 1] = target[t]->target_displacement[s];
+      segment[4 * count + 2] = target[t]->length[s];
+      segment[4 * count + 3] = offset;
+      offset += target[t]->length[s];
+      count++;
+    }
+  }
+
+  // the staged pieces become visible to the node leader
+  MPI_Win_fence(0, id->shm_win);
+
+  if (gather_segments(id, segment, segment_count) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] gather_segments() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+  free(segment);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_agg_shm_finish(PIDX_agg_id id, int mode)
+{
+  // the pieces fetched by the node leader become visible to the node
+  MPI_Win_fence(0, id->shm_win);
+
+  if (mode == PIDX_READ)
+  {
+    unsigned char* staged = id->shm_buffer;
+    for (int t = 0; t < id->shm_target_count; t++)
+    {
+      for (int s = 0; s < id->shm_target[t]->segment_count; s++)
+      {
+        memcpy((unsigned char*)id->shm_target[t]->origin_address[s], staged, id->shm_target[t]->length[s]);
+        staged += id->shm_target[t]->length[s];
+      }
+    }
+  }
+
+  MPI_Win_fence(MPI_MODE_NOSUCCEED, id->shm_win);
+
+  PIDX_agg_targets_destroy(id->node_target, id->node_target_count);
+  id->node_target = NULL;
+  id->node_target_count = 0;
+
+  PIDX_agg_targets_destroy(id->shm_target, id->shm_target_count);
+  id->shm_target = NULL;
+  id->shm_target_count = 0;
+
+  if (MPI_Win_free(&(id->shm_win)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Win_free() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  MPI_Comm_free(&(id->node_comm));
+
+  return PIDX_success;
+}
+
+
+
+// The node leader collects the pieces of every process of the node and groups them by aggregator, the origin of a
+// piece is its address in the shared memory window
+static PIDX_return_code gather_segments(PIDX_agg_id id, int64_t* segment, int segment_count)
+{
+  int node_rank, node_nprocs;
+  MPI_Comm_rank(id->node_comm, &node_rank);
+  MPI_Comm_size(id->node_comm, &node_nprocs);
+
+  int local_count = 4 * segment_count;
+  int *count = NULL, *displacement = NULL;
+  int64_t *node_segment = NULL;
+  if (node_rank == 0)
+  {
+    count = malloc(node_nprocs * sizeof(*count));
+    displacement = malloc(node_nprocs * sizeof(*displacement));
+  }
+
+  MPI_Gather(&local_count, 1, MPI_INT, count, 1, MPI_INT, 0, id->node_comm);
+
+  int total = 0;
+  if (node_rank == 0)
+  {
+    for (int m = 0; m < node_nprocs; m++)
+    {
+      displacement[m] = total;
+      total += count[m];
+    }
+    node_segment = malloc((total + 1) * sizeof(*node_segment));
+    if (node_segment == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
+    }
+  }
+
+  if (MPI_Gatherv(segment, local_count, MPI_INT64_T, node_segment, count, displacement, MPI_INT64_T, 0, id->node_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Gatherv() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  if (node_rank != 0)
+    return PIDX_success;
+
+  id->node_target = malloc(id->idx_c->partition_nprocs * sizeof(*id->node_target));
+  memset(id->node_target, 0, id->idx_c->partition_nprocs * sizeof(*id->node_target));
+  int *target_index = malloc(id->idx_c->partition_nprocs * sizeof(*target_index));
+  for (int r = 0; r < id->idx_c->partition_nprocs; r++)
+    target_index[r] = -1;
+
+  for (int m = 0; m < node_nprocs; m++)
+  {
+    MPI_Aint size;
+    int disp_unit;
+    unsigned char* base;
+    MPI_Win_shared_query(id->shm_win, m, &size, &disp_unit, &base);
+
+    for (int s = displacement[m]; s < displacement[m] + count[m]; s += 4)
+    {
+      int rank = (int)node_segment[s + 0];
+      if (target_index[rank] == -1)
+      {
+        target_index[rank] = id->node_target_count;
+        id->node_target[id->node_target_count] = malloc(sizeof(*id->node_target[id->node_target_count]));
+        memset(id->node_target[id->node_target_count], 0, sizeof(*id->node_target[id->node_target_count]));
+        id->node_target[id->node_target_count]->rank = rank;
+        id->node_target_count++;
+      }
+
+      if (PIDX_agg_target_add_segment(id->node_target[target_index[rank]], base + node_segment[s + 3], (MPI_Aint)node_segment[s + 1], (int)node_segment[s + 2]) != PIDX_success)
+      {
+        fprintf(stderr, "[%s] [%d] PIDX_agg_target_add_segment() failed.\n", __FILE__, __LINE__);
+        return PIDX_err_agg;
+      }
+    }
+  }
+
+  free(target_index);
+  free(node_segment);
+  free(count);
+  free(displacement);
+
+  return PIDX_success;
+}
@@ -0,0 +1,311 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+#include "../../PIDX_inc.h"
+
+
+static int write_samples(PIDX_agg_id id, PIDX_agg_target* target, int* target_index, int* target_count, int variable_index, uint64_t hz_start_index, uint64_t hz_count, unsigned char* hz_buffer, uint64_t buffer_offset, PIDX_block_layout layout);
+
+
+// Walks the HZ buffers of all the variables and groups their pieces by the aggregator that holds them
+PIDX_return_code PIDX_agg_targets_create(PIDX_agg_id id, PIDX_block_layout lbl, PIDX_agg_target** target, int* target_count)
+{
+  int ret = 0;
+  uint64_t index = 0, count = 0;
+
+  PIDX_variable var0 = id->idx->variable[id->fi];
+
+  *target = NULL;
+  *target_count = 0;
+
+  if (var0->restructured_super_patch_count == 0)
+    return PIDX_success;
+
+  // Aggregators this process sends to (receives from), target_index maps a rank of partition_comm to its aggregator
+  *target = malloc(id->idx_c->partition_nprocs * sizeof(**target));
+  memset(*target, 0, id->idx_c->partition_nprocs * sizeof(**target));
+  int *target_index = malloc(id->idx_c->partition_nprocs * sizeof(*target_index));
+  for (int r = 0; r < id->idx_c->partition_nprocs; r++)
+    target_index[r] = -1;
+
+  for (int v = id->fi; v <= id->li; v++)
+  {
+    PIDX_variable var = id->idx->variable[v];
+
+    index = 0, count = 0;
+    HZ_buffer hz_buf = var->hz_buffer;
+
+    // if a block is power in two dimension then iterate through all samples in a level at once
+    if (hz_buf->is_boundary_HZ_buffer == power_two_block)
+    {
+      for (int i = lbl->resolution_from; i < lbl->resolution_to; i++)
+      {
+        if (hz_buf->nsamples_per_level[i][0] * hz_buf->nsamples_per_level[i][1] * hz_buf->nsamples_per_level[i][2] != 0)
+        {
+          index = 0;
+          count = hz_buf->end_hz_index[i] - hz_buf->start_hz_index[i] + 1;  // all samples in the hz level local to the process
+
+          ret = write_samples(id, *target, target_index, target_count, v, hz_buf->start_hz_index[i], count, hz_buf->buffer[i], 0, lbl);
+          if (ret != PIDX_success)
+          {
+            fprintf(stderr, " Error in aggregate Line %d File %s\n", __LINE__, __FILE__);
+            free(target_index);
+            return PIDX_err_agg;
+          }
+        }
+      }
+    }
+    // if a block is non-power in two then iterte through samples in intervals of blocks
+    else if (hz_buf->is_boundary_HZ_buffer == non_power_two_block)
+    {
+      for (int i = lbl->resolution_from; i < lbl->resolution_to; i++)
+      {
+        if (var0->hz_buffer->nsamples_per_level[i][0] * var0->hz_buffer->nsamples_per_level[i][1] * var0->hz_buffer->nsamples_per_level[i][2] != 0)
+        {
+          int start_block_index = hz_buf->start_hz_index[i] / id->idx->samples_per_block;
+          int end_block_index = hz_buf->end_hz_index[i] / id->idx->samples_per_block;
+          assert(start_block_index >= 0 && end_block_index >= 0 && start_block_index <= end_block_index);
+
+          // Block 0
+          if (end_block_index == start_block_index)
+          {
+            count = (hz_buf->end_hz_index[i] - hz_buf->start_hz_index[i] + 1);
+            ret = write_samples(id, *target, target_index, target_count, v, hz_buf->start_hz_index[i], count, hz_buf->buffer[i], 0, lbl);
+            if (ret != PIDX_success)
+            {
+              fprintf(stderr, " Error in aggregate Line %d File %s\n", __LINE__, __FILE__);
+              free(target_index);
+              return PIDX_err_agg;
+            }
+          }
+          // the remaining blocks
+          else
+          {
+            int send_index = 0;
+            for (int bl = start_block_index; bl <= end_block_index; bl++)
+            {
+              if (PIDX_blocks_is_block_present(bl, id->idx->bits_per_block, lbl))
+              {
+                if (bl == start_block_index)
+                {
+                  index = 0;
+                  count = ((start_block_index + 1) * id->idx->samples_per_block) - hz_buf->start_hz_index[i];
+                }
+                else if (bl == end_block_index)
+                {
+                  index = (end_block_index * id->idx->samples_per_block - hz_buf->start_hz_index[i]);
+                  count = hz_buf->end_hz_index[i] - ((end_block_index) * id->idx->samples_per_block) + 1;
+                }
+                else
+                {
+                  index = (bl * id->idx->samples_per_block - hz_buf->start_hz_index[i]);
+                  count = id->idx->samples_per_block;
+                }
+
+                ret = write_samples(id, *target, target_index, target_count, v, index + hz_buf->start_hz_index[i], count, hz_buf->buffer[i], send_index, lbl);
+                if (ret != PIDX_success)
+                {
+                  fprintf(stderr, "[%s] [%d] write_read_samples() failed.\n", __FILE__, __LINE__);
+                  free(target_index);
+                  return PIDX_err_agg;
+                }
+                send_index = send_index + count;
+              }
+              else // if a block is skipped
+                send_index = send_index + id->idx->samples_per_block;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  free(target_index);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_agg_targets_destroy(PIDX_agg_target* target, int target_count)
+{
+  for (int t = 0; t < target_count; t++)
+  {
+    free(target[t]->origin_address);
+    free(target[t]->target_displacement);
+    free(target[t]->length);
+    free(target[t]);
+  }
+  free(target);
+
+  return PIDX_success;
+}
+
+
+
+// Records the pieces of the hz_count samples starting at hz_start_index against the aggregator that holds them
+static int write_samples(PIDX_agg_id id, PIDX_agg_target* target, int* target_index, int* target_count, int variable_index, uint64_t hz_start_index, uint64_t hz_count, unsigned char* hz_buffer, uint64_t buffer_offset, PIDX_block_layout layout)
+{
+  int block_number, file_index, file_count, block_negative_offset = 0;
+  uint64_t samples_per_file = id->idx->samples_per_block * id->idx->blocks_per_file;
+  uint64_t data_offset = 0;
+
+  PIDX_variable var = id->idx->variable[variable_index];
+
+  int bytes_per_datatype = (var->bpv / 8) * var->vps * (id->idx->chunk_size[0] * id->idx->chunk_size[1] * id->idx->chunk_size[2]) / id->idx->compression_factor;
+  hz_buffer = hz_buffer + buffer_offset * bytes_per_datatype;
+
+  // bytes of one value component of one chunk in the aggregation buffer, the unit of the offsets into it
+  int component_size = (id->idx->chunk_size[0] * id->idx->chunk_size[1] * id->idx->chunk_size[2]) * (var->bpv/8) / (id->idx->compression_factor);
+
+  // samples (counted over the blocks present in a file) held by the aggregation buffers in the current round
+  uint64_t round_from = (uint64_t) id->idx_b->agg_round * id->idx_b->agg_blocks_per_round * id->idx->samples_per_block;
+  uint64_t round_to = round_from + (uint64_t) id->idx_b->agg_blocks_per_round * id->idx->samples_per_block;
+
+  // This while loop is redundant, it will only be executed once
+  // this code is an exact replica of file per process io look at function write_samples PIDX_hz_encode_io.c
+  // this is because file-per-process io a process is allowed to write to multiple files but here we restrict
+  // one aggregator per file (the setup is already done in such a manner), look at function find_agg_level in
+  // io_setup.c
+
+  while (hz_count)
+  {
+    block_number = hz_start_index / id->idx->samples_per_block;
+    file_index = hz_start_index % samples_per_file;
+    file_count = samples_per_file - file_index;
+
+    assert(file_count > hz_count);
+
+    if ((uint64_t)file_count > hz_count)
+      file_count = hz_count;
+
+    data_offset = 0;
+    data_offset = file_index * bytes_per_datatype;
+
+    // Adjusting for missing blocks
+    block_negative_offset = PIDX_blocks_find_negative_offset(id->idx->blocks_per_file, id->idx->bits_per_block, block_number, layout);
+    data_offset -= block_negative_offset * id->idx->samples_per_block * bytes_per_datatype;
+
+    uint64_t samples_per_file = (uint64_t) id->idx->samples_per_block * id->idx->blocks_per_file;
+    int file_no = hz_start_index / samples_per_file;
+    int target_rank = id->agg_r[layout->inverse_existing_file_index[file_no]][variable_index - id->fi];
+
+    // clip the piece to the samples of the current aggregation round
+    uint64_t piece_from = data_offset / bytes_per_datatype;
+    uint64_t piece_to = piece_from + file_count;
+    if (piece_from < round_from)
+      piece_from = round_from;
+    if (piece_to > round_to)
+      piece_to = round_to;
+
+    if (piece_from < piece_to)
+    {
+      if (target_index[target_rank] == -1)
+      {
+        target_index[target_rank] = *target_count;
+        target[*target_count] = malloc(sizeof(*target[*target_count]));
+        memset(target[*target_count], 0, sizeof(*target[*target_count]));
+        target[*target_count]->rank = target_rank;
+        (*target_count)++;
+      }
+
+      unsigned char* origin = hz_buffer + (piece_from - data_offset / bytes_per_datatype) * bytes_per_datatype;
+      if (PIDX_agg_target_add_segment(target[target_index[target_rank]], origin, (MPI_Aint)(piece_from - round_from) * component_size, (piece_to - piece_from) * bytes_per_datatype) != PIDX_success)
+      {
+        fprintf(stderr, "[%s] [%d] PIDX_agg_target_add_segment() failed.\n", __FILE__, __LINE__);
+        return PIDX_err_agg;
+      }
+      id->rma_segment_count++;
+    }
+
+    hz_count -= file_count;
+    hz_start_index += file_count;
+    hz_buffer += file_count * bytes_per_datatype;
+  }
+
+  return PIDX_success;
+}
+
+
+
+// Appends a piece to the list of an aggregator, a piece that continues the previous one on both sides is merged into it
+PIDX_return_code PIDX_agg_target_add_segment(PIDX_agg_target t, unsigned char* origin, MPI_Aint target_displacement, int length)
+{
+  MPI_Aint origin_address;
+  if (MPI_Get_address(origin, &origin_address) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Get_address() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  if (t->segment_count != 0)
+  {
+    int last = t->segment_count - 1;
+    if (t->origin_address[last] + t->length[last] == origin_address && t->target_displacement[last] + t->length[last] == target_displacement && (int64_t)t->length[last] + length <= INT_MAX)
+    {
+      t->length[last] += length;
+      return PIDX_success;
+    }
+  }
+
+  if (t->segment_count == t->segment_capacity)
+  {
+    int capacity = (t->segment_capacity == 0) ? 16 : 2 * t->segment_capacity;
+    MPI_Aint *temp_origin = realloc(t->origin_address, capacity * sizeof(*temp_origin));
+    MPI_Aint *temp_target = realloc(t->target_displacement, capacity * sizeof(*temp_target));
+    int *temp_length = realloc(t->length, capacity * sizeof(*temp_length));
+    if (temp_origin == NULL || temp_target == NULL || temp_length == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
+    }
+    t->origin_address = temp_origin;
+    t->target_displacement = temp_target;
+    t->length = temp_length;
+    t->segment_capacity = capacity;
+  }
+
+  t->origin_address[t->segment_count] = origin_address;
+  t->target_displacement[t->segment_count] = target_displacement;
+  t->length[t->segment_count] = length;
+  t->segment_count++;
+
+  return PIDX_success;
+}
@@ -0,0 +1,413 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+#include "../../PIDX_inc.h"
+
+// Two sided aggregation, the pieces of the HZ buffers (see PIDX_agg_targets_create) are described to the aggregators
+// which then receive (send) them straight into (from) their aggregation buffers with hindexed datatypes.
+// No window is created and no RMA synchronization is needed.
+
+#define PIDX_AGG_META_DATA_TAG 7331
+#define PIDX_AGG_DATA_TAG 7332
+
+static PIDX_return_code alltoall_data_com(PIDX_agg_id id, Agg_buffer ab, PIDX_agg_target* target, int target_count, int mode);
+static PIDX_return_code p2p_data_com(PIDX_agg_id id, Agg_buffer ab, PIDX_agg_target* target, int target_count, int mode);
+static void pack_meta_data(PIDX_agg_target t, int64_t* meta_data);
+static PIDX_return_code create_aggregator_type(const int64_t* meta_data, int segment_count, MPI_Datatype* type);
+static PIDX_return_code create_origin_type(PIDX_agg_target t, MPI_Datatype* type);
+
+
+PIDX_return_code PIDX_agg_two_sided(PIDX_agg_id id, Agg_buffer ab, PIDX_block_layout lbl, int MODE)
+{
+  int ret = 0;
+  int target_count = 0;
+  PIDX_agg_target *target = NULL;
+
+  if (PIDX_agg_targets_create(id, lbl, &target, &target_count) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_agg_targets_create() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  if (id->idx->aggregation_backend == PIDX_ALLTOALL_AGGREGATION)
+    ret = alltoall_data_com(id, ab, target, target_count, MODE);
+  else
+    ret = p2p_data_com(id, ab, target, target_count, MODE);
+
+  PIDX_agg_targets_destroy(target, target_count);
+
+  if (ret != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] two sided aggregation failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  return PIDX_success;
+}
+
+
+
+// Counts and piece descriptions are exchanged with MPI_Alltoall and MPI_Alltoallv, the data with one MPI_Alltoallw
+static PIDX_return_code alltoall_data_com(PIDX_agg_id id, Agg_buffer ab, PIDX_agg_target* target, int target_count, int mode)
+{
+  MPI_Comm comm = id->idx_c->partition_comm;
+  int nprocs = id->idx_c->partition_nprocs;
+
+  // Number of pieces going to (coming from) every rank
+  int *send_segment_count = malloc(nprocs * sizeof(*send_segment_count));
+  int *recv_segment_count = malloc(nprocs * sizeof(*recv_segment_count));
+  int *rank_target = malloc(nprocs * sizeof(*rank_target));
+  memset(send_segment_count, 0, nprocs * sizeof(*send_segment_count));
+  memset(recv_segment_count, 0, nprocs * sizeof(*recv_segment_count));
+  for (int r = 0; r < nprocs; r++)
+    rank_target[r] = -1;
+
+  for (int t = 0; t < target_count; t++)
+  {
+    send_segment_count[target[t]->rank] = target[t]->segment_count;
+    rank_target[target[t]->rank] = t;
+  }
+
+  if (MPI_Alltoall(send_segment_count, 1, MPI_INT, recv_segment_count, 1, MPI_INT, comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Alltoall() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // Description (displacement in the aggregation buffer and length) of every piece
+  int *send_meta_count = malloc(nprocs * sizeof(*send_meta_count));
+  int *send_meta_offset = malloc(nprocs * sizeof(*send_meta_offset));
+  int *recv_meta_count = malloc(nprocs * sizeof(*recv_meta_count));
+  int *recv_meta_offset = malloc(nprocs * sizeof(*recv_meta_offset));
+  int send_meta_total = 0, recv_meta_total = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    send_meta_count[r] = 2 * send_segment_count[r];
+    send_meta_offset[r] = send_meta_total;
+    send_meta_total += send_meta_count[r];
+
+    recv_meta_count[r] = 2 * recv_segment_count[r];
+    recv_meta_offset[r] = recv_meta_total;
+    recv_meta_total += recv_meta_count[r];
+  }
+
+  int64_t *send_meta = malloc((send_meta_total + 1) * sizeof(*send_meta));
+  int64_t *recv_meta = malloc((recv_meta_total + 1) * sizeof(*recv_meta));
+  for (int t = 0; t < target_count; t++)
+    pack_meta_data(target[t], send_meta + send_meta_offset[target[t]->rank]);
+
+  if (MPI_Alltoallv(send_meta, send_meta_count, send_meta_offset, MPI_INT64_T, recv_meta, recv_meta_count, recv_meta_offset, MPI_INT64_T, comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Alltoallv() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // One datatype per rank on both sides, ranks that do not exchange anything get a zero count
+  int *origin_count = malloc(nprocs * sizeof(*origin_count));
+  int *aggregator_count = malloc(nprocs * sizeof(*aggregator_count));
+  int *zero_offset = malloc(nprocs * sizeof(*zero_offset));
+  MPI_Datatype *origin_type = malloc(nprocs * sizeof(*origin_type));
+  MPI_Datatype *aggregator_type = malloc(nprocs * sizeof(*aggregator_type));
+  uint64_t byte_count = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    origin_count[r] = 0;
+    aggregator_count[r] = 0;
+    zero_offset[r] = 0;
+    origin_type[r] = MPI_BYTE;
+    aggregator_type[r] = MPI_BYTE;
+
+    if (rank_target[r] != -1)
+    {
+      if (create_origin_type(target[rank_target[r]], &origin_type[r]) != PIDX_success)
+        return PIDX_err_agg;
+      origin_count[r] = 1;
+
+      for (int s = 0; s < target[rank_target[r]]->segment_count; s++)
+        byte_count += target[rank_target[r]]->length[s];
+    }
+
+    if (recv_segment_count[r] != 0)
+    {
+      if (create_aggregator_type(recv_meta + recv_meta_offset[r], recv_segment_count[r], &aggregator_type[r]) != PIDX_success)
+        return PIDX_err_agg;
+      aggregator_count[r] = 1;
+    }
+  }
+
+  int ret = 0;
+  if (mode == PIDX_WRITE)
+    ret = MPI_Alltoallw(MPI_BOTTOM, origin_count, zero_offset, origin_type, ab->buffer, aggregator_count, zero_offset, aggregator_type, comm);
+  else
+    ret = MPI_Alltoallw(ab->buffer, aggregator_count, zero_offset, aggregator_type, MPI_BOTTOM, origin_count, zero_offset, origin_type, comm);
+
+  if (ret != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Alltoallw() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  id->rma_op_count += target_count;
+  id->rma_byte_count += byte_count;
+
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (origin_count[r] != 0)
+      MPI_Type_free(&origin_type[r]);
+    if (aggregator_count[r] != 0)
+      MPI_Type_free(&aggregator_type[r]);
+  }
+
+  free(origin_count);
+  free(aggregator_count);
+  free(zero_offset);
+  free(origin_type);
+  free(aggregator_type);
+  free(send_meta);
+  free(recv_meta);
+  free(send_meta_count);
+  free(send_meta_offset);
+  free(recv_meta_count);
+  free(recv_meta_offset);
+  free(send_segment_count);
+  free(recv_segment_count);
+  free(rank_target);
+
+  return PIDX_success;
+}
+
+
+
+// Sparse point to point exchange, an aggregator does not know beforehand which ranks hold pieces of its buffer.
+// The piece descriptions are sent with synchronous sends, once all of them are matched a process enters a non blocking
+// barrier and keeps receiving descriptions until the barrier completes (every description has then been received).
+// Only the ranks that actually exchange data talk to each other.
+static PIDX_return_code p2p_data_com(PIDX_agg_id id, Agg_buffer ab, PIDX_agg_target* target, int target_count, int mode)
+{
+  MPI_Comm comm = id->idx_c->partition_comm;
+
+  // Step 1: send the piece descriptions to the aggregators
+  int64_t **send_meta = malloc((target_count + 1) * sizeof(*send_meta));
+  MPI_Request *meta_request = malloc((target_count + 1) * sizeof(*meta_request));
+  for (int t = 0; t < target_count; t++)
+  {
+    send_meta[t] = malloc(2 * target[t]->segment_count * sizeof(*send_meta[t]));
+    pack_meta_data(target[t], send_meta[t]);
+
+    if (MPI_Issend(send_meta[t], 2 * target[t]->segment_count, MPI_INT64_T, target[t]->rank, PIDX_AGG_META_DATA_TAG, comm, &meta_request[t]) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Issend() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
+    }
+  }
+
+  // Step 2: receive the descriptions of the pieces of my aggregation buffer
+  int source_count = 0, source_capacity = 0;
+  int *source_rank = NULL;
+  int *source_segment_count = NULL;
+  int64_t **recv_meta = NULL;
+
+  int done = 0, barrier_active = 0;
+  MPI_Request barrier_request;
+  while (done == 0)
+  {
+    int flag = 0;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, PIDX_AGG_META_DATA_TAG, comm, &flag, &status);
+    if (flag)
+    {
+      int count = 0;
+      MPI_Get_count(&status, MPI_INT64_T, &count);
+
+      if (source_count == source_capacity)
+      {
+        source_capacity = (source_capacity == 0) ? 8 : 2 * source_capacity;
+        source_rank = realloc(source_rank, source_capacity * sizeof(*source_rank));
+        source_segment_count = realloc(source_segment_count, source_capacity * sizeof(*source_segment_count));
+        recv_meta = realloc(recv_meta, source_capacity * sizeof(*recv_meta));
+        if (source_rank == NULL || source_segment_count == NULL || recv_meta == NULL)
+        {
+          fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+          return PIDX_err_agg;
+        }
+      }
+
+      source_rank[source_count] = status.MPI_SOURCE;
+      source_segment_count[source_count] = count / 2;
+      recv_meta[source_count] = malloc(count * sizeof(*recv_meta[source_count]));
+      MPI_Recv(recv_meta[source_count], count, MPI_INT64_T, status.MPI_SOURCE, PIDX_AGG_META_DATA_TAG, comm, MPI_STATUS_IGNORE);
+      source_count++;
+    }
+
+    if (barrier_active == 0)
+    {
+      int sent = 0;
+      MPI_Testall(target_count, meta_request, &sent, MPI_STATUSES_IGNORE);
+      if (sent)
+      {
+        MPI_Ibarrier(comm, &barrier_request);
+        barrier_active = 1;
+      }
+    }
+    else
+      MPI_Test(&barrier_request, &done, MPI_STATUS_IGNORE);
+  }
+
+  // A process that is done with the discovery could otherwise start the discovery of the next aggregation while
+  // another one is still probing for the descriptions of this one
+  MPI_Barrier(comm);
+
+  // Step 3: move the data
+  MPI_Request *data_request = malloc((target_count + source_count + 1) * sizeof(*data_request));
+  MPI_Datatype *origin_type = malloc((target_count + 1) * sizeof(*origin_type));
+  MPI_Datatype *aggregator_type = malloc((source_count + 1) * sizeof(*aggregator_type));
+  uint64_t byte_count = 0;
+
+  for (int s = 0; s < source_count; s++)
+  {
+    if (create_aggregator_type(recv_meta[s], source_segment_count[s], &aggregator_type[s]) != PIDX_success)
+      return PIDX_err_agg;
+
+    if (mode == PIDX_WRITE)
+      MPI_Irecv(ab->buffer, 1, aggregator_type[s], source_rank[s], PIDX_AGG_DATA_TAG, comm, &data_request[s]);
+    else
+      MPI_Isend(ab->buffer, 1, aggregator_type[s], source_rank[s], PIDX_AGG_DATA_TAG, comm, &data_request[s]);
+  }
+
+  for (int t = 0; t < target_count; t++)
+  {
+    if (create_origin_type(target[t], &origin_type[t]) != PIDX_success)
+      return PIDX_err_agg;
+
+    if (mode == PIDX_WRITE)
+      MPI_Isend(MPI_BOTTOM, 1, origin_type[t], target[t]->rank, PIDX_AGG_DATA_TAG, comm, &data_request[source_count + t]);
+    else
+      MPI_Irecv(MPI_BOTTOM, 1, origin_type[t], target[t]->rank, PIDX_AGG_DATA_TAG, comm, &data_request[source_count + t]);
+
+    for (int s = 0; s < target[t]->segment_count; s++)
+      byte_count += target[t]->length[s];
+  }
+
+  if (MPI_Waitall(source_count + target_count, data_request, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Waitall() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  id->rma_op_count += target_count;
+  id->rma_byte_count += byte_count;
+
+  for (int s = 0; s < source_count; s++)
+  {
+    MPI_Type_free(&aggregator_type[s]);
+    free(recv_meta[s]);
+  }
+  for (int t = 0; t < target_count; t++)
+  {
+    MPI_Type_free(&origin_type[t]);
+    free(send_meta[t]);
+  }
+
+  free(data_request);
+  free(origin_type);
+  free(aggregator_type);
+  free(recv_meta);
+  free(source_rank);
+  free(source_segment_count);
+  free(send_meta);
+  free(meta_request);
+
+  return PIDX_success;
+}
+
+
+
+// (displacement, length) of every piece of an aggregator
+static void pack_meta_data(PIDX_agg_target t, int64_t* meta_data)
+{
+  for (int s = 0; s < t->segment_count; s++)
+  {
+    meta_data[2 * s] = t->target_displacement[s];
+    meta_data[2 * s + 1] = t->length[s];
+  }
+}
+
+
+
+// Places the pieces of one process in the aggregation buffer
+static PIDX_return_code create_aggregator_type(const int64_t* meta_data, int segment_count, MPI_Datatype* type)
+{
+  MPI_Aint *displacement = malloc(segment_count * sizeof(*displacement));
+  int *length = malloc(segment_count * sizeof(*length));
+  for (int s = 0; s < segment_count; s++)
+  {
+    displacement[s] = meta_data[2 * s];
+    length[s] = meta_data[2 * s + 1];
+  }
+
+  int ret = MPI_Type_create_hindexed(segment_count, length, displacement, MPI_BYTE, type);
+  if (ret == MPI_SUCCESS)
+    ret = MPI_Type_commit(type);
+
+  free(displacement);
+  free(length);
+
+  if (ret != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Type_create_hindexed() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  return PIDX_success;
+}
+
+
+
+// Gathers the pieces of the HZ buffers going to one aggregator (absolute addresses, used with MPI_BOTTOM)
+static PIDX_return_code create_origin_type(PIDX_agg_target t, MPI_Datatype* type)
+{
+  if (MPI_Type_create_hindexed(t->segment_count, t->length, t->origin_address, MPI_BYTE, type) != MPI_SUCCESS || MPI_Type_commit(type) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Type_create_hindexed() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  return PIDX_success;
+}
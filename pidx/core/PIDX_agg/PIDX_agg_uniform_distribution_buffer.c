@@ -40,13 +40,15 @@
  */
 #include "../../PIDX_inc.h"
 
-// distrubutes aggregators across rank space uniformly
+// distrubutes aggregators across the nodes and then across the rank space of every node uniformly
 
 PIDX_return_code PIDX_agg_buf_create_local_uniform_dist(PIDX_agg_id id, Agg_buffer ab, PIDX_block_layout lbl)
 {
-  int rank_counter = 0;
-  int aggregator_interval = id->idx_c->partition_nprocs / ((id->li - id->fi + 1) * lbl->efc);  // Distance between aggregators (in terms of number of processes)
-  assert(aggregator_interval != 0);
+  if (PIDX_agg_place_aggregators(id, lbl) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_agg_place_aggregators() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
 
   int chunk_size = id->idx->chunk_size[0] * id->idx->chunk_size[1] * id->idx->chunk_size[2];
 
@@ -56,26 +58,34 @@ PIDX_return_code PIDX_agg_buf_create_local_uniform_dist(PIDX_agg_id id, Agg_buff
     // loop through all the variables (in the aggregation epoch)
     for (int i = id->fi; i <= id->li; i++)
     {
-      id->agg_r[k][i - id->fi] = rank_counter;
-      rank_counter = rank_counter + aggregator_interval;
-
       // if my rank is equal to the rank associated with file k and var number i, then I am the aggregator for file k variable i
       if (id->idx_c->partition_rank == id->agg_r[k][i - id->fi])
       {
+        // only the blocks of the current aggregation round, an aggregator of a file with fewer blocks has nothing to do
+        int first_block = id->idx_b->agg_round * id->idx_b->agg_blocks_per_round;
+        int block_count = lbl->bcpf[lbl->existing_file_index[k]] - first_block;
+        if (block_count > id->idx_b->agg_blocks_per_round)
+          block_count = id->idx_b->agg_blocks_per_round;
+        if (block_count <= 0)
+          continue;
+
         ab->file_number = lbl->existing_file_index[k];
         ab->var_number = i;
+        ab->first_block = first_block;
+        ab->block_count = block_count;
 
         int bpdt = (chunk_size * id->idx->variable[ab->var_number]->bpv/8) / (id->idx->compression_factor);
-        uint64_t sample_count = lbl->bcpf[ab->file_number] * id->idx->samples_per_block;
+        uint64_t sample_count = (uint64_t) ab->block_count * id->idx->samples_per_block;
         ab->buffer_size = sample_count * bpdt;
 
-        ab->buffer = malloc(ab->buffer_size);
-        memset(ab->buffer, 0, ab->buffer_size);
+        // aligned so that PIDX_DIRECT_IO_BACKEND writes (reads) it without a copy
+        ab->buffer = PIDX_file_io_buffer_alloc(ab->buffer_size);
         if (ab->buffer == NULL)
         {
           fprintf(stderr, " Error in malloc %lld: Line %d File %s\n", (long long) ab->buffer_size, __LINE__, __FILE__);
           return PIDX_err_agg;
         }
+        memset(ab->buffer, 0, ab->buffer_size);
 
 #if DEBUG_OUTPUT
         fprintf(stderr, "[File %d] [Variable %d] [Color %d] [n %d r %d p %d] Aggregator Partition rank %d\n", ab->file_number, ab->var_number, id->idx_c->color, id->idx_c->simulation_nprocs, id->idx_c->rnprocs, id->idx_c->partition_nprocs, id->idx_c->partition_rank);
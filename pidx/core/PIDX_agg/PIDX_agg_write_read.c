@@ -41,63 +41,132 @@
 #include "../../PIDX_inc.h"
 
 
-// There are two modes of MPI One-sided RMA communication
-// 1 - Active target communication (using fences)
-// 2 - Passive target communication (using locks)
+// The aggregation buffers are attached to a dynamic window (MPI_Win_create_dynamic) that belongs to the PIDX_access, so
+// the window is created once and reused by every variable, flush and time step instead of being created (a collective
+// with memory registration) and freed for every aggregation. The window spans the communicator of the access while
+// only the processes of partition_comm aggregate, so passive target synchronization (lock_all) is used, the epochs
+// are ordered with collectives on partition_comm.
 
-// My observation is that RMA works best with active target communication except for some machines
-// like ash, this might be a hit and trial thing.
-// Active target communication hangs on some machines (example ash), so, on those machines it is important to
-// uncomment the following line
-// #undef PIDX_ACTIVE_TARGET
+static PIDX_return_code expose_buffer(PIDX_agg_id id, Agg_buffer ab);
+static PIDX_return_code one_sided_data_com(PIDX_agg_id id, Agg_buffer ab, int layout_id, PIDX_block_layout lbl, int mode);
+static PIDX_return_code transfer_segments(PIDX_agg_id id, PIDX_agg_target t, int mode);
 
-#define PIDX_ACTIVE_TARGET
 
-static PIDX_return_code create_window(PIDX_agg_id id, Agg_buffer ab);
-static PIDX_return_code one_sided_data_com(PIDX_agg_id id, Agg_buffer ab, int layout_id, PIDX_block_layout lbl, int mode);
-static int write_samples(PIDX_agg_id id, int variable_index, uint64_t hz_start_index, uint64_t hz_count, unsigned char* hz_buffer, uint64_t buffer_offset, PIDX_block_layout layout, int mode);
+PIDX_return_code PIDX_agg_window_create(idx_comm idx_c)
+{
+  if (!idx_c->uses_access_comm || idx_c->access->agg_win != MPI_WIN_NULL)
+    return PIDX_success;
+
+  if (MPI_Win_create_dynamic(MPI_INFO_NULL, idx_c->access->comm, &(idx_c->access->agg_win)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Win_create_dynamic() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  return PIDX_success;
+}
+
 
 
 // Perform aggregation
 PIDX_return_code PIDX_agg_global_and_local(PIDX_agg_id id, Agg_buffer ab, int layout_id, PIDX_block_layout lbl,  int MODE)
 {
   // Steps for aggregation
-  // Step 1: Create one sided Windows
-  // Step 2: RMA fence for synchronization - begin data transfer
+  // Step 1: Attach the aggregation buffer to the window
+  // Step 2: Start the access epoch and exchange the addresses of the aggregation buffers
   // Step 3: Transfer data (one sided)
-  // Step 4: RMA fence for synchronization - end data transfer
-  // Step 5: Free the MPI windows
+  // Step 4: Complete the transfers and wait for everybody else
+  // Step 5: End the epoch and detach the aggregation buffer
+
+  // The two sided backends do not use windows at all
+  if (id->idx->aggregation_backend != PIDX_RMA_AGGREGATION)
+    return PIDX_agg_two_sided(id, ab, lbl, MODE);
+
+  // Without a window of the access (the communicator was changed with PIDX_set_comm) the window only lives for
+  // this aggregation
+  int own_window = (!id->idx_c->uses_access_comm || id->idx_c->access->agg_win == MPI_WIN_NULL);
+  if (own_window)
+  {
+    if (MPI_Win_create_dynamic(MPI_INFO_NULL, id->idx_c->partition_comm, &(id->win)) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Win_create_dynamic() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
+    }
+  }
+  else
+    id->win = id->idx_c->access->agg_win;
 
   // Step 1
-  if (create_window(id, ab) != PIDX_success)
+  if (ab->buffer_size != 0 && MPI_Win_attach(id->win, ab->buffer, ab->buffer_size) != MPI_SUCCESS)
   {
-    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "[%s] [%d] MPI_Win_attach() failed.\n", __FILE__, __LINE__);
     return PIDX_err_agg;
   }
 
-#ifdef PIDX_ACTIVE_TARGET
-  if (MPI_Win_fence(0, id->win) != MPI_SUCCESS)
+  // Step 2
+  if (MPI_Win_lock_all(MPI_MODE_NOCHECK, id->win) != MPI_SUCCESS)
   {
-    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "[%s] [%d] MPI_Win_lock_all() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // makes the data read from the file into the aggregation buffer visible to the window (PIDX_READ)
+  MPI_Win_sync(id->win);
+
+  if (expose_buffer(id, ab) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] expose_buffer() failed.\n", __FILE__, __LINE__);
     return PIDX_err_agg;
   }
-#endif
 
+  // Step 3
   if (one_sided_data_com(id, ab, layout_id, lbl, MODE) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_agg;
   }
 
-#ifdef PIDX_ACTIVE_TARGET
-  if (MPI_Win_fence(0, id->win) != MPI_SUCCESS)
+  // Step 4
+  if (MPI_Win_flush_all(id->win) != MPI_SUCCESS)
   {
-    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "[%s] [%d] MPI_Win_flush_all() failed.\n", __FILE__, __LINE__);
     return PIDX_err_agg;
   }
-#endif
 
-  if (MPI_Win_free(&(id->win)) != MPI_SUCCESS)
+  if (MPI_Barrier(id->idx_c->partition_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Barrier() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // makes the data put into the window visible to the aggregator (PIDX_WRITE)
+  MPI_Win_sync(id->win);
+
+  if (id->idx->shm_aggregation == 1 && PIDX_agg_shm_finish(id, MODE) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_agg_shm_finish() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  // Step 5
+  if (MPI_Win_unlock_all(id->win) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Win_unlock_all() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  if (ab->buffer_size != 0 && MPI_Win_detach(id->win, ab->buffer) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Win_detach() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
+
+  free(id->window_base);
+  id->window_base = NULL;
+  free(id->window_rank);
+  id->window_rank = NULL;
+
+  if (own_window && MPI_Win_free(&(id->win)) != MPI_SUCCESS)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_agg;
@@ -108,30 +177,45 @@ PIDX_return_code PIDX_agg_global_and_local(PIDX_agg_id id, Agg_buffer ab, int la
 
 
 
-static PIDX_return_code create_window(PIDX_agg_id id, Agg_buffer ab)
+// Every process of partition_comm learns the address of the aggregation buffer of every aggregator and its rank in
+// the group of the window, the exchange also guarantees that the buffers are attached before they are accessed
+static PIDX_return_code expose_buffer(PIDX_agg_id id, Agg_buffer ab)
 {
-  PIDX_variable var = id->idx->variable[ab->var_number];
+  MPI_Group window_group, partition_group;
+  MPI_Win_get_group(id->win, &window_group);
+  MPI_Comm_group(id->idx_c->partition_comm, &partition_group);
+
+  int partition_rank = id->idx_c->partition_rank;
+  int window_rank;
+  MPI_Group_translate_ranks(partition_group, 1, &partition_rank, window_group, &window_rank);
+  MPI_Group_free(&window_group);
+  MPI_Group_free(&partition_group);
 
-  // If I am an aggregator then create a window of size buffer size
+  MPI_Aint local[2] = {0, (MPI_Aint)window_rank};
   if (ab->buffer_size != 0)
+    MPI_Get_address(ab->buffer, &local[0]);
+
+  MPI_Aint *exchange = malloc(2 * id->idx_c->partition_nprocs * sizeof(*exchange));
+  id->window_base = malloc(id->idx_c->partition_nprocs * sizeof(*id->window_base));
+  id->window_rank = malloc(id->idx_c->partition_nprocs * sizeof(*id->window_rank));
+  if (exchange == NULL || id->window_base == NULL || id->window_rank == NULL)
   {
-    int tcs = id->idx->chunk_size[0] * id->idx->chunk_size[1] * id->idx->chunk_size[2];
-    int bpdt = tcs * (var->bpv/8) / (id->idx->compression_factor);
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
 
-    if (MPI_Win_create(ab->buffer, ab->buffer_size, bpdt, MPI_INFO_NULL, id->idx_c->partition_comm, &(id->win)) != MPI_SUCCESS)
-    {
-      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-      return PIDX_err_agg;
-    }
+  if (MPI_Allgather(local, 2, MPI_AINT, exchange, 2, MPI_AINT, id->idx_c->partition_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Allgather() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
   }
-  else // If I am not an aggregator then create an empty window
+
+  for (int r = 0; r < id->idx_c->partition_nprocs; r++)
   {
-    if (MPI_Win_create(0, 0, 1, MPI_INFO_NULL, id->idx_c->partition_comm, &(id->win)) != MPI_SUCCESS)
-    {
-      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-      return PIDX_err_agg;
-    }
+    id->window_base[r] = exchange[2 * r];
+    id->window_rank[r] = (int)exchange[2 * r + 1];
   }
+  free(exchange);
 
   return PIDX_success;
 }
@@ -140,178 +224,113 @@ static PIDX_return_code create_window(PIDX_agg_id id, Agg_buffer ab)
 
 static PIDX_return_code one_sided_data_com(PIDX_agg_id id, Agg_buffer ab, int layout_id, PIDX_block_layout lbl, int mode)
 {
-  int ret = 0;
-  uint64_t index = 0, count = 0;
-
-  PIDX_variable var0 = id->idx->variable[id->fi];
-
-  if (var0->restructured_super_patch_count == 0)
-    return PIDX_success;
+  int target_count = 0;
+  PIDX_agg_target *target = NULL;
 
-  for (int v = id->fi; v <= id->li; v++)
+  if (PIDX_agg_targets_create(id, lbl, &target, &target_count) != PIDX_success)
   {
-    PIDX_variable var = id->idx->variable[v];
-
-    index = 0, count = 0;
-    HZ_buffer hz_buf = var->hz_buffer;
+    fprintf(stderr, "[%s] [%d] PIDX_agg_targets_create() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_agg;
+  }
 
-    // if a block is power in two dimension then iterate through all samples in a level at once
-    if (hz_buf->is_boundary_HZ_buffer == power_two_block)
+  // With the shared memory stage only the node leader talks to the aggregators, for the pieces of the whole node
+  if (id->idx->shm_aggregation == 1)
+  {
+    if (PIDX_agg_shm_create(id, target, target_count, mode) != PIDX_success)
     {
-      for (int i = lbl->resolution_from; i < lbl->resolution_to; i++)
-      {
-        if (hz_buf->nsamples_per_level[i][0] * hz_buf->nsamples_per_level[i][1] * hz_buf->nsamples_per_level[i][2] != 0)
-        {
-          index = 0;
-          count = hz_buf->end_hz_index[i] - hz_buf->start_hz_index[i] + 1;  // all samples in the hz level local to the process
-
-          ret = write_samples(id, v, hz_buf->start_hz_index[i], count, hz_buf->buffer[i], 0, lbl, mode);
-          if (ret != PIDX_success)
-          {
-            fprintf(stderr, " Error in aggregate Line %d File %s\n", __LINE__, __FILE__);
-            return PIDX_err_agg;
-          }
-        }
-      }
+      fprintf(stderr, "[%s] [%d] PIDX_agg_shm_create() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
     }
-    // if a block is non-power in two then iterte through samples in intervals of blocks
-    else if (hz_buf->is_boundary_HZ_buffer == non_power_two_block)
+
+    target = id->node_target;
+    target_count = id->node_target_count;
+  }
+
+  // One MPI_Put (MPI_Get) per aggregator
+  for (int t = 0; t < target_count; t++)
+  {
+    if (transfer_segments(id, target[t], mode) != PIDX_success)
     {
-      for (int i = lbl->resolution_from; i < lbl->resolution_to; i++)
-      {
-        if (var0->hz_buffer->nsamples_per_level[i][0] * var0->hz_buffer->nsamples_per_level[i][1] * var0->hz_buffer->nsamples_per_level[i][2] != 0)
-        {
-          int start_block_index = hz_buf->start_hz_index[i] / id->idx->samples_per_block;
-          int end_block_index = hz_buf->end_hz_index[i] / id->idx->samples_per_block;
-          assert(start_block_index >= 0 && end_block_index >= 0 && start_block_index <= end_block_index);
-
-          // Block 0
-          if (end_block_index == start_block_index)
-          {
-            count = (hz_buf->end_hz_index[i] - hz_buf->start_hz_index[i] + 1);
-            ret = write_samples(id, v, hz_buf->start_hz_index[i], count, hz_buf->buffer[i], 0, lbl, mode);
-            if (ret != PIDX_success)
-            {
-              fprintf(stderr, " Error in aggregate Line %d File %s\n", __LINE__, __FILE__);
-              return PIDX_err_agg;
-            }
-          }
-          // the remaining blocks
-          else
-          {
-            int send_index = 0;
-            for (int bl = start_block_index; bl <= end_block_index; bl++)
-            {
-              if (PIDX_blocks_is_block_present(bl, id->idx->bits_per_block, lbl))
-              {
-                if (bl == start_block_index)
-                {
-                  index = 0;
-                  count = ((start_block_index + 1) * id->idx->samples_per_block) - hz_buf->start_hz_index[i];
-                }
-                else if (bl == end_block_index)
-                {
-                  index = (end_block_index * id->idx->samples_per_block - hz_buf->start_hz_index[i]);
-                  count = hz_buf->end_hz_index[i] - ((end_block_index) * id->idx->samples_per_block) + 1;
-                }
-                else
-                {
-                  index = (bl * id->idx->samples_per_block - hz_buf->start_hz_index[i]);
-                  count = id->idx->samples_per_block;
-                }
-
-                ret = write_samples(id, v, index + hz_buf->start_hz_index[i], count, hz_buf->buffer[i], send_index, lbl, mode);
-                if (ret != PIDX_success)
-                {
-                  fprintf(stderr, "[%s] [%d] write_read_samples() failed.\n", __FILE__, __LINE__);
-                  return PIDX_err_agg;
-                }
-                send_index = send_index + count;
-              }
-              else // if a block is skipped
-                send_index = send_index + id->idx->samples_per_block;
-            }
-          }
-        }
-      }
+      fprintf(stderr, "[%s] [%d] transfer_segments() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
     }
   }
 
+  // the staged pieces are freed by PIDX_agg_shm_finish once the transfers are complete
+  if (id->idx->shm_aggregation == 0)
+    PIDX_agg_targets_destroy(target, target_count);
+
   return PIDX_success;
 }
 
 
 
-static int write_samples(PIDX_agg_id id, int variable_index, uint64_t hz_start_index, uint64_t hz_count, unsigned char* hz_buffer, uint64_t buffer_offset, PIDX_block_layout layout, int mode)
+// Moves all the pieces of one aggregator with a single MPI_Put (MPI_Get)
+static PIDX_return_code transfer_segments(PIDX_agg_id id, PIDX_agg_target t, int mode)
 {
-  int block_number, file_index, file_count, block_negative_offset = 0;
-  uint64_t samples_per_file = id->idx->samples_per_block * id->idx->blocks_per_file;
-  uint64_t data_offset = 0;
-
-  PIDX_variable var = id->idx->variable[variable_index];
+  if (t->segment_count == 0)
+    return PIDX_success;
 
-  int bytes_per_datatype = (var->bpv / 8) * var->vps * (id->idx->chunk_size[0] * id->idx->chunk_size[1] * id->idx->chunk_size[2]) / id->idx->compression_factor;
-  hz_buffer = hz_buffer + buffer_offset * bytes_per_datatype;
+  void* origin = MPI_BOTTOM;
+  int origin_count = 1, target_count = 1;
+  MPI_Datatype origin_type = MPI_BYTE, target_type = MPI_BYTE;
+  int target_rank = id->window_rank[t->rank];
+  MPI_Aint target_displacement = id->window_base[t->rank];
+  uint64_t byte_count = 0;
 
-  // This while loop is redundant, it will only be executed once
-  // this code is an exact replica of file per process io look at function write_samples PIDX_hz_encode_io.c
-  // this is because file-per-process io a process is allowed to write to multiple files but here we restrict
-  // one aggregator per file (the setup is already done in such a manner), look at function find_agg_level in
-  // io_setup.c
+  for (int s = 0; s < t->segment_count; s++)
+    byte_count += t->length[s];
 
-  while (hz_count)
+  // the displacements of a dynamic window are addresses on the target, a single contiguous piece does not need
+  // derived datatypes, otherwise the pieces are placed by the byte displacements of the target datatype relative to
+  // the beginning of the aggregation buffer
+  if (t->segment_count == 1)
   {
-    block_number = hz_start_index / id->idx->samples_per_block;
-    file_index = hz_start_index % samples_per_file;
-    file_count = samples_per_file - file_index;
-
-    assert(file_count > hz_count);
-
-    if ((uint64_t)file_count > hz_count)
-      file_count = hz_count;
-
-    data_offset = 0;
-    data_offset = file_index * bytes_per_datatype;
-
-    // Adjusting for missing blocks
-    block_negative_offset = PIDX_blocks_find_negative_offset(id->idx->blocks_per_file, id->idx->bits_per_block, block_number, layout);
-    data_offset -= block_negative_offset * id->idx->samples_per_block * bytes_per_datatype;
-
-    uint64_t samples_per_file = (uint64_t) id->idx->samples_per_block * id->idx->blocks_per_file;
-    int file_no = hz_start_index / samples_per_file;
-    int target_rank = id->agg_r[layout->inverse_existing_file_index[file_no]][variable_index - id->fi];
-
+    origin = (void*)t->origin_address[0];
+    origin_count = t->length[0];
+    target_count = t->length[0];
+    target_displacement = MPI_Aint_add(target_displacement, t->target_displacement[0]);
+  }
+  else
+  {
+    if (MPI_Type_create_hindexed(t->segment_count, t->length, t->origin_address, MPI_BYTE, &origin_type) != MPI_SUCCESS || MPI_Type_commit(&origin_type) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Type_create_hindexed() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
+    }
 
-#ifndef PIDX_ACTIVE_TARGET
-    MPI_Win_lock(MPI_LOCK_SHARED, target_rank, 0 , id->win);
-#endif
+    if (MPI_Type_create_hindexed(t->segment_count, t->length, t->target_displacement, MPI_BYTE, &target_type) != MPI_SUCCESS || MPI_Type_commit(&target_type) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Type_create_hindexed() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_agg;
+    }
+  }
 
-    if (mode == PIDX_WRITE)
+  if (mode == PIDX_WRITE)
+  {
+    if (MPI_Put(origin, origin_count, origin_type, target_rank, target_displacement, target_count, target_type, id->win) != MPI_SUCCESS)
     {
-      if (MPI_Put(hz_buffer, file_count * bytes_per_datatype, MPI_BYTE, target_rank, data_offset / bytes_per_datatype, file_count * bytes_per_datatype, MPI_BYTE, id->win) != MPI_SUCCESS)
-      {
-        fprintf(stderr, " Error in MPI_Put Line %d File %s\n", __LINE__, __FILE__);
-        return PIDX_err_agg;
-      }
+      fprintf(stderr, " Error in MPI_Put Line %d File %s\n", __LINE__, __FILE__);
+      return PIDX_err_agg;
     }
-    else
+  }
+  else
+  {
+    if (MPI_Get(origin, origin_count, origin_type, target_rank, target_displacement, target_count, target_type, id->win) != MPI_SUCCESS)
     {
-      if (MPI_Get(hz_buffer, file_count * bytes_per_datatype, MPI_BYTE, target_rank, data_offset / bytes_per_datatype, file_count * bytes_per_datatype, MPI_BYTE, id->win) != MPI_SUCCESS)
-      {
-        fprintf(stderr, " Error in MPI_Put Line %d File %s\n", __LINE__, __FILE__);
-        return PIDX_err_agg;
-      }
+      fprintf(stderr, " Error in MPI_Get Line %d File %s\n", __LINE__, __FILE__);
+      return PIDX_err_agg;
     }
+  }
 
-#ifndef PIDX_ACTIVE_TARGET
-    MPI_Win_unlock(target_rank, id->win);
-#endif
-
-
-    hz_count -= file_count;
-    hz_start_index += file_count;
-    hz_buffer += file_count * bytes_per_datatype;
+  if (t->segment_count != 1)
+  {
+    MPI_Type_free(&origin_type);
+    MPI_Type_free(&target_type);
   }
 
+  id->rma_op_count++;
+  id->rma_byte_count += byte_count;
+
   return PIDX_success;
 }
@@ -52,7 +52,7 @@
 
 #include "../../PIDX_inc.h"
 
-static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx, int ny, int nz, uint64_t compval, int bits, int mode);
+static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx, int ny, int nz, uint64_t compval, int bits, int mode, PIDX_copy_kernel kernel);
 
 //Struct for restructuring ID
 struct PIDX_chunk_id_struct
@@ -157,7 +157,7 @@ PIDX_return_code PIDX_chunk_buf_create(PIDX_chunk_id chunk_id)
 }
 
 
-static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx, int ny, int nz, uint64_t compval, int bits, int mode)
+static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx, int ny, int nz, uint64_t compval, int bits, int mode, PIDX_copy_kernel kernel)
 {
   int dz = 4 * nx*(ny-(ny/4)*4);
   int dy = 4 * (nx-(nx/4)*4);
@@ -165,7 +165,7 @@ static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx,
 
   unsigned char * temp = q;
   unsigned char * temp2 = s;
-  int x,y,z, zz,yy,xx;
+  int x,y,z, zz,yy;
   for (z=0;z<nz;z+=4)
   {
     s = temp2 + ((z/4) * ((ny+3)/4) * ((nx+3)/4)) * cbz * (bits/CHAR_BIT);
@@ -179,18 +179,17 @@ static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx,
         {
           for (yy = 0; yy < 4; yy++)
           {
-            for (xx = 0; xx < 4; xx++)
-            {
-              int i = xx + yy * 4 + zz * 4 * 4;
-              int j = xx + yy * nx + zz * nx * ny;
-
-              if (j + diff >= compval)
-                continue;
-              if (mode == PIDX_WRITE)
-                memcpy(s + i * (bits/CHAR_BIT), q + j * (bits/CHAR_BIT), (bits/CHAR_BIT));
-              else
-                memcpy(q + j * (bits/CHAR_BIT), s + i * (bits/CHAR_BIT), (bits/CHAR_BIT));
-            }
+            // the four samples along x are contiguous on both sides, only the ones before compval are copied
+            int i = yy * 4 + zz * 4 * 4;
+            int j = yy * nx + zz * nx * ny;
+
+            if (j + diff >= compval)
+              continue;
+            uint64_t run = (compval - (j + diff) < 4) ? compval - (j + diff) : 4;
+            if (mode == PIDX_WRITE)
+              kernel->strided(s + i * (bits/CHAR_BIT), 1, q + j * (bits/CHAR_BIT), 1, run, (bits/CHAR_BIT));
+            else
+              kernel->strided(q + j * (bits/CHAR_BIT), 1, s + i * (bits/CHAR_BIT), 1, run, (bits/CHAR_BIT));
           }
         }
         s += cbz * (bits/CHAR_BIT);
@@ -260,10 +259,12 @@ PIDX_return_code PIDX_chunk(PIDX_chunk_id chunk_id, int MODE)
     int bits = 0;
     PIDX_get_datatype_details(var->type_name, &values_per_sample, &bits);
 
+    // copy kernel specialized for the size of one component
+    PIDX_copy_kernel kernel = PIDX_copy_kernel_get(bits/CHAR_BIT);
+
     unsigned char *sdim = malloc(nx*ny*nz * (bits/CHAR_BIT));
     unsigned char *op = malloc(nx*ny*nz * (bits/CHAR_BIT));
 
-    uint32_t k = 0;
     uint64_t compval = in_patch->restructured_patch->size[0] * in_patch->restructured_patch->size[1] * in_patch->restructured_patch->size[2];
     if (MODE == PIDX_WRITE)
     {
@@ -272,38 +273,24 @@ PIDX_return_code PIDX_chunk(PIDX_chunk_id chunk_id, int MODE)
         //memset(sdim, 0, nx*ny*nz * (bits/CHAR_BIT));
         //memset(op, 0, nx*ny*nz * (bits/CHAR_BIT));
 
-        k = i;
-        for (uint32_t j = 0; j < nx*ny*nz; j++)
-        {
-          memcpy(sdim + j*(bits/CHAR_BIT), in_patch->restructured_patch->buffer + k* (bits/CHAR_BIT), (bits/CHAR_BIT));
-          k+=values_per_sample;
-        }
+        // component i of every sample
+        kernel->strided(sdim, 1, in_patch->restructured_patch->buffer + i * (bits/CHAR_BIT), values_per_sample, nx*ny*nz, (bits/CHAR_BIT));
 
-        returnbuffer(sdim, op, cbz, nx, ny, nz, compval, bits, PIDX_WRITE);
+        returnbuffer(sdim, op, cbz, nx, ny, nz, compval, bits, PIDX_WRITE, kernel);
         memcpy(out_patch->restructured_patch->buffer + i * nx*ny*nz * (bits/CHAR_BIT), op, nx*ny*nz * (bits/CHAR_BIT));
       }
     }
     else
     {
-      k = 0;
       for (uint32_t i = 0; i < values_per_sample; i++)
       {
         //memset(sdim, 0, nx*ny*nz * (bits/CHAR_BIT));
         //memset(op, 0, nx*ny*nz * (bits/CHAR_BIT));
 
         memcpy(op, out_patch->restructured_patch->buffer + i * nx*ny*nz * (bits/CHAR_BIT), nx*ny*nz * (bits/CHAR_BIT));
-        returnbuffer(sdim, op, cbz, nx, ny, nz, compval, bits, PIDX_READ);
+        returnbuffer(sdim, op, cbz, nx, ny, nz, compval, bits, PIDX_READ, kernel);
 
-        k = i;
-        for (uint32_t j = 0; j < nx*ny*nz; j++)
-        {
-          //double x;
-          //memcpy(&x, sdim + j*(bits/CHAR_BIT), sizeof(double));
-          //printf("vlue = %f\n", x);
-
-          memcpy(in_patch->restructured_patch->buffer + (k)*(bits/CHAR_BIT), sdim + j*(bits/CHAR_BIT), (bits/CHAR_BIT));
-          k+=values_per_sample;
-        }
+        kernel->strided(in_patch->restructured_patch->buffer + i * (bits/CHAR_BIT), values_per_sample, sdim, 1, nx*ny*nz, (bits/CHAR_BIT));
       }
     }
 
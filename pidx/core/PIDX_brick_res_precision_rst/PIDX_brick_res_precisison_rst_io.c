@@ -219,7 +219,7 @@ PIDX_return_code PIDX_brick_res_precision_rst_buf_read_and_aggregate(PIDX_brick_
 
       MPI_Status status;
       int ret = 0;
-      ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+      ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, rst_id->idx_c->access->info, &fh);
       if (ret != MPI_SUCCESS)
       {
         fprintf(stderr, "Line %d File %s File opening %s\n", __LINE__, __FILE__, file_name);
@@ -255,6 +255,9 @@ PIDX_return_code PIDX_compression(PIDX_comp_id comp_id)
       int nz = patch->size[2];
       float bit_rate = comp_id->idx->compression_bit_rate;
 
+      // a process without data has nothing to compress (and nothing to shrink its buffer to)
+      if ((uint64_t)nx * ny * nz == 0)
+        continue;
 
       int ncomps = 0;
       int bits = 0;
@@ -293,6 +296,9 @@ PIDX_return_code PIDX_decompression(PIDX_comp_id comp_id)
       int nz = patch->size[2];
       float bit_rate = comp_id->idx->compression_bit_rate;
 
+      if ((uint64_t)nx * ny * nz == 0)
+        continue;
+
       //PIDX_get_datatype_details(var->type_name, &values, &bits);
       int ncomps = 0;
       int bits = 0;
@@ -308,6 +314,193 @@ PIDX_return_code PIDX_decompression(PIDX_comp_id comp_id)
   return PIDX_success;
 }
 
+int PIDX_compression_variable_size(idx_dataset idx)
+{
+  return idx->compression_type == PIDX_CHUNKING_ZFP_ACCURACY || idx->compression_type == PIDX_CHUNKING_ZFP_PRECISION || idx->compression_type == PIDX_CHUNKING_ZFP_REVERSIBLE;
+}
+
+
+
+// the zfp type of the values of var, if the compression type of idx supports them
+static PIDX_return_code block_codec_type(idx_dataset idx, PIDX_variable var, zfp_type* type, int* ncomps, int* bits)
+{
+  char base_type[10];
+  PIDX_decompose_type(var->type_name, base_type, ncomps, bits);
+
+  if (strcmp(base_type, "int") == 0 && (*bits == 32 || *bits == 64))
+    *type = *bits == 32 ? zfp_type_int32 : zfp_type_int64;
+  else if (strcmp(base_type, "float") == 0 && (*bits == 32 || *bits == 64))
+    *type = *bits == 32 ? zfp_type_float : zfp_type_double;
+  else
+    return PIDX_err_compress;
+
+  // the fixed accuracy mode needs floating point values
+  if (idx->compression_type == PIDX_CHUNKING_ZFP_ACCURACY && (*type == zfp_type_int32 || *type == zfp_type_int64))
+    return PIDX_err_compress;
+
+  return PIDX_success;
+}
+
+
+
+int PIDX_compression_variable_supported(idx_dataset idx, PIDX_variable var)
+{
+  zfp_type type;
+  int ncomps = 0, bits = 0;
+  return block_codec_type(idx, var, &type, &ncomps, &bits) == PIDX_success;
+}
+
+
+
+// the zfp type of the values of var and the number of 4x4x4 zfp blocks (chunks of one component, as compress_buffer
+// walks them) in an IDX block of var and their size
+static PIDX_return_code block_codec_setup(idx_dataset idx, PIDX_variable var, zfp_type* type, uint64_t* chunk_count, uint64_t* chunk_bytes)
+{
+  int ncomps = 0;
+  int bits = 0;
+  if (block_codec_type(idx, var, type, &ncomps, &bits) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] type %s can not be compressed with compression type %d.\n", __FILE__, __LINE__, var->type_name, idx->compression_type);
+    return PIDX_err_compress;
+  }
+
+  uint64_t* chunk_dim = idx->chunk_size;
+  if (chunk_dim[0] != 4 || chunk_dim[1] != 4 || chunk_dim[2] != 4)
+  {
+    fprintf(stderr, "[%s] [%d] zfp needs 4x4x4 chunks.\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  *chunk_bytes = chunk_dim[0] * chunk_dim[1] * chunk_dim[2] * (bits / CHAR_BIT);
+  *chunk_count = (uint64_t)idx->samples_per_block * ncomps;
+
+  return PIDX_success;
+}
+
+
+
+static void block_codec_set_mode(idx_dataset idx, zfp_stream* zfp)
+{
+  if (idx->compression_type == PIDX_CHUNKING_ZFP_ACCURACY)
+    zfp_stream_set_accuracy(zfp, idx->zfp_accuracy);
+  else if (idx->compression_type == PIDX_CHUNKING_ZFP_PRECISION)
+    zfp_stream_set_precision(zfp, idx->zfp_precision);
+  else
+    zfp_stream_set_reversible(zfp);
+}
+
+
+
+PIDX_return_code PIDX_compression_encode_blocks(idx_dataset idx, PIDX_variable var, const unsigned char* buffer, int block_count, unsigned char** compressed, uint64_t* block_size)
+{
+  zfp_type type;
+  uint64_t chunk_count = 0, chunk_bytes = 0;
+  if (block_codec_setup(idx, var, &type, &chunk_count, &chunk_bytes) != PIDX_success)
+    return PIDX_err_compress;
+
+  zfp_stream* zfp = zfp_stream_open(NULL);
+  block_codec_set_mode(idx, zfp);
+
+  // bound of all the blocks, plus the word each block may be padded with when its stream is flushed
+  zfp_field* field = zfp_field_3d(NULL, type, 4, 4, 4 * chunk_count * block_count);
+  uint64_t bytes_max = zfp_stream_maximum_size(zfp, field) + (uint64_t)block_count * sizeof (uint64_t);
+  zfp_field_free(field);
+
+  *compressed = malloc(bytes_max);
+  if (*compressed == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    zfp_stream_close(zfp);
+    return PIDX_err_compress;
+  }
+
+  bitstream* stream = stream_open(*compressed, bytes_max);
+  zfp_stream_set_bit_stream(zfp, stream);
+  zfp_stream_rewind(zfp);
+
+  // every block is a stream of its own (flushed to a word boundary), so that it can be read and decoded alone
+  uint64_t previous_size = 0;
+  for (int b = 0; b < block_count; b++)
+  {
+    const unsigned char* block = buffer + (uint64_t)b * chunk_count * chunk_bytes;
+    for (uint64_t c = 0; c < chunk_count; c++)
+    {
+      const unsigned char* chunk = block + c * chunk_bytes;
+      switch (type) {
+      case zfp_type_float:
+        zfp_encode_block_float_3(zfp, (const float*)chunk);
+        break;
+      case zfp_type_double:
+        zfp_encode_block_double_3(zfp, (const double*)chunk);
+        break;
+      case zfp_type_int32:
+        zfp_encode_block_int32_3(zfp, (const int32*)chunk);
+        break;
+      case zfp_type_int64:
+        zfp_encode_block_int64_3(zfp, (const int64*)chunk);
+        break;
+      default:
+        break;
+      }
+    }
+    zfp_stream_flush(zfp);
+
+    uint64_t size = stream_size(stream);
+    block_size[b] = size - previous_size;
+    previous_size = size;
+  }
+
+  zfp_stream_close(zfp);
+  stream_close(stream);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_compression_decode_block(idx_dataset idx, PIDX_variable var, const unsigned char* compressed, uint64_t size, unsigned char* block)
+{
+  zfp_type type;
+  uint64_t chunk_count = 0, chunk_bytes = 0;
+  if (block_codec_setup(idx, var, &type, &chunk_count, &chunk_bytes) != PIDX_success)
+    return PIDX_err_compress;
+
+  zfp_stream* zfp = zfp_stream_open(NULL);
+  block_codec_set_mode(idx, zfp);
+
+  bitstream* stream = stream_open((void*)compressed, size);
+  zfp_stream_set_bit_stream(zfp, stream);
+  zfp_stream_rewind(zfp);
+
+  for (uint64_t c = 0; c < chunk_count; c++)
+  {
+    unsigned char* chunk = block + c * chunk_bytes;
+    switch (type) {
+    case zfp_type_float:
+      zfp_decode_block_float_3(zfp, (float*)chunk);
+      break;
+    case zfp_type_double:
+      zfp_decode_block_double_3(zfp, (double*)chunk);
+      break;
+    case zfp_type_int32:
+      zfp_decode_block_int32_3(zfp, (int32*)chunk);
+      break;
+    case zfp_type_int64:
+      zfp_decode_block_int64_3(zfp, (int64*)chunk);
+      break;
+    default:
+      break;
+    }
+  }
+
+  zfp_stream_close(zfp);
+  stream_close(stream);
+
+  return PIDX_success;
+}
+
+
+
 PIDX_return_code PIDX_compression_finalize(PIDX_comp_id comp_id)
 {
   free(comp_id);
@@ -61,4 +61,28 @@ PIDX_return_code PIDX_decompression(PIDX_comp_id id);
 
 ///
 PIDX_return_code PIDX_compression_finalize(PIDX_comp_id id);
+
+
+
+/// Whether the blocks of idx have a variable size (PIDX_CHUNKING_ZFP_ACCURACY, PIDX_CHUNKING_ZFP_PRECISION and
+/// PIDX_CHUNKING_ZFP_REVERSIBLE). Their IDX blocks are compressed one by one by the aggregators (the other modes
+/// compress the patches before HZ encoding).
+int PIDX_compression_variable_size(idx_dataset idx);
+
+
+
+/// Whether the values of var can be compressed with the variable size ZFP mode of idx (32 and 64 bit integers and
+/// floating point values, floating point values only with PIDX_CHUNKING_ZFP_ACCURACY)
+int PIDX_compression_variable_supported(idx_dataset idx, PIDX_variable var);
+
+
+
+/// Compresses block_count consecutive IDX blocks of var in buffer. The blocks are stored one after the other in
+/// *compressed (released with free by the caller), the size of every block in block_size.
+PIDX_return_code PIDX_compression_encode_blocks(idx_dataset idx, PIDX_variable var, const unsigned char* buffer, int block_count, unsigned char** compressed, uint64_t* block_size);
+
+
+
+/// Decompresses an IDX block of var of size bytes (as written by PIDX_compression_encode_blocks) into block
+PIDX_return_code PIDX_compression_decode_block(idx_dataset idx, PIDX_variable var, const unsigned char* compressed, uint64_t size, unsigned char* block);
 #endif
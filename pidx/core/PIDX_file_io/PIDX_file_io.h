@@ -80,11 +80,191 @@ PIDX_file_io_id PIDX_file_io_init(idx_dataset idx_meta_data, idx_comm idx_c, int
 int PIDX_file_io_async_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, MPI_Request* req, MPI_File *fp, char* filename_template);
 
 
-PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template);
+
+/// Backend of the independent reads and writes of the aggregators (PIDX_set_io_backend), the transfers are
+/// complete when the calls return
+typedef struct PIDX_file_io_handle_struct* PIDX_file_io_handle;
+struct PIDX_file_io_backend_struct
+{
+  PIDX_return_code (*open)(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info);
+  PIDX_return_code (*write_at)(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size);
+  PIDX_return_code (*read_at)(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size);
+  PIDX_return_code (*close)(PIDX_file_io_handle fh);
+};
+
+/// A binary file opened with the backend of the file
+struct PIDX_file_io_handle_struct
+{
+  const struct PIDX_file_io_backend_struct* backend;
+
+  MPI_File mpi_fh;                                      /// PIDX_MPI_IO_BACKEND
+  int fd;                                               /// PIDX_POSIX_IO_BACKEND and PIDX_DIRECT_IO_BACKEND
+  int direct;                                           /// fd was opened with O_DIRECT
+  int access_pattern;                                   /// read_access_pattern of the dataset
+
+  unsigned char* map;                                   /// PIDX_MMAP_IO_BACKEND, the file mapped read only
+  uint64_t map_size;
+};
+
+
+/// Opens a binary file for reading (PIDX_READ) or writing (PIDX_WRITE) with the backend of io_id, a file opened for
+/// writing is created (not truncated) if it does not exist
+PIDX_return_code PIDX_file_io_open(PIDX_file_io_id io_id, const char* file_name, int mode, PIDX_file_io_handle fh);
+
+
+/// Opens a binary file for writing with MPI-IO (collective over comm), the file and its directory are created if
+/// they do not exist. The writers of a file create it, there is no pass creating the files of a time step.
+PIDX_return_code PIDX_file_io_mpi_create(MPI_Comm comm, const char* file_name, MPI_Info info, MPI_File* fh);
+
+
+/// Creates the missing directories of the path of file_name
+PIDX_return_code PIDX_file_io_make_directories(const char* file_name);
+
+
+PIDX_return_code PIDX_file_io_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size);
+
+
+PIDX_return_code PIDX_file_io_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size);
+
+
+PIDX_return_code PIDX_file_io_close(PIDX_file_io_handle fh);
+
+
+/// Points data to size bytes at offset of a file mapped by PIDX_MMAP_IO_BACKEND, valid until the file is closed
+PIDX_return_code PIDX_file_io_view_at(PIDX_file_io_handle fh, uint64_t offset, uint64_t size, const unsigned char** data);
+
+
+/// Allocates a buffer aligned to PIDX_DIRECT_IO_ALIGNMENT (released with free), so that O_DIRECT needs no copy of it
+unsigned char* PIDX_file_io_buffer_alloc(uint64_t size);
+
+
+/// A write started by PIDX_file_io_async_write that has not completed yet. It owns the aggregation buffer and the
+/// file, both are released when the write completes.
+struct PIDX_file_io_pending_struct
+{
+  Agg_buffer agg_buf;
+  MPI_File fh;
+  MPI_Request request;
+
+  struct PIDX_file_io_pending_struct *next;
+};
+typedef struct PIDX_file_io_pending_struct* PIDX_file_io_pending;
+
+
+/// Hands a started write over to the access, agg_buf must not be used by the caller any more
+PIDX_return_code PIDX_file_io_pending_add(PIDX_access access, Agg_buffer agg_buf, MPI_File fh, MPI_Request request);
+
+
+/// Completes all the pending writes of the access
+PIDX_return_code PIDX_file_io_pending_wait(PIDX_access access);
+
+
+/// Completes the pending writes of the access that are done, flag is set to 1 if none is left
+PIDX_return_code PIDX_file_io_pending_test(PIDX_access access, int* flag);
+
+
+/// Writes agg_buf to its file, and headers (header_size bytes, NULL for none) at the start of the file through the same
+/// handle
+PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template, const uint32_t* headers, uint64_t header_size);
+
+
+/// Writes the blocks of agg_buf compressed by PIDX_compression_encode_blocks (data, block_size[i] bytes for block i)
+/// at data_offset of its file, and their offsets and sizes to the header of the file (PIDX_header_io_idx_file_clear)
+PIDX_return_code PIDX_file_io_packed_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template, const unsigned char* data, const uint64_t* block_size, uint64_t data_offset);
+
+
+/// Collective over file_comm, the aggregators of the file of agg_buf
+PIDX_return_code PIDX_file_io_collective_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, MPI_Comm file_comm, char* filename_template);
 
 
 PIDX_return_code  PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template);
 
+
+
+/// The writes of a process to its own files (file per process raw and particle IO). The files are opened, written
+/// and closed together by PIDX_file_io_batch_submit, through io_uring when the kernel supports it and with
+/// open/pwrite/close otherwise.
+typedef struct PIDX_file_io_batch_struct* PIDX_file_io_batch;
+
+
+/// Returns NULL if the batch can not be allocated
+PIDX_file_io_batch PIDX_file_io_batch_create();
+
+
+/// Adds a file to the batch (created if it does not exist) and returns its index for PIDX_file_io_batch_add_write,
+/// or -1 if it can not be added
+int PIDX_file_io_batch_add_file(PIDX_file_io_batch batch, const char* file_name);
+
+
+/// Queues a write of buffer to the file, buffer must stay valid until PIDX_file_io_batch_submit returns. If own is
+/// set buffer is released by PIDX_file_io_batch_free, unless the write can not be queued (the caller keeps it then).
+PIDX_return_code PIDX_file_io_batch_add_write(PIDX_file_io_batch batch, int file_index, unsigned char* buffer, uint64_t size, uint64_t offset, int own);
+
+
+/// Performs all the queued writes and closes the files, the only blocking call of the batch
+PIDX_return_code PIDX_file_io_batch_submit(PIDX_file_io_batch batch);
+
+
+///
+void PIDX_file_io_batch_free(PIDX_file_io_batch batch);
+
+
+
+/// Binary files of a dataset open for reading with their headers, shared by all the readers of the dataset
+/// (idx->file_cache). The least recently used files are closed beyond idx->file_cache_open_limit and their headers
+/// dropped beyond idx->file_cache_header_limit.
+typedef struct PIDX_file_io_cache_struct* PIDX_file_io_cache;
+
+
+/// Returns the open file file_name of the dataset and its header (in the format of PIDX_header_block_offset), both
+/// owned by the cache and valid until the next call
+PIDX_return_code PIDX_file_io_cache_get(idx_dataset idx, idx_comm idx_c, const char* file_name, PIDX_file_io_handle* fh, uint32_t** headers);
+
+
+/// Points data to size bytes at offset of the mapped file file_name (PIDX_MMAP_IO_BACKEND) of the dataset, the file is
+/// kept open until the view is given back with PIDX_file_io_cache_release
+PIDX_return_code PIDX_file_io_cache_view(idx_dataset idx, idx_comm idx_c, const char* file_name, uint64_t offset, uint64_t size, const unsigned char** data);
+
+
+/// Gives back a view of PIDX_file_io_cache_view
+PIDX_return_code PIDX_file_io_cache_release(PIDX_file_io_cache cache, const unsigned char* data);
+
+
+/// Closes the files of the cache
+void PIDX_file_io_cache_free(PIDX_file_io_cache cache);
+
+
+
+/// Copies of the pieces of binary files written below a staging directory (PIDX_set_staging_directory) to the files of
+/// the dataset, made by a thread of the process (synchronously when built without pthreads). Each piece is recorded in
+/// the manifest <staging directory>/pidx-drain-<rank>.manifest when it is written ("W" lines) and when it is copied
+/// ("D" lines).
+struct PIDX_file_io_drain_struct;
+
+
+/// Queues the copy of size bytes at offset of the staged file file_name (<idx->staging_directory>/<rank>/<file of the
+/// dataset>) to the file of the dataset. The drain of the access of idx_c is started by the first call.
+PIDX_return_code PIDX_file_io_drain_add(idx_dataset idx, idx_comm idx_c, const char* file_name, uint64_t offset, uint64_t size);
+
+
+/// Marks the staged files written so far by the access as complete: each is removed as soon as its pieces are copied
+PIDX_return_code PIDX_file_io_drain_seal(PIDX_access access);
+
+
+/// Completes the copies of the access and removes the staged files and the manifest
+PIDX_return_code PIDX_file_io_drain_wait(PIDX_access access);
+
+
+/// Completes the copies recorded in the manifests of staging_directory
+PIDX_return_code PIDX_file_io_drain_resume(const char* staging_directory);
+
+
+
+/// Reverses in place the byte order of the values of var (of the type of var) in buffer, for the datasets of the
+/// other endianness (flip_endian)
+void PIDX_file_io_flip_endian(PIDX_variable var, unsigned char* buffer, uint64_t size);
+
+
 ///
 int PIDX_file_io_finalize(PIDX_file_io_id io_id);
 
@@ -0,0 +1,566 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2010-2019 ViSUS L.L.C.,
+ * Scientific Computing and Imaging Institute of the University of Utah
+ *
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ *
+ */
+
+// O_DIRECT
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../../PIDX_inc.h"
+
+#if !defined _MSC_VER
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static PIDX_return_code mpi_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info);
+static PIDX_return_code mpi_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size);
+static PIDX_return_code mpi_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size);
+static PIDX_return_code mpi_close(PIDX_file_io_handle fh);
+
+static PIDX_return_code posix_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info);
+static PIDX_return_code posix_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size);
+static PIDX_return_code posix_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size);
+static PIDX_return_code posix_close(PIDX_file_io_handle fh);
+
+static PIDX_return_code direct_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info);
+static PIDX_return_code direct_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size);
+static PIDX_return_code direct_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size);
+
+static PIDX_return_code mmap_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info);
+static PIDX_return_code mmap_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size);
+static PIDX_return_code mmap_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size);
+static PIDX_return_code mmap_close(PIDX_file_io_handle fh);
+
+static int posix_create(const char* file_name, int flags);
+
+
+static const struct PIDX_file_io_backend_struct mpi_backend = {mpi_open, mpi_write_at, mpi_read_at, mpi_close};
+static const struct PIDX_file_io_backend_struct posix_backend = {posix_open, posix_write_at, posix_read_at, posix_close};
+static const struct PIDX_file_io_backend_struct direct_backend = {direct_open, direct_write_at, direct_read_at, posix_close};
+static const struct PIDX_file_io_backend_struct mmap_backend = {mmap_open, mmap_write_at, mmap_read_at, mmap_close};
+
+
+
+PIDX_return_code PIDX_file_io_open(PIDX_file_io_id io_id, const char* file_name, int mode, PIDX_file_io_handle fh)
+{
+  memset(fh, 0, sizeof (*fh));
+  fh->fd = -1;
+  fh->access_pattern = io_id->idx->read_access_pattern;
+
+  if (io_id->idx->io_backend == PIDX_POSIX_IO_BACKEND)
+    fh->backend = &posix_backend;
+  else if (io_id->idx->io_backend == PIDX_DIRECT_IO_BACKEND)
+    fh->backend = &direct_backend;
+  else if (io_id->idx->io_backend == PIDX_MMAP_IO_BACKEND)
+    fh->backend = (mode == PIDX_READ) ? &mmap_backend : &posix_backend;
+  else
+    fh->backend = &mpi_backend;
+
+  // the serial readers (PIDX_serial_file_open) have no access
+  MPI_Info info = (io_id->idx_c->access != NULL) ? io_id->idx_c->access->info : MPI_INFO_NULL;
+
+  return fh->backend->open(fh, file_name, mode, info);
+}
+
+
+
+PIDX_return_code PIDX_file_io_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size)
+{
+  return fh->backend->write_at(fh, offset, buffer, size);
+}
+
+
+
+PIDX_return_code PIDX_file_io_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size)
+{
+  return fh->backend->read_at(fh, offset, buffer, size);
+}
+
+
+
+PIDX_return_code PIDX_file_io_close(PIDX_file_io_handle fh)
+{
+  return fh->backend->close(fh);
+}
+
+
+
+PIDX_return_code PIDX_file_io_view_at(PIDX_file_io_handle fh, uint64_t offset, uint64_t size, const unsigned char** data)
+{
+  if (fh->backend != &mmap_backend)
+  {
+    fprintf(stderr, "[%s] [%d] views need the PIDX_MMAP_IO_BACKEND.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  if (offset > fh->map_size || size > fh->map_size - offset)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] %lld bytes past the end of the file.\n", (long long) offset, __FILE__, __LINE__, (long long) size);
+    return PIDX_err_io;
+  }
+
+  *data = fh->map + offset;
+
+  return PIDX_success;
+}
+
+
+
+unsigned char* PIDX_file_io_buffer_alloc(uint64_t size)
+{
+#if defined _MSC_VER
+  return malloc(size);
+#else
+  void* buffer = NULL;
+  if (posix_memalign(&buffer, PIDX_DIRECT_IO_ALIGNMENT, size) != 0)
+    return NULL;
+
+  return buffer;
+#endif
+}
+
+
+
+PIDX_return_code PIDX_file_io_make_directories(const char* file_name)
+{
+  char path[PATH_MAX];
+  snprintf(path, PATH_MAX, "%s", file_name);
+
+  char* slash = strrchr(path, '/');
+  if (slash == NULL || slash == path)
+    return PIDX_success;
+  *slash = '\0';
+
+  struct stat st;
+  if (stat(path, &st) == 0)
+    return PIDX_success;
+
+  // walk up the path and mkdir each segment
+  char* c;
+  for (c = path + 1; ; c++)
+  {
+    if (*c != '/' && *c != '\0')
+      continue;
+
+    char end = *c;
+    *c = '\0';
+    if (mkdir(path, S_IRWXU | S_IRWXG | S_IRWXO) != 0 && errno != EEXIST)
+    {
+      fprintf(stderr, "[%s] [%d] mkdir() failed for %s (%s).\n", __FILE__, __LINE__, path, strerror(errno));
+      return PIDX_err_io;
+    }
+    *c = end;
+
+    if (end == '\0')
+      break;
+  }
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_mpi_create(MPI_Comm comm, const char* file_name, MPI_Info info, MPI_File* fh)
+{
+  // the directory is only looked at when the open fails, it is created ahead by one process (see
+  // PIDX_header_io_idx_file_directories) but for the staged files
+  if (MPI_File_open(comm, (char*) file_name, MPI_MODE_WRONLY | MPI_MODE_CREATE, info, fh) == MPI_SUCCESS)
+    return PIDX_success;
+
+  if (PIDX_file_io_make_directories(file_name) != PIDX_success || MPI_File_open(comm, (char*) file_name, MPI_MODE_WRONLY | MPI_MODE_CREATE, info, fh) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+// open() of a file written by the aggregators, created with its directory if needed
+static int posix_create(const char* file_name, int flags)
+{
+  int fd = open(file_name, flags | O_CREAT, 0664);
+  if (fd < 0 && errno == ENOENT && PIDX_file_io_make_directories(file_name) == PIDX_success)
+    fd = open(file_name, flags | O_CREAT, 0664);
+
+  return fd;
+}
+
+
+
+static PIDX_return_code mpi_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info)
+{
+  if (mode == PIDX_WRITE)
+    return PIDX_file_io_mpi_create(MPI_COMM_SELF, file_name, info, &(fh->mpi_fh));
+
+  if (MPI_File_open(MPI_COMM_SELF, (char*) file_name, MPI_MODE_RDONLY, info, &(fh->mpi_fh)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code mpi_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size)
+{
+  MPI_Status status;
+  if (MPI_File_write_at(fh->mpi_fh, offset, (void*) buffer, size, MPI_BYTE, &status) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at() failed.\n", (long long) offset, __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  int write_count = 0;
+  MPI_Get_count(&status, MPI_BYTE, &write_count);
+  if ((uint64_t) write_count != size)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %lld\n", __FILE__, __LINE__, write_count, (long long) size);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code mpi_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size)
+{
+  MPI_Status status;
+  if (MPI_File_read_at(fh->mpi_fh, offset, buffer, size, MPI_BYTE, &status) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_read_at() failed.\n", (long long) offset, __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  int read_count = 0;
+  MPI_Get_count(&status, MPI_BYTE, &read_count);
+  if ((uint64_t) read_count != size)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_read_at() failed. %d != %lld\n", __FILE__, __LINE__, read_count, (long long) size);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code mpi_close(PIDX_file_io_handle fh)
+{
+  if (MPI_File_close(&(fh->mpi_fh)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_close() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code posix_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info)
+{
+  fh->fd = (mode == PIDX_WRITE) ? posix_create(file_name, O_WRONLY | O_BINARY) : open(file_name, O_RDONLY | O_BINARY);
+  if (fh->fd < 0)
+  {
+    fprintf(stderr, "[%s] [%d] open() filename %s failed (%s).\n", __FILE__, __LINE__, file_name, strerror(errno));
+    return PIDX_err_io;
+  }
+
+#if defined POSIX_FADV_SEQUENTIAL
+  // read ahead hint only, failures are ignored
+  if (mode == PIDX_READ && fh->access_pattern == PIDX_READ_ACCESS_SEQUENTIAL)
+    posix_fadvise(fh->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  else if (mode == PIDX_READ && fh->access_pattern == PIDX_READ_ACCESS_RANDOM)
+    posix_fadvise(fh->fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code posix_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size)
+{
+  // pwrite may write less than asked for
+  while (size > 0)
+  {
+    ssize_t write_count = pwrite(fh->fd, buffer, size, offset);
+    if (write_count <= 0)
+    {
+      fprintf(stderr, "Data offset = %lld [%s] [%d] pwrite() failed (%s).\n", (long long) offset, __FILE__, __LINE__, strerror(errno));
+      return PIDX_err_io;
+    }
+
+    buffer = buffer + write_count;
+    offset = offset + write_count;
+    size = size - write_count;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code posix_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size)
+{
+  while (size > 0)
+  {
+    ssize_t read_count = pread(fh->fd, buffer, size, offset);
+    if (read_count <= 0)
+    {
+      fprintf(stderr, "Data offset = %lld [%s] [%d] pread() failed (%s).\n", (long long) offset, __FILE__, __LINE__, (read_count == 0) ? "end of file" : strerror(errno));
+      return PIDX_err_io;
+    }
+
+    buffer = buffer + read_count;
+    offset = offset + read_count;
+    size = size - read_count;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code posix_close(PIDX_file_io_handle fh)
+{
+  if (close(fh->fd) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] close() failed (%s).\n", __FILE__, __LINE__, strerror(errno));
+    return PIDX_err_io;
+  }
+  fh->fd = -1;
+
+  return PIDX_success;
+}
+
+
+
+// O_DIRECT bypasses the page cache, the offset, the size and the address of every transfer have to be multiples of
+// PIDX_DIRECT_IO_ALIGNMENT. The file systems that do not support it (tmpfs) get plain POSIX io.
+static PIDX_return_code direct_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info)
+{
+#ifdef O_DIRECT
+  fh->fd = (mode == PIDX_WRITE) ? posix_create(file_name, O_WRONLY | O_DIRECT) : open(file_name, O_RDONLY | O_DIRECT);
+  if (fh->fd >= 0)
+  {
+    fh->direct = 1;
+    return PIDX_success;
+  }
+
+  if (errno != EINVAL)
+  {
+    fprintf(stderr, "[%s] [%d] open() filename %s failed (%s).\n", __FILE__, __LINE__, file_name, strerror(errno));
+    return PIDX_err_io;
+  }
+#endif
+
+  return posix_open(fh, file_name, mode, info);
+}
+
+
+
+// the transfers that are not aligned go through the page cache, O_DIRECT is cleared for them
+static PIDX_return_code set_direct(PIDX_file_io_handle fh, int direct)
+{
+#ifdef O_DIRECT
+  int flags = fcntl(fh->fd, F_GETFL);
+  flags = (direct == 1) ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+  if (fcntl(fh->fd, F_SETFL, flags) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] fcntl() failed (%s).\n", __FILE__, __LINE__, strerror(errno));
+    return PIDX_err_io;
+  }
+#endif
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code direct_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size)
+{
+  uint64_t direct_size = 0;
+  if (fh->direct == 1 && offset % PIDX_DIRECT_IO_ALIGNMENT == 0 && (uintptr_t) buffer % PIDX_DIRECT_IO_ALIGNMENT == 0)
+    direct_size = size - size % PIDX_DIRECT_IO_ALIGNMENT;
+
+  if (direct_size != 0 && posix_write_at(fh, offset, buffer, direct_size) != PIDX_success)
+    return PIDX_err_io;
+
+  if (direct_size == size)
+    return PIDX_success;
+
+  // the unaligned remainder (or all of it)
+  if (fh->direct == 1 && set_direct(fh, 0) != PIDX_success)
+    return PIDX_err_io;
+
+  if (posix_write_at(fh, offset + direct_size, buffer + direct_size, size - direct_size) != PIDX_success)
+    return PIDX_err_io;
+
+  if (fh->direct == 1 && set_direct(fh, 1) != PIDX_success)
+    return PIDX_err_io;
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code direct_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size)
+{
+  uint64_t direct_size = 0;
+  if (fh->direct == 1 && offset % PIDX_DIRECT_IO_ALIGNMENT == 0 && (uintptr_t) buffer % PIDX_DIRECT_IO_ALIGNMENT == 0)
+    direct_size = size - size % PIDX_DIRECT_IO_ALIGNMENT;
+
+  if (direct_size != 0 && posix_read_at(fh, offset, buffer, direct_size) != PIDX_success)
+    return PIDX_err_io;
+
+  if (direct_size == size)
+    return PIDX_success;
+
+  if (fh->direct == 1 && set_direct(fh, 0) != PIDX_success)
+    return PIDX_err_io;
+
+  if (posix_read_at(fh, offset + direct_size, buffer + direct_size, size - direct_size) != PIDX_success)
+    return PIDX_err_io;
+
+  if (fh->direct == 1 && set_direct(fh, 1) != PIDX_success)
+    return PIDX_err_io;
+
+  return PIDX_success;
+}
+
+
+
+// The file is mapped read only at open and closed right away, the reads copy from the mapping and the views point into
+// it. Without mmap (Windows) the files are read with pread.
+static PIDX_return_code mmap_open(PIDX_file_io_handle fh, const char* file_name, int mode, MPI_Info info)
+{
+#if defined _MSC_VER
+  fh->backend = &posix_backend;
+  return posix_open(fh, file_name, mode, info);
+#else
+  int fd = open(file_name, O_RDONLY | O_BINARY);
+  if (fd < 0)
+  {
+    fprintf(stderr, "[%s] [%d] open() filename %s failed (%s).\n", __FILE__, __LINE__, file_name, strerror(errno));
+    return PIDX_err_io;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] fstat() filename %s failed (%s).\n", __FILE__, __LINE__, file_name, strerror(errno));
+    close(fd);
+    return PIDX_err_io;
+  }
+
+  fh->map = NULL;
+  fh->map_size = file_stat.st_size;
+  if (fh->map_size != 0)
+  {
+    void* map = mmap(NULL, fh->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      fprintf(stderr, "[%s] [%d] mmap() filename %s failed (%s).\n", __FILE__, __LINE__, file_name, strerror(errno));
+      close(fd);
+      return PIDX_err_io;
+    }
+    fh->map = map;
+
+    // paging hint only, failures are ignored
+    if (fh->access_pattern == PIDX_READ_ACCESS_SEQUENTIAL)
+      madvise(fh->map, fh->map_size, MADV_SEQUENTIAL);
+    else if (fh->access_pattern == PIDX_READ_ACCESS_RANDOM)
+      madvise(fh->map, fh->map_size, MADV_RANDOM);
+  }
+  close(fd);
+
+  return PIDX_success;
+#endif
+}
+
+
+
+static PIDX_return_code mmap_write_at(PIDX_file_io_handle fh, uint64_t offset, const unsigned char* buffer, uint64_t size)
+{
+  fprintf(stderr, "[%s] [%d] the mapped files are read only.\n", __FILE__, __LINE__);
+  return PIDX_err_io;
+}
+
+
+
+static PIDX_return_code mmap_read_at(PIDX_file_io_handle fh, uint64_t offset, unsigned char* buffer, uint64_t size)
+{
+  const unsigned char* data;
+  if (size == 0)
+    return PIDX_success;
+
+  if (PIDX_file_io_view_at(fh, offset, size, &data) != PIDX_success)
+    return PIDX_err_io;
+
+  memcpy(buffer, data, size);
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code mmap_close(PIDX_file_io_handle fh)
+{
+#if !defined _MSC_VER
+  if (fh->map != NULL && munmap(fh->map, fh->map_size) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] munmap() failed (%s).\n", __FILE__, __LINE__, strerror(errno));
+    return PIDX_err_io;
+  }
+#endif
+  fh->map = NULL;
+  fh->map_size = 0;
+
+  return PIDX_success;
+}
@@ -0,0 +1,567 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2010-2019 ViSUS L.L.C.,
+ * Scientific Computing and Imaging Institute of the University of Utah
+ *
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ *
+ */
+
+// syscall, MAP_POPULATE and AT_FDCWD
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../../PIDX_inc.h"
+
+#if defined PIDX_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// Largest write of one io_uring request (the length of a request is 32 bit)
+#define BATCH_MAX_WRITE_SIZE (1ULL << 30)
+
+// Requests submitted to the ring at a time, the kernel rounds it to a power of two
+#define BATCH_RING_ENTRIES 1024
+
+// Files open in the ring at a time (registered file table)
+#define BATCH_FILE_SLOTS 256
+
+
+struct batch_write
+{
+  unsigned char* buffer;
+  uint64_t size;
+  uint64_t offset;
+};
+
+struct batch_file
+{
+  char* file_name;
+
+  int write_count;
+  int write_capacity;
+  struct batch_write* write;
+
+  int request_count;                 /// open, the writes (in pieces of BATCH_MAX_WRITE_SIZE) and close
+  int completed_count;
+  int failed;                        /// not (completely) written by io_uring, written with pwrite instead
+  int slot;
+};
+
+struct PIDX_file_io_batch_struct
+{
+  int file_count;
+  int file_capacity;
+  struct batch_file* file;
+
+  int owned_count;
+  int owned_capacity;
+  unsigned char** owned;
+};
+
+
+static PIDX_return_code sync_write_file(struct batch_file* f);
+
+#if defined PIDX_HAVE_IO_URING
+static void uring_write_files(PIDX_file_io_batch batch);
+#endif
+
+
+
+PIDX_file_io_batch PIDX_file_io_batch_create()
+{
+  PIDX_file_io_batch batch = malloc(sizeof (*batch));
+  if (batch == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return NULL;
+  }
+  memset(batch, 0, sizeof (*batch));
+
+  return batch;
+}
+
+
+
+int PIDX_file_io_batch_add_file(PIDX_file_io_batch batch, const char* file_name)
+{
+  if (batch->file_count == batch->file_capacity)
+  {
+    int capacity = (batch->file_capacity == 0) ? 8 : 2 * batch->file_capacity;
+    struct batch_file* file = realloc(batch->file, capacity * sizeof (*file));
+    if (file == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return -1;
+    }
+    batch->file = file;
+    batch->file_capacity = capacity;
+  }
+
+  struct batch_file* f = &batch->file[batch->file_count];
+  memset(f, 0, sizeof (*f));
+  f->file_name = malloc(strlen(file_name) + 1);
+  if (f->file_name == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return -1;
+  }
+  strcpy(f->file_name, file_name);
+  f->request_count = 2;
+
+  return batch->file_count++;
+}
+
+
+
+PIDX_return_code PIDX_file_io_batch_add_write(PIDX_file_io_batch batch, int file_index, unsigned char* buffer, uint64_t size, uint64_t offset, int own)
+{
+  // both arrays are grown first, on failure nothing is queued and buffer is left to the caller
+  if (own == 1 && batch->owned_count == batch->owned_capacity)
+  {
+    int capacity = (batch->owned_capacity == 0) ? 8 : 2 * batch->owned_capacity;
+    unsigned char** owned = realloc(batch->owned, capacity * sizeof (*owned));
+    if (owned == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_io;
+    }
+    batch->owned = owned;
+    batch->owned_capacity = capacity;
+  }
+
+  struct batch_file* f = &batch->file[file_index];
+  if (size != 0 && f->write_count == f->write_capacity)
+  {
+    int capacity = (f->write_capacity == 0) ? 4 : 2 * f->write_capacity;
+    struct batch_write* write = realloc(f->write, capacity * sizeof (*write));
+    if (write == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_io;
+    }
+    f->write = write;
+    f->write_capacity = capacity;
+  }
+
+  if (own == 1)
+    batch->owned[batch->owned_count++] = buffer;
+
+  if (size == 0)
+    return PIDX_success;
+
+  f->write[f->write_count].buffer = buffer;
+  f->write[f->write_count].size = size;
+  f->write[f->write_count].offset = offset;
+  f->write_count++;
+  f->request_count += (int) ((size + BATCH_MAX_WRITE_SIZE - 1) / BATCH_MAX_WRITE_SIZE);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_batch_submit(PIDX_file_io_batch batch)
+{
+  for (int i = 0; i < batch->file_count; i++)
+    batch->file[i].failed = 1;
+
+#if defined PIDX_HAVE_IO_URING
+  uring_write_files(batch);
+#endif
+
+  // io_uring not available, or a file it could not write
+  for (int i = 0; i < batch->file_count; i++)
+  {
+    if (batch->file[i].failed == 1)
+    {
+      if (sync_write_file(&batch->file[i]) != PIDX_success)
+        return PIDX_err_io;
+    }
+  }
+
+  return PIDX_success;
+}
+
+
+
+void PIDX_file_io_batch_free(PIDX_file_io_batch batch)
+{
+  for (int i = 0; i < batch->file_count; i++)
+  {
+    free(batch->file[i].file_name);
+    free(batch->file[i].write);
+  }
+  free(batch->file);
+
+  for (int i = 0; i < batch->owned_count; i++)
+    free(batch->owned[i]);
+  free(batch->owned);
+
+  free(batch);
+}
+
+
+
+static PIDX_return_code sync_write_file(struct batch_file* f)
+{
+  int fp = open(f->file_name, O_CREAT | O_WRONLY, 0664);
+  if (fp < 0)
+  {
+    fprintf(stderr, "[%s] [%d] open() failed filename %s.\n", __FILE__, __LINE__, f->file_name);
+    return PIDX_err_io;
+  }
+
+  for (int w = 0; w < f->write_count; w++)
+  {
+    uint64_t done = 0;
+    while (done < f->write[w].size)
+    {
+      ssize_t write_count = pwrite(fp, f->write[w].buffer + done, f->write[w].size - done, f->write[w].offset + done);
+      if (write_count < 0 && errno == EINTR)
+        continue;
+      if (write_count <= 0)
+      {
+        fprintf(stderr, "[%s] [%d] pwrite() failed filename %s [%llu != %llu]\n", __FILE__, __LINE__, f->file_name, (unsigned long long) f->write[w].size, (unsigned long long) done);
+        close(fp);
+        return PIDX_err_io;
+      }
+      done = done + write_count;
+    }
+  }
+
+  if (close(fp) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] close() failed filename %s.\n", __FILE__, __LINE__, f->file_name);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+#if defined PIDX_HAVE_IO_URING
+
+struct uring
+{
+  int fd;
+  unsigned sq_entries;
+  unsigned cq_entries;
+
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+
+  void *sq_ring, *cq_ring;
+  size_t sq_ring_size, cq_ring_size, sqes_size;
+};
+
+
+static int uring_init(struct uring* ring, unsigned entries, int slot_count)
+{
+  struct io_uring_params p;
+  memset(ring, 0, sizeof (*ring));
+  memset(&p, 0, sizeof (p));
+  p.flags = IORING_SETUP_CLAMP;
+
+  ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+  if (ring->fd < 0)
+    return -1;
+
+  // Opening and closing into the registered file table (file_index) needs Linux 5.15, IORING_FEAT_CQE_SKIP (5.17)
+  // is the closest feature flag
+  if (!(p.features & IORING_FEAT_CQE_SKIP))
+  {
+    close(ring->fd);
+    return -1;
+  }
+
+  ring->sq_entries = p.sq_entries;
+  ring->cq_entries = p.cq_entries;
+  ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+  ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  ring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (ring->cq_ring_size > ring->sq_ring_size)
+      ring->sq_ring_size = ring->cq_ring_size;
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+
+  ring->sq_ring = mmap(0, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED)
+  {
+    close(ring->fd);
+    return -1;
+  }
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    ring->cq_ring = ring->sq_ring;
+  else
+  {
+    ring->cq_ring = mmap(0, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED)
+    {
+      munmap(ring->sq_ring, ring->sq_ring_size);
+      close(ring->fd);
+      return -1;
+    }
+  }
+
+  ring->sqes = mmap(0, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED)
+  {
+    if (ring->cq_ring != ring->sq_ring)
+      munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    return -1;
+  }
+
+  ring->sq_head = (unsigned*) ((char*) ring->sq_ring + p.sq_off.head);
+  ring->sq_tail = (unsigned*) ((char*) ring->sq_ring + p.sq_off.tail);
+  ring->sq_mask = (unsigned*) ((char*) ring->sq_ring + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned*) ((char*) ring->sq_ring + p.sq_off.array);
+  ring->cq_head = (unsigned*) ((char*) ring->cq_ring + p.cq_off.head);
+  ring->cq_tail = (unsigned*) ((char*) ring->cq_ring + p.cq_off.tail);
+  ring->cq_mask = (unsigned*) ((char*) ring->cq_ring + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*) ((char*) ring->cq_ring + p.cq_off.cqes);
+
+  // Empty file table, the files are opened into it by the open requests
+  int* fds = malloc(slot_count * sizeof (*fds));
+  for (int i = 0; i < slot_count; i++)
+    fds[i] = -1;
+  int ret = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, fds, slot_count);
+  free(fds);
+  if (ret < 0)
+  {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+      munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+static void uring_exit(struct uring* ring)
+{
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring)
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  munmap(ring->sq_ring, ring->sq_ring_size);
+
+  // also closes the files a failed request chain left open in the file table
+  close(ring->fd);
+}
+
+
+
+static struct io_uring_sqe* uring_get_sqe(struct uring* ring, unsigned* tail, uint64_t user_data)
+{
+  unsigned index = *tail & *ring->sq_mask;
+  struct io_uring_sqe* sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof (*sqe));
+  sqe->user_data = user_data;
+
+  ring->sq_array[index] = index;
+  (*tail)++;
+
+  return sqe;
+}
+
+
+
+// Queues open, writes and close of the file linked together, a failed (or short) request cancels the rest
+static void uring_queue_file(struct uring* ring, unsigned* tail, struct batch_file* f, int file_index)
+{
+  struct io_uring_sqe* sqe = uring_get_sqe(ring, tail, file_index);
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (uint64_t) (uintptr_t) f->file_name;
+  sqe->open_flags = O_CREAT | O_WRONLY;
+  sqe->len = 0664;
+  sqe->file_index = f->slot + 1;
+  sqe->flags = IOSQE_IO_LINK;
+
+  for (int w = 0; w < f->write_count; w++)
+  {
+    for (uint64_t done = 0; done < f->write[w].size; done = done + BATCH_MAX_WRITE_SIZE)
+    {
+      uint64_t size = f->write[w].size - done;
+      if (size > BATCH_MAX_WRITE_SIZE)
+        size = BATCH_MAX_WRITE_SIZE;
+
+      sqe = uring_get_sqe(ring, tail, file_index);
+      sqe->opcode = IORING_OP_WRITE;
+      sqe->fd = f->slot;
+      sqe->addr = (uint64_t) (uintptr_t) (f->write[w].buffer + done);
+      sqe->len = (uint32_t) size;
+      sqe->off = f->write[w].offset + done;
+      sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+    }
+  }
+
+  sqe = uring_get_sqe(ring, tail, file_index);
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->file_index = f->slot + 1;
+}
+
+
+
+// Writes the files of the batch through io_uring, the ones that fail stay marked failed. Blocks once if all the
+// requests fit in the ring, otherwise whenever the ring is full.
+static void uring_write_files(PIDX_file_io_batch batch)
+{
+  if (batch->file_count == 0)
+    return;
+
+  uint64_t total_request_count = 0;
+  int max_request_count = 0;
+  for (int i = 0; i < batch->file_count; i++)
+  {
+    total_request_count = total_request_count + batch->file[i].request_count;
+    if (batch->file[i].request_count > max_request_count)
+      max_request_count = batch->file[i].request_count;
+  }
+
+  unsigned entries = 8;
+  while (entries < total_request_count && entries < BATCH_RING_ENTRIES)
+    entries = 2 * entries;
+  while (entries < max_request_count && entries < 32768)
+    entries = 2 * entries;
+
+  int slot_count = (batch->file_count < BATCH_FILE_SLOTS) ? batch->file_count : BATCH_FILE_SLOTS;
+
+  struct uring ring;
+  if (uring_init(&ring, entries, slot_count) != 0)
+    return;
+
+  int free_slot_count = slot_count;
+  int* free_slot = malloc(slot_count * sizeof (*free_slot));
+  for (int i = 0; i < slot_count; i++)
+    free_slot[i] = slot_count - 1 - i;
+
+  int next = 0;
+  int done = 0;
+  unsigned in_flight = 0;
+  unsigned unsubmitted = 0;
+  unsigned tail = *ring.sq_tail;
+  while (done < batch->file_count)
+  {
+    // Queue the request chains of as many files as the ring takes
+    while (next < batch->file_count)
+    {
+      struct batch_file* f = &batch->file[next];
+      if (f->request_count > ring.sq_entries)
+      {
+        next++;
+        done++;
+        continue;
+      }
+
+      unsigned sq_free = ring.sq_entries - (tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE));
+      if (free_slot_count == 0 || f->request_count > sq_free || in_flight + f->request_count > ring.cq_entries)
+        break;
+
+      f->slot = free_slot[--free_slot_count];
+      f->completed_count = 0;
+      f->failed = 0;
+      uring_queue_file(&ring, &tail, f, next);
+      in_flight = in_flight + f->request_count;
+      unsubmitted = unsubmitted + f->request_count;
+      next++;
+    }
+
+    // Only files left that failed and kept their slots
+    if (in_flight == 0)
+      break;
+
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+    // Wait for all the requests once every file is queued, otherwise for room for the next file
+    unsigned wait = (next == batch->file_count) ? in_flight : 1;
+    int ret = syscall(__NR_io_uring_enter, ring.fd, unsubmitted, wait, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    unsubmitted = unsubmitted - ret;
+
+    unsigned head = *ring.cq_head;
+    unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != cq_tail; head++)
+    {
+      struct io_uring_cqe* cqe = &ring.cqes[head & *ring.cq_mask];
+      struct batch_file* f = &batch->file[cqe->user_data];
+      if (cqe->res < 0)
+        f->failed = 1;
+
+      f->completed_count++;
+      in_flight--;
+      if (f->completed_count == f->request_count)
+      {
+        done++;
+        // a failed chain can leave its file open in the slot
+        if (f->failed == 0)
+          free_slot[free_slot_count++] = f->slot;
+      }
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  // Files whose requests did not all complete are rewritten with pwrite
+  for (int i = 0; i < next; i++)
+  {
+    if (batch->file[i].completed_count != batch->file[i].request_count)
+      batch->file[i].failed = 1;
+  }
+
+  free(free_slot);
+  uring_exit(&ring);
+}
+
+#endif
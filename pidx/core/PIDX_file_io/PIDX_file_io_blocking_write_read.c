@@ -40,133 +40,163 @@
  */
 #include "../../PIDX_inc.h"
 
-static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf);
-static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf);
+
+
+// reads size bytes of contiguous blocks at offset of the file into buffer
+static PIDX_return_code read_run(PIDX_file_io_id io_id, PIDX_file_io_handle fh, PIDX_variable var, unsigned char* buffer, uint64_t offset, uint64_t size, const char* file_name)
+{
+  if (PIDX_file_io_read_at(fh, offset, buffer, size) != PIDX_success)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] PIDX_file_io_read_at() failed for filename %s.\n", (long long) offset, __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  // swapped run by run while the run is still in cache
+  if (io_id->idx->flip_endian == 1)
+    PIDX_file_io_flip_endian(var, buffer, size);
+
+  return PIDX_success;
+}
+
+
+
+// decompresses the packed blocks (packed_size[b] bytes each, one after the other in packed) to their slots of agg_buf,
+// a block without data (size 0) is left as it is
+static PIDX_return_code decode_packed_blocks(PIDX_file_io_id io_id, Agg_buffer agg_buf, uint64_t block_bytes, const unsigned char* packed, const uint64_t* packed_size, int block_count)
+{
+  PIDX_variable var = io_id->idx->variable[agg_buf->var_number];
+
+  uint64_t packed_offset = 0;
+  for (int b = 0; b < block_count; b++)
+  {
+    if (packed_size[b] != 0 && PIDX_compression_decode_block(io_id->idx, var, packed + packed_offset, packed_size[b], agg_buf->buffer + (uint64_t) b * block_bytes) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_compression_decode_block() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_io;
+    }
+    packed_offset = packed_offset + packed_size[b];
+  }
+
+  return PIDX_success;
+}
 
 
 
 PIDX_return_code PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template)
 {
-  uint64_t data_offset = 0;
   char file_name[PATH_MAX];
   int i = 0;
-  MPI_File fp;
+  PIDX_file_io_handle fh;
   uint32_t *headers;
-  int ret;
-  MPI_Status status;
 
   int tck = (io_id->idx->chunk_size[0] * io_id->idx->chunk_size[1] * io_id->idx->chunk_size[2]);
   if (agg_buf->var_number != -1 && agg_buf->file_number != -1)
   {
     generate_file_name(io_id->idx->blocks_per_file, filename_template, (unsigned int) agg_buf->file_number, file_name, PATH_MAX);
 
-    ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp);
-    if (ret != MPI_SUCCESS)
+    // the file stays open with its header for the next aggregation rounds and reads
+    if (PIDX_file_io_cache_get(io_id->idx, io_id->idx_c, file_name, &fh, &headers) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_cache_get() filename %s failed.\n", __FILE__, __LINE__, file_name);
       return PIDX_err_io;
     }
 
-    int total_header_size = (10 + (10 * io_id->idx->blocks_per_file)) * sizeof (uint32_t) * io_id->idx->variable_count;
-    headers = malloc(total_header_size);
-    memset(headers, 0, total_header_size);
+    PIDX_variable var = io_id->idx->variable[agg_buf->var_number];
+    uint64_t block_bytes = ((uint64_t) io_id->idx->samples_per_block * (var->bpv/8) * var->vps * tck) / io_id->idx->compression_factor;
 
-    ret = MPI_File_read_at(fp, 0, headers, total_header_size , MPI_BYTE, &status);
-    if (ret != MPI_SUCCESS)
-    {
-      fprintf(stderr, "Data offset = [%s] [%d] MPI_File_write_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
-      return PIDX_err_io;
-    }
-    int read_count = 0;
-    MPI_Get_count(&status, MPI_BYTE, &read_count);
-    if (read_count != total_header_size)
+    // the packed blocks of the variable size ZFP modes are read one after the other to a buffer of their own (a block
+    // can be larger than its slot) and decompressed to their slots once all of them are read
+    uint64_t* packed_size = NULL;
+    unsigned char* packed = NULL;
+    if (PIDX_compression_variable_size(io_id->idx))
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %dd\n", __FILE__, __LINE__, read_count, total_header_size);
-      return PIDX_err_io;
-    }
+      if (io_id->idx->flip_endian == 1)
+      {
+        fprintf(stderr, "[%s] [%d] the blocks of compression type %d can not be read with the other endianness.\n", __FILE__, __LINE__, io_id->idx->compression_type);
+        return PIDX_err_io;
+      }
+
+      packed_size = malloc(agg_buf->block_count * sizeof (*packed_size));
+      memset(packed_size, 0, agg_buf->block_count * sizeof (*packed_size));
 
-    int data_size = 0;
+      uint64_t packed_total = 0;
+      int block_count = 0;
+      int block_index = 0;
+      for (i = 0; i < io_id->idx->blocks_per_file && block_count < agg_buf->block_count; i++)
+      {
+        if (!PIDX_blocks_is_block_present(agg_buf->file_number * io_id->idx->blocks_per_file + i, io_id->idx->bits_per_block, block_layout))
+          continue;
+
+        block_index++;
+        if (block_index <= agg_buf->first_block)
+          continue;
+
+        packed_size[block_count] = PIDX_header_block_size(io_id->idx, headers, agg_buf->var_number, i);
+        packed_total = packed_total + packed_size[block_count];
+        block_count++;
+      }
+
+      packed = malloc(packed_total == 0 ? 1 : packed_total);
+      if (packed == NULL)
+      {
+        fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+        free(packed_size);
+        return PIDX_err_io;
+      }
+    }
+    unsigned char* buffer = (packed != NULL) ? packed : agg_buf->buffer;
+
+    // the present blocks of the round are read in runs, a run grows while the next block follows the previous one in
+    // the file and in the buffer (the previous block is full size)
+    uint64_t run_offset = 0;
+    uint64_t run_size = 0;
+    uint64_t run_buffer_index = 0;
+    uint64_t packed_index = 0;
     int block_count = 0;
-    for (i = 0; i < io_id->idx->blocks_per_file; i++)
+    int block_index = 0;
+    int ret = PIDX_success;
+    for (i = 0; i < io_id->idx->blocks_per_file && block_count < agg_buf->block_count; i++)
     {
-      if (PIDX_blocks_is_block_present(agg_buf->file_number * io_id->idx->blocks_per_file + i, io_id->idx->bits_per_block, block_layout))
+      if (!PIDX_blocks_is_block_present(agg_buf->file_number * io_id->idx->blocks_per_file + i, io_id->idx->bits_per_block, block_layout))
+        continue;
+
+      // only the blocks of the current aggregation round
+      block_index++;
+      if (block_index <= agg_buf->first_block)
+        continue;
+
+      uint64_t data_offset = PIDX_header_block_offset(io_id->idx, headers, agg_buf->var_number, i);
+      uint64_t data_size = PIDX_header_block_size(io_id->idx, headers, agg_buf->var_number, i);
+      uint64_t buffer_index = (packed != NULL) ? packed_index : (uint64_t) block_count * block_bytes;
+      packed_index = packed_index + data_size;
+
+      if (run_size != 0 && (data_offset != run_offset + run_size || buffer_index != run_buffer_index + run_size || run_size + data_size > PIDX_COALESCED_READ_LIMIT))
       {
-        data_offset = htonl(headers[12 + ((i + (io_id->idx->blocks_per_file * agg_buf->var_number))*10 )]);
-        data_size = htonl(headers[14 + ((i + (io_id->idx->blocks_per_file * agg_buf->var_number))*10 )]);
-
-        int buffer_index = (block_count * io_id->idx->samples_per_block * (io_id->idx->variable[agg_buf->var_number]->bpv/8) * io_id->idx->variable[agg_buf->var_number]->vps * tck) / io_id->idx->compression_factor;
-
-        //fprintf(stderr, "DO and DS %d %d\n", data_offset, data_size);
-        ret = MPI_File_read_at(fp, data_offset, agg_buf->buffer + buffer_index, data_size, MPI_BYTE, &status);
-        if (ret != MPI_SUCCESS)
-        {
-          fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at() failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
-          return PIDX_err_io;
-        }
-
-#if 0
-        if (io_id->idx_d->color == 1 && agg_buf->buffer_size != 0)
-        {
-          double x1, x2, x3, x4, x5, x6, x7, x8;
-          memcpy(&x1, agg_buf->buffer, sizeof(double));
-          memcpy(&x2, agg_buf->buffer + sizeof(double), sizeof(double));
-          memcpy(&x3, agg_buf->buffer + sizeof(double) * 2, sizeof(double));
-          memcpy(&x4, agg_buf->buffer + sizeof(double) * 3, sizeof(double));
-          memcpy(&x5, agg_buf->buffer + sizeof(double) * 4, sizeof(double));
-          memcpy(&x6, agg_buf->buffer + sizeof(double) * 5, sizeof(double));
-          memcpy(&x7, agg_buf->buffer + sizeof(double) * 6, sizeof(double));
-          memcpy(&x8, agg_buf->buffer + sizeof(double) * 7, sizeof(double));
-          fprintf(stderr, "x %f %f %f %f %f %f %f %f\n", x1, x2, x3, x4, x5, x6, x7, x8);
-        }
-#endif
-
-#if 0
-        int read_count = 0;
-        MPI_Get_count(&status, MPI_BYTE, &read_count);
-        if (read_count != data_size)
-        {
-          fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %d\n", __FILE__, __LINE__, read_count, total_header_size);
-          return PIDX_err_io;
-        }
-#endif
-
-        if (io_id->idx->flip_endian == 1)
-        {
-          PIDX_variable curr_var = io_id->idx->variable[agg_buf->var_number];
-          if (curr_var->bpv/8 == 4 || curr_var->bpv/8 == 12)
-          {
-            int y = 0;
-            float temp;
-            float temp2;
-
-            for (y = 0; y < data_size / sizeof(float); y++)
-            {
-              memcpy(&temp, agg_buf->buffer + buffer_index + (y * sizeof(float)), sizeof(float));
-              bit32_reverse_endian((unsigned char*)&temp, (unsigned char*)&temp2);
-              memcpy(agg_buf->buffer + buffer_index + (y * sizeof(float)), &temp2, sizeof(float));
-            }
-          }
-          else if (curr_var->bpv/8 == 8 || curr_var->bpv/8 == 24)
-          {
-            int y = 0;
-            double temp;
-            double temp2;
-
-            for (y = 0; y < data_size / sizeof(double); y++)
-            {
-              memcpy(&temp, agg_buf->buffer + buffer_index + (y * sizeof(double)), sizeof(double));
-              bit64_reverse_endian((unsigned char*)&temp, (unsigned char*)&temp2);
-              memcpy(agg_buf->buffer + buffer_index + (y * sizeof(double)), &temp2, sizeof(double));
-            }
-          }
-        }
+        ret = read_run(io_id, fh, var, buffer + run_buffer_index, run_offset, run_size, file_name);
+        if (ret != PIDX_success)
+          break;
+        run_size = 0;
+      }
 
-        block_count++;
+      if (run_size == 0)
+      {
+        run_offset = data_offset;
+        run_buffer_index = buffer_index;
       }
+      run_size = run_size + data_size;
+      block_count++;
     }
 
-    MPI_File_close(&fp);
-    free(headers);
+    if (ret == PIDX_success && run_size != 0)
+      ret = read_run(io_id, fh, var, buffer + run_buffer_index, run_offset, run_size, file_name);
+
+    if (ret == PIDX_success && packed != NULL)
+      ret = decode_packed_blocks(io_id, agg_buf, block_bytes, packed, packed_size, block_count);
+
+    free(packed);
+    free(packed_size);
+    if (ret != PIDX_success)
+      return PIDX_err_io;
   }
 
   return PIDX_success;
@@ -174,13 +204,11 @@ PIDX_return_code PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer ag
 
 
 
-PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template)
+// offset of the aggregation buffer in its file, after the header, the blocks of the previous variables and the blocks
+// of the previous aggregation rounds
+static uint64_t agg_buf_data_offset(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout)
 {
   uint64_t data_offset = 0;
-  char file_name[PATH_MAX];
-  int ret;
-  MPI_File fh;
-  MPI_Status status;
   int tck = (io_id->idx->chunk_size[0] * io_id->idx->chunk_size[1] * io_id->idx->chunk_size[2]);
 
   uint64_t total_header_size;
@@ -189,51 +217,75 @@ PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer a
   if (total_header_size % io_id->fs_block_size)
     start_fs_block++;
 
+  data_offset += start_fs_block * io_id->fs_block_size;
+
+  for (int k = 0; k < agg_buf->var_number; k++)
+  {
+    PIDX_variable vark = io_id->idx->variable[k];
+    int bytes_per_datatype =  ((vark->bpv/8) * tck) / (io_id->idx->compression_factor);
+    uint64_t prev_var_sample = (uint64_t) block_layout->bcpf[agg_buf->file_number] * io_id->idx->samples_per_block * bytes_per_datatype * io_id->idx->variable[k]->vps;
+
+    data_offset = (uint64_t) data_offset + prev_var_sample;
+  }
+
+  PIDX_variable var = io_id->idx->variable[agg_buf->var_number];
+  data_offset = data_offset + (uint64_t) agg_buf->first_block * io_id->idx->samples_per_block * (((var->bpv/8) * tck) / (io_id->idx->compression_factor)) * var->vps;
+
+  return data_offset;
+}
+
+
+
+PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template, const uint32_t* headers, uint64_t header_size)
+{
+  uint64_t data_offset = 0;
+  char file_name[PATH_MAX];
+  struct PIDX_file_io_handle_struct fh;
+
   if (agg_buf->var_number != -1 && agg_buf->file_number != -1)
   {
     generate_file_name(io_id->idx->blocks_per_file, filename_template, (unsigned int) agg_buf->file_number, file_name, PATH_MAX);
-    ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
-    if (ret != MPI_SUCCESS)
+    if (PIDX_file_io_open(io_id, file_name, PIDX_WRITE, &fh) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
       return PIDX_err_io;
     }
 
-    data_offset = 0;
-    data_offset += start_fs_block * io_id->fs_block_size;
+    data_offset = agg_buf_data_offset(io_id, agg_buf, block_layout);
 
-    for (int k = 0; k < agg_buf->var_number; k++)
-    {
-      PIDX_variable vark = io_id->idx->variable[k];
-      int bytes_per_datatype =  ((vark->bpv/8) * tck) / (io_id->idx->compression_factor);
-      uint64_t prev_var_sample = (uint64_t) block_layout->bcpf[agg_buf->file_number] * io_id->idx->samples_per_block * bytes_per_datatype * io_id->idx->variable[k]->vps;
+    // the buffer is not used after the write, it is swapped in place
+    if (io_id->idx->flip_endian == 1)
+      PIDX_file_io_flip_endian(io_id->idx->variable[agg_buf->var_number], agg_buf->buffer, agg_buf->buffer_size);
 
-      data_offset = (uint64_t) data_offset + prev_var_sample;
+    //fprintf(stderr, "DO %d DS %d\n", data_offset, agg_buf->buffer_size);
+    if (PIDX_file_io_write_at(&fh, data_offset, agg_buf->buffer, agg_buf->buffer_size) != PIDX_success)
+    {
+      fprintf(stderr, "Data offset = %lld [%s] [%d] PIDX_file_io_write_at() failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
+      return PIDX_err_io;
     }
 
-    //for (i = 0; i < agg_buf->sample_number; i++)
-    //  data_offset = (uint64_t) data_offset + agg_buf->buffer_size;
+    // the aggregator of the first block of the file also writes its header, while the file is open
+    if (headers != NULL && PIDX_file_io_write_at(&fh, 0, (const unsigned char*) headers, header_size) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_write_at() failed for the header of filename %s.\n", __FILE__, __LINE__, file_name);
+      return PIDX_err_io;
+    }
 
-    //fprintf(stderr, "DO %d DS %d\n", data_offset, agg_buf->buffer_size);
-    ret = MPI_File_write_at(fh, data_offset, agg_buf->buffer, agg_buf->buffer_size , MPI_BYTE, &status);
-    if (ret != MPI_SUCCESS)
+    if (PIDX_file_io_close(&fh) != PIDX_success)
     {
-      fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at() failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_close() failed.\n", __FILE__, __LINE__);
       return PIDX_err_io;
     }
 
-    int write_count = 0;
-    MPI_Get_count(&status, MPI_BYTE, &write_count);
-    if (write_count != agg_buf->buffer_size)
+    if (io_id->idx->staging_directory[0] != '\0' && PIDX_file_io_drain_add(io_id->idx, io_id->idx_c, file_name, data_offset, agg_buf->buffer_size) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed.\n", __FILE__, __LINE__);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_add() failed for filename %s.\n", __FILE__, __LINE__, file_name);
       return PIDX_err_io;
     }
 
-    ret = MPI_File_close(&fh);
-    if (ret != MPI_SUCCESS)
+    if (headers != NULL && io_id->idx->staging_directory[0] != '\0' && PIDX_file_io_drain_add(io_id->idx, io_id->idx_c, file_name, 0, header_size) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_open() failed.\n", __FILE__, __LINE__);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_add() failed for the header of filename %s.\n", __FILE__, __LINE__, file_name);
       return PIDX_err_io;
     }
   }
@@ -243,34 +295,223 @@ PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer a
 
 
 
-static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf)
+// writes the entries of count consecutive blocks of var starting at block from headers
+static PIDX_return_code write_header_entries(PIDX_file_io_id io_id, PIDX_file_io_handle fh, const uint32_t* headers, int var, int block, int count, const char* file_name)
 {
-  unsigned char *data = ((unsigned char *)val) + 3;
-  unsigned char *out = (unsigned char *)outbuf;
+  uint64_t first_word = 10 + ((uint64_t) block + (uint64_t) io_id->idx->blocks_per_file * var) * 10;
+  if (PIDX_file_io_write_at(fh, first_word * sizeof (uint32_t), (const unsigned char*) (headers + first_word), (uint64_t) count * 10 * sizeof (uint32_t)) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_write_at() failed for the header of filename %s.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
 
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out = *data;
+  if (io_id->idx->staging_directory[0] != '\0' && PIDX_file_io_drain_add(io_id->idx, io_id->idx_c, file_name, first_word * sizeof (uint32_t), (uint64_t) count * 10 * sizeof (uint32_t)) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_add() failed for the header of filename %s.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
 
-  return;
+  return PIDX_success;
 }
 
 
 
-static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf)
+PIDX_return_code PIDX_file_io_packed_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, char* filename_template, const unsigned char* data, const uint64_t* block_size, uint64_t data_offset)
 {
-  unsigned char *data = ((unsigned char *)val) + 7;
-  unsigned char *out = (unsigned char *)outbuf;
-
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out = *data;
-
-  return;
+  char file_name[PATH_MAX];
+  struct PIDX_file_io_handle_struct fh;
+
+  if (agg_buf->var_number == -1 || agg_buf->file_number == -1)
+    return PIDX_success;
+
+  uint64_t data_size = 0;
+  for (int b = 0; b < agg_buf->block_count; b++)
+    data_size = data_size + block_size[b];
+
+  generate_file_name(io_id->idx->blocks_per_file, filename_template, (unsigned int) agg_buf->file_number, file_name, PATH_MAX);
+  if (PIDX_file_io_open(io_id, file_name, PIDX_WRITE, &fh) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  if (data_size != 0 && PIDX_file_io_write_at(&fh, data_offset, data, data_size) != PIDX_success)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] PIDX_file_io_write_at() failed for filename %s.\n", (long long) data_offset, __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  if (io_id->idx->staging_directory[0] != '\0' && data_size != 0 && PIDX_file_io_drain_add(io_id->idx, io_id->idx_c, file_name, data_offset, data_size) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_add() failed for filename %s.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  // the entries of the blocks of the round (the blocks the reader finds in the same order), written in runs of
+  // consecutive blocks
+  uint64_t header_size = (10 + (10 * io_id->idx->blocks_per_file)) * sizeof (uint32_t) * io_id->idx->variable_count;
+  uint32_t* headers = malloc(header_size);
+  memset(headers, 0, header_size);
+
+  uint64_t offset = data_offset;
+  int run_block = 0;
+  int run_count = 0;
+  int block_count = 0;
+  int block_index = 0;
+  for (int i = 0; i < io_id->idx->blocks_per_file && block_count < agg_buf->block_count; i++)
+  {
+    if (!PIDX_blocks_is_block_present(agg_buf->file_number * io_id->idx->blocks_per_file + i, io_id->idx->bits_per_block, block_layout))
+      continue;
+
+    block_index++;
+    if (block_index <= agg_buf->first_block)
+      continue;
+
+    PIDX_header_set_block(headers, io_id->idx->blocks_per_file, agg_buf->var_number, i, offset, block_size[block_count]);
+    offset = offset + block_size[block_count];
+    block_count++;
+
+    if (run_count != 0 && i != run_block + run_count)
+    {
+      if (write_header_entries(io_id, &fh, headers, agg_buf->var_number, run_block, run_count, file_name) != PIDX_success)
+      {
+        free(headers);
+        return PIDX_err_io;
+      }
+      run_count = 0;
+    }
+
+    if (run_count == 0)
+      run_block = i;
+    run_count++;
+  }
+
+  if (run_count != 0 && write_header_entries(io_id, &fh, headers, agg_buf->var_number, run_block, run_count, file_name) != PIDX_success)
+  {
+    free(headers);
+    return PIDX_err_io;
+  }
+  free(headers);
+
+  if (PIDX_file_io_close(&fh) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_close() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+// MPI counts are int, a buffer of size bytes is described as one element of a datatype built from 1 GiB chunks
+// and the remaining bytes
+static PIDX_return_code byte_type_create(uint64_t size, MPI_Datatype* type)
+{
+  const uint64_t chunk_size = (uint64_t) 1 << 30;
+
+  MPI_Datatype chunk_type;
+  if (MPI_Type_contiguous((int) chunk_size, MPI_BYTE, &chunk_type) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Type_contiguous() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  int block_length[2] = {(int) (size / chunk_size), (int) (size % chunk_size)};
+  MPI_Aint displacement[2] = {0, (MPI_Aint) (size - size % chunk_size)};
+  MPI_Datatype block_type[2] = {chunk_type, MPI_BYTE};
+
+  int ret = MPI_Type_create_struct(2, block_length, displacement, block_type, type);
+  MPI_Type_free(&chunk_type);
+  if (ret != MPI_SUCCESS || MPI_Type_commit(type) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_Type_create_struct() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_collective_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, MPI_Comm file_comm, char* filename_template)
+{
+  char file_name[PATH_MAX];
+  MPI_File fh;
+  MPI_Status status;
+  MPI_Info info = io_id->idx_c->access->info;
+  PIDX_return_code ret = PIDX_success;
+
+  generate_file_name(io_id->idx->blocks_per_file, filename_template, (unsigned int) agg_buf->file_number, file_name, PATH_MAX);
+  if (PIDX_file_io_mpi_create(file_comm, file_name, info, &fh) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_mpi_create() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  // every aggregator sees the file from the start of its buffer on
+  uint64_t data_offset = agg_buf_data_offset(io_id, agg_buf, block_layout);
+  if (MPI_File_set_view(fh, data_offset, MPI_BYTE, MPI_BYTE, "native", info) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_set_view() failed for filename %s.\n", __FILE__, __LINE__, file_name);
+    ret = PIDX_err_io;
+    goto close_file;
+  }
+
+  if (io_id->idx->flip_endian == 1)
+    PIDX_file_io_flip_endian(io_id->idx->variable[agg_buf->var_number], agg_buf->buffer, agg_buf->buffer_size);
+
+  // buffers of 2 GiB or more do not fit in the count of the write
+  MPI_Datatype write_type = MPI_BYTE;
+  int write_elements = (int) agg_buf->buffer_size;
+  if (agg_buf->buffer_size > INT_MAX)
+  {
+    if (byte_type_create(agg_buf->buffer_size, &write_type) != PIDX_success)
+    {
+      ret = PIDX_err_io;
+      goto close_file;
+    }
+    write_elements = 1;
+  }
+
+  if (MPI_File_write_at_all(fh, 0, agg_buf->buffer, write_elements, write_type, &status) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at_all() failed for filename %s.\n", (long long) data_offset, __FILE__, __LINE__, file_name);
+    ret = PIDX_err_io;
+  }
+  else
+  {
+    // the bytes written, whatever the datatype of the write
+    MPI_Count write_count = 0;
+    MPI_Get_elements_x(&status, write_type, &write_count);
+    if ((uint64_t) write_count != agg_buf->buffer_size)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_File_write_at_all() failed. %lld != %lld\n", __FILE__, __LINE__, (long long) write_count, (long long) agg_buf->buffer_size);
+      ret = PIDX_err_io;
+    }
+  }
+
+  if (write_type != MPI_BYTE)
+    MPI_Type_free(&write_type);
+
+close_file:
+  if (MPI_File_close(&fh) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_close() failed.\n", __FILE__, __LINE__);
+    ret = PIDX_err_io;
+  }
+
+  return ret;
+}
+
+
+
+void PIDX_file_io_flip_endian(PIDX_variable var, unsigned char* buffer, uint64_t size)
+{
+  int values_per_sample = 0, bits_per_value = 0;
+  PIDX_get_datatype_details(var->type_name, &values_per_sample, &bits_per_value);
+
+  uint64_t value_size = bits_per_value / 8;
+  if (value_size > 1)
+    PIDX_copy_byteswap(buffer, buffer, size / value_size, value_size);
 }
@@ -0,0 +1,254 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2010-2019 ViSUS L.L.C.,
+ * Scientific Computing and Imaging Institute of the University of Utah
+ *
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ *
+ */
+
+#include "../../PIDX_inc.h"
+
+
+struct cache_entry
+{
+  char file_name[PATH_MAX];
+
+  struct PIDX_file_io_handle_struct fh;
+  int open;                                         /// fh is open
+  int view_count;                                   /// views of the mapped file given out, fh stays open
+
+  uint32_t* headers;
+  uint64_t header_size;
+
+  struct cache_entry *prev;
+  struct cache_entry *next;
+};
+
+struct PIDX_file_io_cache_struct
+{
+  struct cache_entry *head;                         /// most recently used
+  struct cache_entry *tail;                         /// least recently used
+
+  int entry_count;
+  int open_count;
+};
+
+
+static void entry_unlink(PIDX_file_io_cache cache, struct cache_entry* e)
+{
+  if (e->prev != NULL)
+    e->prev->next = e->next;
+  else
+    cache->head = e->next;
+
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  else
+    cache->tail = e->prev;
+
+  e->prev = NULL;
+  e->next = NULL;
+}
+
+
+static void entry_push_front(PIDX_file_io_cache cache, struct cache_entry* e)
+{
+  e->prev = NULL;
+  e->next = cache->head;
+  if (cache->head != NULL)
+    cache->head->prev = e;
+  cache->head = e;
+  if (cache->tail == NULL)
+    cache->tail = e;
+}
+
+
+static void entry_close(PIDX_file_io_cache cache, struct cache_entry* e)
+{
+  if (e->open == 0)
+    return;
+
+  PIDX_file_io_close(&e->fh);
+  e->open = 0;
+  cache->open_count--;
+}
+
+
+static void entry_free(PIDX_file_io_cache cache, struct cache_entry* e)
+{
+  entry_close(cache, e);
+  entry_unlink(cache, e);
+  free(e->headers);
+  free(e);
+  cache->entry_count--;
+}
+
+
+// Closes and drops the least recently used entries beyond the limits, keep is never evicted
+static void cache_evict(PIDX_file_io_cache cache, idx_dataset idx, struct cache_entry* keep)
+{
+  struct cache_entry* e = cache->tail;
+  while (e != NULL && cache->open_count > idx->file_cache_open_limit)
+  {
+    if (e != keep && e->view_count == 0)
+      entry_close(cache, e);
+    e = e->prev;
+  }
+
+  e = cache->tail;
+  while (e != NULL && cache->entry_count > idx->file_cache_header_limit)
+  {
+    struct cache_entry* prev = e->prev;
+    if (e != keep && e->view_count == 0)
+      entry_free(cache, e);
+    e = prev;
+  }
+}
+
+
+
+PIDX_return_code PIDX_file_io_cache_get(idx_dataset idx, idx_comm idx_c, const char* file_name, PIDX_file_io_handle* fh, uint32_t** headers)
+{
+  if (idx->file_cache == NULL)
+  {
+    idx->file_cache = malloc(sizeof (*idx->file_cache));
+    memset(idx->file_cache, 0, sizeof (*idx->file_cache));
+  }
+  PIDX_file_io_cache cache = idx->file_cache;
+
+  struct cache_entry* e = cache->head;
+  while (e != NULL && strcmp(e->file_name, file_name) != 0)
+    e = e->next;
+
+  if (e != NULL)
+    entry_unlink(cache, e);
+  else
+  {
+    e = malloc(sizeof (*e));
+    memset(e, 0, sizeof (*e));
+    strncpy(e->file_name, file_name, PATH_MAX - 1);
+    cache->entry_count++;
+  }
+  entry_push_front(cache, e);
+
+  if (e->open == 0)
+  {
+    struct PIDX_file_io_struct io;
+    memset(&io, 0, sizeof (io));
+    io.idx = idx;
+    io.idx_c = idx_c;
+    if (PIDX_file_io_open(&io, file_name, PIDX_READ, &e->fh) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+      entry_free(cache, e);
+      return PIDX_err_io;
+    }
+    e->open = 1;
+    cache->open_count++;
+  }
+
+  // the header size changes with the variable count and the blocks per file of the dataset
+  uint64_t header_size = (10 + (10 * idx->blocks_per_file)) * sizeof (uint32_t) * idx->variable_count;
+  if (e->headers == NULL || e->header_size != header_size)
+  {
+    free(e->headers);
+    e->header_size = header_size;
+    e->headers = malloc(header_size);
+    if (e->headers == NULL || PIDX_file_io_read_at(&e->fh, 0, (unsigned char*) e->headers, header_size) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] reading the header of %s failed.\n", __FILE__, __LINE__, file_name);
+      entry_free(cache, e);
+      return PIDX_err_io;
+    }
+  }
+
+  cache_evict(cache, idx, e);
+
+  *fh = &e->fh;
+  *headers = e->headers;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_cache_view(idx_dataset idx, idx_comm idx_c, const char* file_name, uint64_t offset, uint64_t size, const unsigned char** data)
+{
+  PIDX_file_io_handle fh;
+  uint32_t* headers;
+  if (PIDX_file_io_cache_get(idx, idx_c, file_name, &fh, &headers) != PIDX_success)
+    return PIDX_err_io;
+
+  if (PIDX_file_io_view_at(fh, offset, size, data) != PIDX_success)
+    return PIDX_err_io;
+
+  // fh is the handle of the most recently used entry
+  idx->file_cache->head->view_count++;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_cache_release(PIDX_file_io_cache cache, const unsigned char* data)
+{
+  struct cache_entry* e = (cache != NULL) ? cache->head : NULL;
+  while (e != NULL && !(e->view_count != 0 && e->fh.map != NULL && data >= e->fh.map && data <= e->fh.map + e->fh.map_size))
+    e = e->next;
+
+  if (e == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] the view was not given out by the cache.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  e->view_count--;
+
+  return PIDX_success;
+}
+
+
+
+void PIDX_file_io_cache_free(PIDX_file_io_cache cache)
+{
+  if (cache == NULL)
+    return;
+
+  while (cache->head != NULL)
+    entry_free(cache, cache->head);
+
+  free(cache);
+}
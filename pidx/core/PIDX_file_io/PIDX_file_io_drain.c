@@ -0,0 +1,636 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2010-2019 ViSUS L.L.C.,
+ * Scientific Computing and Imaging Institute of the University of Utah
+ *
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ *
+ */
+
+#include "../../PIDX_inc.h"
+
+#include <dirent.h>
+
+#if defined PIDX_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+// Largest piece of a staged file copied at a time
+#define DRAIN_COPY_SIZE (8ULL << 20)
+
+#define DRAIN_MANIFEST_PREFIX "pidx-drain-"
+#define DRAIN_MANIFEST_SUFFIX ".manifest"
+
+
+struct drain_extent
+{
+  uint64_t id;
+  uint64_t offset;
+  uint64_t size;
+  int drained;
+  int seal;                                         /// not a piece, the staged files queued before it are complete
+
+  char staged_file_name[PATH_MAX];
+  char file_name[PATH_MAX];                         /// file of the dataset
+
+  struct drain_extent *next;
+};
+
+struct PIDX_file_io_drain_struct
+{
+  char staging_directory[PATH_MAX];                 /// staging directory of the manifest (absolute)
+  char rank_directory[PATH_MAX];                    /// <staging directory>/<rank>, the staged files of the process
+  char manifest_name[PATH_MAX];
+  FILE* manifest;
+
+  uint64_t next_id;
+
+  struct drain_extent *queue_head;                  /// not copied yet, in the order they were written
+  struct drain_extent *queue_tail;
+  struct drain_extent *drained;                     /// copied, their staged files are removed at the next seal
+
+  int error;                                        /// a copy failed, the staged files and the manifest are kept
+
+#if defined PIDX_HAVE_PTHREADS
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int stop;
+#endif
+};
+
+
+static PIDX_return_code absolute_path(const char* path, char* absolute);
+static PIDX_return_code copy_extent(struct drain_extent* e);
+static void remove_staged_file(const char* staging_directory, const char* staged_file_name);
+static void remove_drained_files(struct PIDX_file_io_drain_struct* drain);
+static void remove_empty_directories(const char* path);
+static PIDX_return_code replay_manifest(const char* staging_directory, const char* manifest_name);
+static void free_extents(struct drain_extent* e);
+
+#if defined PIDX_HAVE_PTHREADS
+static void* drain_thread(void* arg);
+#endif
+
+
+
+static PIDX_return_code drain_start(PIDX_access access, const char* staging_directory, int rank)
+{
+  struct PIDX_file_io_drain_struct* drain = malloc(sizeof (*drain));
+  memset(drain, 0, sizeof (*drain));
+
+  if (absolute_path(staging_directory, drain->staging_directory) != PIDX_success)
+  {
+    free(drain);
+    return PIDX_err_io;
+  }
+  if (snprintf(drain->manifest_name, PATH_MAX, "%s/%s%d%s", drain->staging_directory, DRAIN_MANIFEST_PREFIX, rank, DRAIN_MANIFEST_SUFFIX) >= PATH_MAX || snprintf(drain->rank_directory, PATH_MAX, "%s/%d", drain->staging_directory, rank) >= PATH_MAX)
+  {
+    fprintf(stderr, "[%s] [%d] the manifest name of %s is too long.\n", __FILE__, __LINE__, drain->staging_directory);
+    free(drain);
+    return PIDX_err_io;
+  }
+
+  // the pieces left by an earlier run of this process that did not finish its drain
+  struct stat st;
+  if (stat(drain->manifest_name, &st) == 0 && replay_manifest(drain->staging_directory, drain->manifest_name) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] the drain of %s could not be resumed.\n", __FILE__, __LINE__, drain->manifest_name);
+    free(drain);
+    return PIDX_err_io;
+  }
+
+  drain->manifest = fopen(drain->manifest_name, "w");
+  if (drain->manifest == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] fopen() failed for %s (%s).\n", __FILE__, __LINE__, drain->manifest_name, strerror(errno));
+    free(drain);
+    return PIDX_err_io;
+  }
+
+#if defined PIDX_HAVE_PTHREADS
+  pthread_mutex_init(&drain->mutex, NULL);
+  pthread_cond_init(&drain->cond, NULL);
+  if (pthread_create(&drain->thread, NULL, drain_thread, drain) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] pthread_create() failed.\n", __FILE__, __LINE__);
+    fclose(drain->manifest);
+    pthread_mutex_destroy(&drain->mutex);
+    pthread_cond_destroy(&drain->cond);
+    free(drain);
+    return PIDX_err_io;
+  }
+#endif
+
+  access->drain = drain;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_drain_add(idx_dataset idx, idx_comm idx_c, const char* file_name, uint64_t offset, uint64_t size)
+{
+  PIDX_access access = idx_c->access;
+  size_t staging_length = strlen(idx->staging_directory);
+
+  // file_name is <staging directory>/<rank>/<file of the dataset> (see write_headers)
+  const char* dataset_file_name = NULL;
+  if (strncmp(file_name, idx->staging_directory, staging_length) == 0 && file_name[staging_length] == '/')
+    dataset_file_name = strchr(file_name + staging_length + 1, '/');
+
+  if (dataset_file_name == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] %s is not in the staging directory %s.\n", __FILE__, __LINE__, file_name, idx->staging_directory);
+    return PIDX_err_io;
+  }
+
+  if (size == 0)
+    return PIDX_success;
+
+  if (access->drain == NULL && drain_start(access, idx->staging_directory, idx_c->simulation_rank) != PIDX_success)
+    return PIDX_err_io;
+
+  struct PIDX_file_io_drain_struct* drain = access->drain;
+
+  struct drain_extent* e = malloc(sizeof (*e));
+  memset(e, 0, sizeof (*e));
+  e->offset = offset;
+  e->size = size;
+  if (absolute_path(file_name, e->staged_file_name) != PIDX_success || absolute_path(dataset_file_name + 1, e->file_name) != PIDX_success)
+  {
+    free(e);
+    return PIDX_err_io;
+  }
+
+#if defined PIDX_HAVE_PTHREADS
+  pthread_mutex_lock(&drain->mutex);
+#endif
+
+  e->id = drain->next_id++;
+  fprintf(drain->manifest, "W %llu %llu %llu\t%s\t%s\n", (unsigned long long)e->id, (unsigned long long)e->offset, (unsigned long long)e->size, e->staged_file_name, e->file_name);
+  fflush(drain->manifest);
+
+#if defined PIDX_HAVE_PTHREADS
+  if (drain->queue_tail == NULL)
+    drain->queue_head = e;
+  else
+    drain->queue_tail->next = e;
+  drain->queue_tail = e;
+
+  pthread_cond_signal(&drain->cond);
+  pthread_mutex_unlock(&drain->mutex);
+#else
+  if (copy_extent(e) == PIDX_success)
+  {
+    e->drained = 1;
+    fprintf(drain->manifest, "D %llu\n", (unsigned long long)e->id);
+    fflush(drain->manifest);
+  }
+  else
+    drain->error = 1;
+
+  e->next = drain->drained;
+  drain->drained = e;
+#endif
+
+  return PIDX_success;
+}
+
+
+
+#if defined PIDX_HAVE_PTHREADS
+static void* drain_thread(void* arg)
+{
+  struct PIDX_file_io_drain_struct* drain = arg;
+
+  pthread_mutex_lock(&drain->mutex);
+  while (1)
+  {
+    while (drain->queue_head == NULL && drain->stop == 0)
+      pthread_cond_wait(&drain->cond, &drain->mutex);
+
+    struct drain_extent* e = drain->queue_head;
+    if (e == NULL)
+      break;
+
+    drain->queue_head = e->next;
+    if (drain->queue_head == NULL)
+      drain->queue_tail = NULL;
+
+    // every piece queued before the seal is copied (the queue is in order)
+    if (e->seal == 1)
+    {
+      remove_drained_files(drain);
+      free(e);
+      continue;
+    }
+
+    // the copy does not hold the lock, the writers keep queuing
+    pthread_mutex_unlock(&drain->mutex);
+    PIDX_return_code ret = copy_extent(e);
+    pthread_mutex_lock(&drain->mutex);
+
+    if (ret == PIDX_success)
+    {
+      e->drained = 1;
+      fprintf(drain->manifest, "D %llu\n", (unsigned long long)e->id);
+      fflush(drain->manifest);
+    }
+    else
+      drain->error = 1;
+
+    e->next = drain->drained;
+    drain->drained = e;
+  }
+  pthread_mutex_unlock(&drain->mutex);
+
+  return NULL;
+}
+#endif
+
+
+
+PIDX_return_code PIDX_file_io_drain_seal(PIDX_access access)
+{
+  struct PIDX_file_io_drain_struct* drain = access->drain;
+  if (drain == NULL)
+    return PIDX_success;
+
+#if defined PIDX_HAVE_PTHREADS
+  struct drain_extent* e = malloc(sizeof (*e));
+  if (e == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+  memset(e, 0, sizeof (*e));
+  e->seal = 1;
+
+  pthread_mutex_lock(&drain->mutex);
+  if (drain->queue_tail == NULL)
+    drain->queue_head = e;
+  else
+    drain->queue_tail->next = e;
+  drain->queue_tail = e;
+
+  pthread_cond_signal(&drain->cond);
+  pthread_mutex_unlock(&drain->mutex);
+#else
+  remove_drained_files(drain);
+#endif
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_file_io_drain_wait(PIDX_access access)
+{
+  struct PIDX_file_io_drain_struct* drain = access->drain;
+  if (drain == NULL)
+    return PIDX_success;
+
+#if defined PIDX_HAVE_PTHREADS
+  pthread_mutex_lock(&drain->mutex);
+  drain->stop = 1;
+  pthread_cond_signal(&drain->cond);
+  pthread_mutex_unlock(&drain->mutex);
+
+  pthread_join(drain->thread, NULL);
+  pthread_mutex_destroy(&drain->mutex);
+  pthread_cond_destroy(&drain->cond);
+#endif
+
+  fclose(drain->manifest);
+
+  PIDX_return_code ret = PIDX_success;
+  if (drain->error == 0)
+  {
+    remove_drained_files(drain);
+
+    // the directories of the staged files removed while writing are left to here, a writer may be creating them
+    remove_empty_directories(drain->rank_directory);
+    unlink(drain->manifest_name);
+  }
+  else
+  {
+    fprintf(stderr, "[%s] [%d] some staged files could not be copied, they are kept with %s (see PIDX_drain_resume).\n", __FILE__, __LINE__, drain->manifest_name);
+    ret = PIDX_err_io;
+  }
+
+  free_extents(drain->drained);
+  free(drain);
+  access->drain = NULL;
+
+  return ret;
+}
+
+
+
+PIDX_return_code PIDX_file_io_drain_resume(const char* staging_directory)
+{
+  char directory[PATH_MAX];
+  if (absolute_path(staging_directory, directory) != PIDX_success)
+    return PIDX_err_io;
+
+  DIR* dir = opendir(directory);
+  if (dir == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] opendir() failed for %s (%s).\n", __FILE__, __LINE__, directory, strerror(errno));
+    return PIDX_err_io;
+  }
+
+  PIDX_return_code ret = PIDX_success;
+  size_t prefix_length = strlen(DRAIN_MANIFEST_PREFIX);
+  size_t suffix_length = strlen(DRAIN_MANIFEST_SUFFIX);
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    size_t length = strlen(entry->d_name);
+    if (length <= prefix_length + suffix_length || strncmp(entry->d_name, DRAIN_MANIFEST_PREFIX, prefix_length) != 0 || strcmp(entry->d_name + length - suffix_length, DRAIN_MANIFEST_SUFFIX) != 0)
+      continue;
+
+    char manifest_name[PATH_MAX];
+    if (snprintf(manifest_name, PATH_MAX, "%s/%s", directory, entry->d_name) >= PATH_MAX || replay_manifest(directory, manifest_name) != PIDX_success)
+      ret = PIDX_err_io;
+  }
+  closedir(dir);
+
+  return ret;
+}
+
+
+
+static PIDX_return_code replay_manifest(const char* staging_directory, const char* manifest_name)
+{
+  FILE* manifest = fopen(manifest_name, "r");
+  if (manifest == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] fopen() failed for %s (%s).\n", __FILE__, __LINE__, manifest_name, strerror(errno));
+    return PIDX_err_io;
+  }
+
+  struct drain_extent* extents = NULL;
+  char line[2 * PATH_MAX + 128];
+  while (fgets(line, sizeof (line), manifest) != NULL)
+  {
+    // the last line may be incomplete if the writer stopped while writing it
+    size_t length = strlen(line);
+    if (length == 0 || line[length - 1] != '\n')
+      break;
+    line[length - 1] = '\0';
+
+    unsigned long long id = 0, offset = 0, size = 0;
+    if (line[0] == 'W' && sscanf(line, "W %llu %llu %llu", &id, &offset, &size) == 3)
+    {
+      char* staged_file_name = strchr(line, '\t');
+      char* file_name = (staged_file_name != NULL) ? strchr(staged_file_name + 1, '\t') : NULL;
+      if (file_name == NULL)
+        continue;
+      *file_name = '\0';
+
+      struct drain_extent* e = malloc(sizeof (*e));
+      memset(e, 0, sizeof (*e));
+      e->id = id;
+      e->offset = offset;
+      e->size = size;
+      snprintf(e->staged_file_name, PATH_MAX, "%s", staged_file_name + 1);
+      snprintf(e->file_name, PATH_MAX, "%s", file_name + 1);
+      e->next = extents;
+      extents = e;
+    }
+    else if (line[0] == 'D' && sscanf(line, "D %llu", &id) == 1)
+    {
+      struct drain_extent* e;
+      for (e = extents; e != NULL; e = e->next)
+        if (e->id == id)
+          e->drained = 1;
+    }
+  }
+  fclose(manifest);
+
+  PIDX_return_code ret = PIDX_success;
+  struct drain_extent* e;
+  for (e = extents; e != NULL; e = e->next)
+    if (e->drained == 0 && copy_extent(e) != PIDX_success)
+      ret = PIDX_err_io;
+
+  if (ret == PIDX_success)
+  {
+    for (e = extents; e != NULL; e = e->next)
+      remove_staged_file(staging_directory, e->staged_file_name);
+
+    unlink(manifest_name);
+  }
+
+  free_extents(extents);
+
+  return ret;
+}
+
+
+
+static PIDX_return_code copy_extent(struct drain_extent* e)
+{
+  int in = open(e->staged_file_name, O_RDONLY | O_BINARY);
+  if (in == -1)
+  {
+    fprintf(stderr, "[%s] [%d] open() failed for %s (%s).\n", __FILE__, __LINE__, e->staged_file_name, strerror(errno));
+    return PIDX_err_io;
+  }
+
+  if (PIDX_file_io_make_directories(e->file_name) != PIDX_success)
+  {
+    close(in);
+    return PIDX_err_io;
+  }
+
+  // not truncated, the other pieces of the file are copied by the processes that wrote them
+  int out = open(e->file_name, O_WRONLY | O_CREAT | O_BINARY, 0664);
+  if (out == -1)
+  {
+    fprintf(stderr, "[%s] [%d] open() failed for %s (%s).\n", __FILE__, __LINE__, e->file_name, strerror(errno));
+    close(in);
+    return PIDX_err_io;
+  }
+
+  uint64_t buffer_size = (e->size < DRAIN_COPY_SIZE) ? e->size : DRAIN_COPY_SIZE;
+  unsigned char* buffer = malloc(buffer_size);
+
+  PIDX_return_code ret = PIDX_success;
+  uint64_t done = 0;
+  while (done < e->size && ret == PIDX_success)
+  {
+    size_t count = (e->size - done < buffer_size) ? (size_t)(e->size - done) : (size_t)buffer_size;
+    ssize_t read_count = pread(in, buffer, count, (off_t)(e->offset + done));
+    if (read_count <= 0)
+    {
+      fprintf(stderr, "[%s] [%d] pread() failed for %s.\n", __FILE__, __LINE__, e->staged_file_name);
+      ret = PIDX_err_io;
+      break;
+    }
+
+    ssize_t written = 0;
+    while (written < read_count)
+    {
+      ssize_t write_count = pwrite(out, buffer + written, read_count - written, (off_t)(e->offset + done + written));
+      if (write_count <= 0)
+      {
+        fprintf(stderr, "[%s] [%d] pwrite() failed for %s.\n", __FILE__, __LINE__, e->file_name);
+        ret = PIDX_err_io;
+        break;
+      }
+      written += write_count;
+    }
+    done += read_count;
+  }
+
+  free(buffer);
+  close(in);
+  if (close(out) != 0)
+    ret = PIDX_err_io;
+
+  return ret;
+}
+
+
+
+static PIDX_return_code absolute_path(const char* path, char* absolute)
+{
+  if (path[0] == '/')
+  {
+    if (snprintf(absolute, PATH_MAX, "%s", path) >= PATH_MAX)
+      return PIDX_err_io;
+    return PIDX_success;
+  }
+
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, PATH_MAX) == NULL || snprintf(absolute, PATH_MAX, "%s/%s", cwd, path) >= PATH_MAX)
+  {
+    fprintf(stderr, "[%s] [%d] the absolute path of %s is too long.\n", __FILE__, __LINE__, path);
+    return PIDX_err_io;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static void remove_staged_file(const char* staging_directory, const char* staged_file_name)
+{
+  // a staged file is listed once per piece, it is gone after the first (the staged files of a process are below its
+  // own <staging directory>/<rank>)
+  if (unlink(staged_file_name) != 0 && errno != ENOENT)
+    return;
+
+  // the directories left empty, up to the staging directory
+  char path[PATH_MAX];
+  snprintf(path, PATH_MAX, "%s", staged_file_name);
+
+  size_t staging_length = strlen(staging_directory);
+  char* slash;
+  while ((slash = strrchr(path, '/')) != NULL)
+  {
+    // the file name templates may hold repeated slashes
+    while (slash > path && slash[-1] == '/')
+      slash--;
+    *slash = '\0';
+    if (strlen(path) <= staging_length || rmdir(path) != 0)
+      break;
+  }
+}
+
+
+
+// Removes the staged files of the copied pieces, but the ones that still have pieces to copy. Called with the lock
+// held (by the drain thread) or without a thread. The files are kept if a copy failed, for PIDX_drain_resume.
+static void remove_drained_files(struct PIDX_file_io_drain_struct* drain)
+{
+  if (drain->error != 0)
+    return;
+
+  struct drain_extent* e;
+  for (e = drain->drained; e != NULL; e = e->next)
+  {
+    struct drain_extent* q;
+    for (q = drain->queue_head; q != NULL; q = q->next)
+      if (q->seal == 0 && strcmp(q->staged_file_name, e->staged_file_name) == 0)
+        break;
+
+    if (q == NULL && unlink(e->staged_file_name) != 0 && errno != ENOENT)
+      fprintf(stderr, "[%s] [%d] unlink() failed for %s (%s).\n", __FILE__, __LINE__, e->staged_file_name, strerror(errno));
+  }
+
+  free_extents(drain->drained);
+  drain->drained = NULL;
+}
+
+
+
+// Removes the empty directories below path and path if it is left empty
+static void remove_empty_directories(const char* path)
+{
+  DIR* dir = opendir(path);
+  if (dir == NULL)
+    return;
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+
+    char child[PATH_MAX];
+    struct stat st;
+    if (snprintf(child, PATH_MAX, "%s/%s", path, entry->d_name) < PATH_MAX && lstat(child, &st) == 0 && S_ISDIR(st.st_mode))
+      remove_empty_directories(child);
+  }
+  closedir(dir);
+
+  rmdir(path);
+}
+
+
+
+static void free_extents(struct drain_extent* e)
+{
+  while (e != NULL)
+  {
+    struct drain_extent* next = e->next;
+    free(e);
+    e = next;
+  }
+}
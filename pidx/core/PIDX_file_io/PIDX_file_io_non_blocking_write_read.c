@@ -44,8 +44,6 @@
 static FILE* io_dump_fp;
 #endif
 
-static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf);
-static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf);
 
 
 PIDX_return_code PIDX_file_io_async_write(PIDX_file_io_id io_id, Agg_buffer agg_buf, PIDX_block_layout block_layout, MPI_Request* request, MPI_File* fh, char* filename_template)
@@ -60,10 +58,9 @@ PIDX_return_code PIDX_file_io_async_write(PIDX_file_io_id io_id, Agg_buffer agg_
   {
     generate_file_name(io_id->idx->blocks_per_file, filename_template, (unsigned int)agg_buf->file_number, file_name, PATH_MAX);
 
-    ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_WRONLY, MPI_INFO_NULL, (fh));
-    if (ret != MPI_SUCCESS)
+    if (PIDX_file_io_mpi_create(MPI_COMM_SELF, file_name, io_id->idx_c->access->info, fh) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_mpi_create() filename %s failed.\n", __FILE__, __LINE__, file_name);
       return PIDX_err_io;
     }
 
@@ -84,39 +81,15 @@ PIDX_return_code PIDX_file_io_async_write(PIDX_file_io_id io_id, Agg_buffer agg_
       data_offset = (uint64_t) data_offset + prev_var_sample;
     }
 
+    // the blocks of the previous aggregation rounds
+    PIDX_variable var = io_id->idx->variable[agg_buf->var_number];
+    data_offset = data_offset + (uint64_t) agg_buf->first_block * io_id->idx->samples_per_block * (((var->bpv/8) * tck) / (io_id->idx->compression_factor)) * var->vps;
+
     //for (i = 0; i < agg_buf->sample_number; i++)
     //  data_offset = (uint64_t) data_offset + agg_buf->buffer_size;
 
     if (io_id->idx->flip_endian == 1)
-    {
-      PIDX_variable curr_var = io_id->idx->variable[agg_buf->var_number];
-      if (curr_var->bpv/8 == 4 || curr_var->bpv/8 == 12)
-      {
-        int y = 0;
-        float temp;
-        float temp2;
-
-        for (y = 0; y < agg_buf->buffer_size / sizeof(float); y++)
-        {
-          memcpy(&temp, agg_buf->buffer + (y * sizeof(float)), sizeof(float));
-          bit32_reverse_endian((unsigned char*)&temp, (unsigned char*)&temp2);
-          memcpy(agg_buf->buffer + (y * sizeof(float)), &temp2, sizeof(float));
-        }
-      }
-      else if (curr_var->bpv/8 == 8 || curr_var->bpv/8 == 24)
-      {
-        int y = 0;
-        double temp;
-        double temp2;
-
-        for (y = 0; y < agg_buf->buffer_size / sizeof(double); y++)
-        {
-          memcpy(&temp, agg_buf->buffer + (y * sizeof(double)), sizeof(double));
-          bit64_reverse_endian((unsigned char*)&temp, (unsigned char*)&temp2);
-          memcpy(agg_buf->buffer + (y * sizeof(double)), &temp2, sizeof(double));
-        }
-      }
-    }
+      PIDX_file_io_flip_endian(io_id->idx->variable[agg_buf->var_number], agg_buf->buffer, agg_buf->buffer_size);
 
     ret = MPI_File_iwrite_at(*fh, data_offset, agg_buf->buffer, agg_buf->buffer_size, MPI_BYTE, request);
     if (ret != MPI_SUCCESS)
@@ -130,34 +103,113 @@ PIDX_return_code PIDX_file_io_async_write(PIDX_file_io_id io_id, Agg_buffer agg_
 }
 
 
-static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf)
+
+PIDX_return_code PIDX_file_io_pending_add(PIDX_access access, Agg_buffer agg_buf, MPI_File fh, MPI_Request request)
 {
-    unsigned char *data = ((unsigned char *)val) + 3;
-    unsigned char *out = (unsigned char *)outbuf;
+  PIDX_file_io_pending pending = malloc(sizeof (*pending));
+  memset(pending, 0, sizeof (*pending));
+
+  pending->agg_buf = agg_buf;
+  pending->fh = fh;
+  pending->request = request;
 
-    *out++ = *data--;
-    *out++ = *data--;
-    *out++ = *data--;
-    *out = *data;
+  pending->next = access->pending_io;
+  access->pending_io = pending;
 
-    return;
+  return PIDX_success;
 }
 
 
 
-static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf)
+// releases the file and the aggregation buffer of a completed write, they are released even if the write failed
+// (status is NULL if the request could not be completed)
+static PIDX_return_code pending_complete(PIDX_file_io_pending pending, MPI_Status* status)
 {
-    unsigned char *data = ((unsigned char *)val) + 7;
-    unsigned char *out = (unsigned char *)outbuf;
-
-    *out++ = *data--;
-    *out++ = *data--;
-    *out++ = *data--;
-    *out++ = *data--;
-    *out++ = *data--;
-    *out++ = *data--;
-    *out++ = *data--;
-    *out = *data;
-
-    return;
+  PIDX_return_code ret = PIDX_success;
+
+  int write_count = 0;
+  if (status != NULL)
+    MPI_Get_count(status, MPI_BYTE, &write_count);
+  if (status == NULL || (uint64_t) write_count != pending->agg_buf->buffer_size)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_iwrite_at() failed. %d != %lld\n", __FILE__, __LINE__, write_count, (long long) pending->agg_buf->buffer_size);
+    ret = PIDX_err_io;
+  }
+
+  if (MPI_File_close(&(pending->fh)) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_close() failed.\n", __FILE__, __LINE__);
+    ret = PIDX_err_io;
+  }
+
+  PIDX_agg_buf_destroy(pending->agg_buf);
+  free(pending->agg_buf);
+  free(pending);
+
+  return ret;
+}
+
+
+
+// every pending write is waited on and released, the first error is returned
+PIDX_return_code PIDX_file_io_pending_wait(PIDX_access access)
+{
+  PIDX_return_code ret = PIDX_success;
+  MPI_Status status;
+
+  while (access->pending_io != NULL)
+  {
+    PIDX_file_io_pending pending = access->pending_io;
+    access->pending_io = pending->next;
+
+    MPI_Status* completed = &status;
+    if (MPI_Wait(&(pending->request), &status) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Wait() failed.\n", __FILE__, __LINE__);
+      completed = NULL;
+    }
+
+    if (pending_complete(pending, completed) != PIDX_success && ret == PIDX_success)
+      ret = PIDX_err_io;
+  }
+
+  return ret;
+}
+
+
+
+PIDX_return_code PIDX_file_io_pending_test(PIDX_access access, int* flag)
+{
+  PIDX_return_code ret = PIDX_success;
+  MPI_Status status;
+  int done = 0;
+
+  PIDX_file_io_pending *link = &(access->pending_io);
+  while (*link != NULL)
+  {
+    PIDX_file_io_pending pending = *link;
+
+    // a request that can not be tested is released as a failed write
+    MPI_Status* completed = &status;
+    if (MPI_Test(&(pending->request), &done, &status) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "[%s] [%d] MPI_Test() failed.\n", __FILE__, __LINE__);
+      completed = NULL;
+      done = 1;
+    }
+
+    if (done == 0)
+    {
+      link = &(pending->next);
+      continue;
+    }
+
+    *link = pending->next;
+    if (pending_complete(pending, completed) != PIDX_success && ret == PIDX_success)
+      ret = PIDX_err_io;
+  }
+
+  *flag = (access->pending_io == NULL);
+
+  return ret;
 }
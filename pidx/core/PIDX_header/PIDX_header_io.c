@@ -46,6 +46,7 @@
 
 static uint32_t* headers;
 static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, int file_number, char* bin_file, int mode);
+static void build_header(idx_dataset idx, PIDX_block_layout block_layout, int fs_block_size, int file_number, int first_index, int last_index, uint32_t* file_headers, uint64_t*** block_offset_bitmap);
 
 
 struct PIDX_header_io_struct 
@@ -59,7 +60,6 @@ struct PIDX_header_io_struct
   PIDX_restructured_grid restructured_grid;
 
   int fs_block_size;
-  int start_fs_block;
 
   int first_index;
   int last_index;
@@ -90,10 +90,6 @@ PIDX_header_io_id PIDX_header_io_init(idx_dataset idx_meta_data, idx_comm idx_c,
   {
     uint64_t total_header_size;
     total_header_size = (10 + (10 * header_io_id->idx->blocks_per_file)) * sizeof (uint32_t) * header_io_id->idx->variable_count;
-    header_io_id->start_fs_block = total_header_size / header_io_id->fs_block_size;
-    if (total_header_size % header_io_id->fs_block_size)
-      header_io_id->start_fs_block++;
-
     headers = (uint32_t*)malloc(total_header_size);
     memset(headers, 0, total_header_size);
   }
@@ -103,69 +99,6 @@ PIDX_header_io_id PIDX_header_io_init(idx_dataset idx_meta_data, idx_comm idx_c,
 
 
 
-int PIDX_header_io_idx_file_create(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* filename_template)
-{
-  int i = 0, j, ret;
-  char bin_file[PATH_MAX];
-  char last_path[PATH_MAX] = {0};
-  char this_path[PATH_MAX] = {0};
-  char tmp_path[PATH_MAX] = {0};
-  char* pos;
-
-  for (i = 0; i < header_io_id->idx->max_file_count; i++)
-  {
-    if (i % header_io_id->idx_c->partition_nprocs == header_io_id->idx_c->partition_rank && block_layout->file_bitmap[i] == 1)
-    {
-      ret = generate_file_name(header_io_id->idx->blocks_per_file, filename_template, /*adjusted_file_index*/ i, bin_file, PATH_MAX);
-      if (ret == 1)
-      {
-        fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
-        return 1;
-      }
-
-      // see if we need to make parent directory
-      strcpy(this_path, bin_file);
-      if ((pos = strrchr(this_path, '/')))
-      {
-        pos[1] = '\0';
-        if (!strcmp(this_path, last_path) == 0)
-        {
-          //this file is in a previous directory than the last
-          //one; we need to make sure that it exists and create
-          //it if not.
-          strcpy(last_path, this_path);
-          memset(tmp_path, 0, PATH_MAX * sizeof (char));
-          //walk up path and mkdir each segment
-          for (j = 0; j < (int)strlen(this_path); j++)
-          {
-            if (j > 0 && this_path[j] == '/')
-            {
-              ret = mkdir(tmp_path, S_IRWXU | S_IRWXG | S_IRWXO);
-              if (ret != 0 && errno != EEXIST)
-              {
-                //perror("mkdir");
-                fprintf(stderr, "Error: failed to mkdir %s\n", tmp_path);
-                return PIDX_err_file;
-              }
-            }
-            tmp_path[j] = this_path[j];
-          }
-        }
-      }
-
-      MPI_File fh = 0;
-      MPI_File_open(MPI_COMM_SELF, bin_file, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh);
-      MPI_File_close(&fh);
-    }
-  }
-
-  MPI_Barrier(header_io_id->idx_c->partition_comm);
-
-  return PIDX_success;
-}
-
-
-
 int PIDX_header_io_raw_dir_create(PIDX_header_io_id header_io_id, char* file_name)
 {
   int ret = 0;
@@ -236,7 +169,7 @@ int PIDX_header_io_raw_dir_create(PIDX_header_io_id header_io_id, char* file_nam
 
 
 
-PIDX_return_code PIDX_header_io_idx_file_write(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* filename_template, int mode)
+PIDX_return_code PIDX_header_io_idx_file_write(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* filename_template, const int* fused_file_bitmap, int mode)
 {
   int i = 0, ret;
   char bin_file[PATH_MAX];
@@ -263,7 +196,8 @@ PIDX_return_code PIDX_header_io_idx_file_write(PIDX_header_io_id header_io_id, P
         return 1;
       }
 
-      ret = write_meta_data(header_io_id, block_layout, i, bin_file, mode);
+      // the header of a fused file is written by the aggregator of its first block, it is only computed here
+      ret = write_meta_data(header_io_id, block_layout, i, bin_file, (fused_file_bitmap != NULL && fused_file_bitmap[i] == 1) ? 0 : mode);
       if (ret != PIDX_success)
       {
         fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
@@ -278,6 +212,102 @@ PIDX_return_code PIDX_header_io_idx_file_write(PIDX_header_io_id header_io_id, P
 
 
 
+PIDX_return_code PIDX_header_io_idx_file_directories(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* filename_template)
+{
+  char bin_file[PATH_MAX];
+  char directory[PATH_MAX] = "";
+  int directory_count = 0;
+
+  // the files of a directory are consecutive (the directories of the template are the high digits of the file
+  // number), a directory is the one of the previous file or a new one, created by process directory_count
+  for (int i = 0; i < header_io_id->idx->max_file_count; i++)
+  {
+    if (block_layout->file_bitmap[i] != 1)
+      continue;
+
+    if (generate_file_name(header_io_id->idx->blocks_per_file, filename_template, i, bin_file, PATH_MAX) == 1)
+    {
+      fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_header;
+    }
+
+    char* slash = strrchr(bin_file, '/');
+    if (slash == NULL)
+      continue;
+
+    *slash = '\0';
+    if (strcmp(bin_file, directory) == 0)
+      continue;
+    strcpy(directory, bin_file);
+    *slash = '/';
+
+    // a failure is reported by the writers of the files of the directory, which try to create it again
+    if (directory_count % header_io_id->idx_c->partition_nprocs == header_io_id->idx_c->partition_rank)
+      PIDX_file_io_make_directories(bin_file);
+    directory_count++;
+  }
+
+  // there is no barrier, a writer that opens its file before the directory is created creates it itself (see
+  // PIDX_file_io_mpi_create)
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_header_io_idx_file_clear(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* filename_template)
+{
+  char bin_file[PATH_MAX];
+  uint64_t total_header_size = (10 + (10 * header_io_id->idx->blocks_per_file)) * sizeof (uint32_t) * header_io_id->idx->variable_count;
+
+  unsigned char* empty_header = malloc(total_header_size);
+  memset(empty_header, 0, total_header_size);
+
+  for (int i = 0; i < header_io_id->idx->max_file_count; i++)
+  {
+    if (i % header_io_id->idx_c->partition_nprocs == header_io_id->idx_c->partition_rank && block_layout->file_bitmap[i] == 1)
+    {
+      if (generate_file_name(header_io_id->idx->blocks_per_file, filename_template, i, bin_file, PATH_MAX) == 1)
+      {
+        fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+        free(empty_header);
+        return PIDX_err_header;
+      }
+
+      MPI_File fh;
+      MPI_Status status;
+      if (PIDX_file_io_mpi_create(MPI_COMM_SELF, bin_file, header_io_id->idx_c->access->info, &fh) != PIDX_success)
+      {
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_mpi_create() failed on %s\n", __FILE__, __LINE__, bin_file);
+        free(empty_header);
+        return PIDX_err_io;
+      }
+
+      // the blocks packed by an earlier write of the file are dropped
+      if (MPI_File_set_size(fh, 0) != MPI_SUCCESS || MPI_File_write_at(fh, 0, empty_header, total_header_size, MPI_BYTE, &status) != MPI_SUCCESS)
+      {
+        fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed on %s\n", __FILE__, __LINE__, bin_file);
+        free(empty_header);
+        return PIDX_err_io;
+      }
+
+      if (MPI_File_close(&fh) != MPI_SUCCESS)
+      {
+        fprintf(stderr, "[%s] [%d] MPI_File_close() failed on %s\n", __FILE__, __LINE__, bin_file);
+        free(empty_header);
+        return PIDX_err_io;
+      }
+    }
+  }
+  free(empty_header);
+
+  // the aggregators write the entries of their blocks in the cleared headers
+  MPI_Barrier(header_io_id->idx_c->partition_comm);
+
+  return PIDX_success;
+}
+
+
+
 PIDX_return_code PIDX_header_io_global_idx_write (PIDX_header_io_id header_io, char* data_set_path)
 {
   int N;
@@ -425,6 +455,10 @@ PIDX_return_code PIDX_header_io_global_idx_write (PIDX_header_io_id header_io, c
 
     fprintf(idx_file_p, "(compression bit rate)\n%f\n", header_io->idx->compression_bit_rate);
     fprintf(idx_file_p, "(compression type)\n%d\n", header_io->idx->compression_type);
+    if (header_io->idx->compression_type == PIDX_CHUNKING_ZFP_ACCURACY)
+      fprintf(idx_file_p, "(zfp accuracy)\n%.17g\n", header_io->idx->zfp_accuracy);
+    if (header_io->idx->compression_type == PIDX_CHUNKING_ZFP_PRECISION)
+      fprintf(idx_file_p, "(zfp precision)\n%d\n", header_io->idx->zfp_precision);
     
     fprintf(idx_file_p, "(fields)\n");
     for (int l = 0; l < header_io->last_index; l++)
@@ -556,6 +590,10 @@ PIDX_return_code PIDX_header_io_partition_idx_write (PIDX_header_io_id header_io
 
     fprintf(idx_file_p, "(compression bit rate)\n%f\n", header_io->idx->compression_bit_rate);
     fprintf(idx_file_p, "(compression type)\n%d\n", header_io->idx->compression_type);
+    if (header_io->idx->compression_type == PIDX_CHUNKING_ZFP_ACCURACY)
+      fprintf(idx_file_p, "(zfp accuracy)\n%.17g\n", header_io->idx->zfp_accuracy);
+    if (header_io->idx->compression_type == PIDX_CHUNKING_ZFP_PRECISION)
+      fprintf(idx_file_p, "(zfp precision)\n%d\n", header_io->idx->zfp_precision);
 
     fprintf(idx_file_p, "(fields)\n");
     for (l = 0; l < header_io->last_index; l++)
@@ -700,48 +738,68 @@ PIDX_return_code PIDX_header_io_raw_idx_write (PIDX_header_io_id header_io, char
 }
 
 
-static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, int file_number, char* bin_file, int mode)
+void PIDX_header_io_file_header(idx_dataset idx, PIDX_block_layout block_layout, int fs_block_size, int file_number, int first_index, int last_index, uint32_t* file_headers)
+{
+  build_header(idx, block_layout, fs_block_size, file_number, first_index, last_index, file_headers, NULL);
+}
+
+
+
+// the blocks of a variable follow the blocks of the previous variables in the file, the data starts at the first file
+// system block after the header
+static void build_header(idx_dataset idx, PIDX_block_layout block_layout, int fs_block_size, int file_number, int first_index, int last_index, uint32_t* file_headers, uint64_t*** block_offset_bitmap)
 {
   int block_negative_offset = 0;
   uint64_t data_offset = 0, base_offset = 0;
-  uint64_t total_chunk_size = (header_io_id->idx->chunk_size[0] * header_io_id->idx->chunk_size[1] * header_io_id->idx->chunk_size[2]);
+  uint64_t total_chunk_size = (idx->chunk_size[0] * idx->chunk_size[1] * idx->chunk_size[2]);
 
-  int total_header_size = (10 + (10 * header_io_id->idx->blocks_per_file)) * sizeof (uint32_t) * header_io_id->idx->variable_count;
-  memset(headers, 0, total_header_size);
+  uint64_t total_header_size = (10 + (10 * idx->blocks_per_file)) * sizeof (uint32_t) * idx->variable_count;
+  uint64_t start_fs_block = total_header_size / fs_block_size;
+  if (total_header_size % fs_block_size)
+    start_fs_block++;
+
+  memset(file_headers, 0, total_header_size);
 
-  for (uint32_t i = 0; i < header_io_id->idx->blocks_per_file; i++)
+  for (uint32_t i = 0; i < idx->blocks_per_file; i++)
   {
-    if (PIDX_blocks_is_block_present((i + (header_io_id->idx->blocks_per_file * file_number)), header_io_id->idx->bits_per_block, block_layout))
+    if (PIDX_blocks_is_block_present((i + (idx->blocks_per_file * file_number)), idx->bits_per_block, block_layout))
     {
-      block_negative_offset = PIDX_blocks_find_negative_offset(header_io_id->idx->blocks_per_file, header_io_id->idx->bits_per_block, (i + (header_io_id->idx->blocks_per_file * file_number)), block_layout);
+      block_negative_offset = PIDX_blocks_find_negative_offset(idx->blocks_per_file, idx->bits_per_block, (i + (idx->blocks_per_file * file_number)), block_layout);
 
-      for (uint32_t j = header_io_id->first_index; j < header_io_id->last_index; j++)
+      for (uint32_t j = first_index; j < last_index; j++)
       {
         base_offset = 0;
         for (uint32_t k = 0; k < j; k++)
-          base_offset = base_offset + ((block_layout->bcpf[file_number]) * (header_io_id->idx->variable[k]->bpv / 8) * total_chunk_size * header_io_id->idx->samples_per_block * header_io_id->idx->variable[k]->vps) / (header_io_id->idx->compression_factor);
+          base_offset = base_offset + ((block_layout->bcpf[file_number]) * (idx->variable[k]->bpv / 8) * total_chunk_size * idx->samples_per_block * idx->variable[k]->vps) / (idx->compression_factor);
 
-        data_offset = ((i - block_negative_offset) * header_io_id->idx->samples_per_block) * (header_io_id->idx->variable[j]->bpv / 8) * total_chunk_size * header_io_id->idx->variable[j]->vps  / (header_io_id->idx->compression_factor);
+        data_offset = ((i - block_negative_offset) * idx->samples_per_block) * (idx->variable[j]->bpv / 8) * total_chunk_size * idx->variable[j]->vps  / (idx->compression_factor);
 
-        data_offset = base_offset + data_offset + header_io_id->start_fs_block * header_io_id->fs_block_size;
+        data_offset = base_offset + data_offset + start_fs_block * fs_block_size;
 
-        headers[12 + ((i + (header_io_id->idx->blocks_per_file * j))*10 )] = htonl(data_offset);
-        headers[14 + ((i + (header_io_id->idx->blocks_per_file * j))*10)] = htonl(header_io_id->idx->samples_per_block * (header_io_id->idx->variable[j]->bpv / 8) * total_chunk_size * header_io_id->idx->variable[j]->vps / (header_io_id->idx->compression_factor));
+        PIDX_header_set_block(file_headers, idx->blocks_per_file, j, i, data_offset, idx->samples_per_block * (idx->variable[j]->bpv / 8) * total_chunk_size * idx->variable[j]->vps / (idx->compression_factor));
 
-        header_io_id->idx_b->block_offset_bitmap[j][file_number][i] = data_offset;
+        if (block_offset_bitmap != NULL)
+          block_offset_bitmap[j][file_number][i] = data_offset;
       }
     }
   }
+}
+
+
+
+static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, int file_number, char* bin_file, int mode)
+{
+  int total_header_size = (10 + (10 * header_io_id->idx->blocks_per_file)) * sizeof (uint32_t) * header_io_id->idx->variable_count;
+  build_header(header_io_id->idx, block_layout, header_io_id->fs_block_size, file_number, header_io_id->first_index, header_io_id->last_index, headers, header_io_id->idx_b->block_offset_bitmap);
 
   if (mode == 1)
   {
     MPI_File fh;
     MPI_Status status;
     int ret = 0;
-    ret = MPI_File_open(MPI_COMM_SELF, bin_file, MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
-    if (ret != MPI_SUCCESS)
+    if (PIDX_file_io_mpi_create(MPI_COMM_SELF, bin_file, header_io_id->idx_c->access->info, &fh) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_open() failed on %s\n", __FILE__, __LINE__, bin_file);
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_mpi_create() failed on %s\n", __FILE__, __LINE__, bin_file);
       return PIDX_err_io;
     }
 
@@ -762,6 +820,12 @@ static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout blo
       fprintf(stderr, "[%s] [%d] MPI_File_open() failed on %s\n", __FILE__, __LINE__, bin_file);
       return PIDX_err_io;
     }
+
+    if (header_io_id->idx->staging_directory[0] != '\0' && PIDX_file_io_drain_add(header_io_id->idx, header_io_id->idx_c, bin_file, 0, total_header_size) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_add() failed on %s\n", __FILE__, __LINE__, bin_file);
+      return PIDX_err_io;
+    }
   }
 
   return PIDX_success;
@@ -780,3 +844,49 @@ PIDX_return_code PIDX_header_io_finalize(PIDX_header_io_id header_io_id)
 
   return PIDX_success;
 }
+
+
+
+// Metadata versions before 6.2 only stored the lower 32 bits of the block offsets and sizes
+static int has_64bit_blocks(idx_dataset idx)
+{
+  return !(strcmp(idx->metadata_version, "6") == 0 || strcmp(idx->metadata_version, "6.1") == 0);
+}
+
+
+
+void PIDX_header_set_block(uint32_t* headers, int blocks_per_file, int variable_index, int block, uint64_t offset, uint64_t size)
+{
+  uint32_t* block_header = headers + 10 + (block + blocks_per_file * variable_index) * 10;
+
+  block_header[2] = htonl((uint32_t) (offset & 0xFFFFFFFF));
+  block_header[3] = htonl((uint32_t) (offset >> 32));
+  block_header[4] = htonl((uint32_t) (size & 0xFFFFFFFF));
+  block_header[5] = htonl((uint32_t) (size >> 32));
+}
+
+
+
+uint64_t PIDX_header_block_offset(idx_dataset idx, uint32_t* headers, int variable_index, int block)
+{
+  uint32_t* block_header = headers + 10 + (block + idx->blocks_per_file * variable_index) * 10;
+
+  uint64_t offset = ntohl(block_header[2]);
+  if (has_64bit_blocks(idx))
+    offset = offset | ((uint64_t) ntohl(block_header[3]) << 32);
+
+  return offset;
+}
+
+
+
+uint64_t PIDX_header_block_size(idx_dataset idx, uint32_t* headers, int variable_index, int block)
+{
+  uint32_t* block_header = headers + 10 + (block + idx->blocks_per_file * variable_index) * 10;
+
+  uint64_t size = ntohl(block_header[4]);
+  if (has_64bit_blocks(idx))
+    size = size | ((uint64_t) ntohl(block_header[5]) << 32);
+
+  return size;
+}
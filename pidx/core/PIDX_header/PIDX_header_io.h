@@ -79,26 +79,58 @@ PIDX_return_code PIDX_header_io_raw_idx_write (PIDX_header_io_id header_io, char
 
 
 ///
-/// \brief PIDX_header_io_idx_file_create
+/// \brief PIDX_header_io_idx_file_write computes the headers of the binary files (and the block offsets), with mode 1
+/// they are also written. The files are created by their first writer, there is no pass creating them.
 /// \param header_io_id
 /// \param block_layout
-/// \param filename_template
+/// \param file_name_template
+/// \param fused_file_bitmap the files whose header is written by the aggregator of their first block (NULL for none)
+/// \param mode
 /// \return
 ///
-int PIDX_header_io_idx_file_create(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* filename_template);
+PIDX_return_code PIDX_header_io_idx_file_write(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* file_name_template, const int* fused_file_bitmap, int mode);
 
 
 
 ///
-/// \brief PIDX_header_io_idx_file_write
+/// \brief PIDX_header_io_idx_file_directories creates the directories of the binary files, each one by a single
+/// process of the partition (instead of every first writer of a file creating them). It does not wait for them, a
+/// writer that finds its directory missing creates it
 /// \param header_io_id
 /// \param block_layout
-/// \param file_name
 /// \param file_name_template
-/// \param mode
 /// \return
 ///
-PIDX_return_code PIDX_header_io_idx_file_write(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* file_name_template, int mode);
+PIDX_return_code PIDX_header_io_idx_file_directories(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* file_name_template);
+
+
+
+///
+/// \brief PIDX_header_io_idx_file_clear creates the binary files of the variable size ZFP modes with an empty header
+/// (and no data), the aggregators fill in the offsets and sizes of the blocks they pack in the files. The files are
+/// not staged (file_name_template is the template of the dataset), a drained empty header could overwrite the
+/// entries of the aggregators.
+/// \param header_io_id
+/// \param block_layout
+/// \param file_name_template
+/// \return
+///
+PIDX_return_code PIDX_header_io_idx_file_clear(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, char* file_name_template);
+
+
+
+///
+/// \brief PIDX_header_io_file_header builds the binary header of a file (as PIDX_header_io_idx_file_write writes it)
+/// for the variables first_index to last_index - 1
+/// \param idx
+/// \param block_layout
+/// \param fs_block_size
+/// \param file_number
+/// \param first_index
+/// \param last_index
+/// \param file_headers (10 + 10 * blocks_per_file) * variable_count words
+///
+void PIDX_header_io_file_header(idx_dataset idx, PIDX_block_layout block_layout, int fs_block_size, int file_number, int first_index, int last_index, uint32_t* file_headers);
 
 
 
@@ -120,4 +152,44 @@ int PIDX_header_io_raw_dir_create(PIDX_header_io_id header_io_id, char* file_nam
 ///
 int PIDX_header_io_finalize(PIDX_header_io_id header_io);
 
+
+
+///
+/// \brief PIDX_header_set_block stores the offset and the size of a block in the binary header of a file.
+/// Every block has ten 32 bit (big endian) words after the ten words of the file header; word 2 and 4 hold the lower
+/// and word 3 and 5 the upper halves of the offset and the size (metadata version 6.2 onwards)
+/// \param headers
+/// \param blocks_per_file
+/// \param variable_index
+/// \param block index of the block within the file
+/// \param offset
+/// \param size
+///
+void PIDX_header_set_block(uint32_t* headers, int blocks_per_file, int variable_index, int block, uint64_t offset, uint64_t size);
+
+
+
+///
+/// \brief PIDX_header_block_offset returns the offset of a block from the binary header of a file, the upper half is
+/// ignored for files written with a metadata version older than 6.2
+/// \param idx
+/// \param headers
+/// \param variable_index
+/// \param block index of the block within the file
+/// \return
+///
+uint64_t PIDX_header_block_offset(idx_dataset idx, uint32_t* headers, int variable_index, int block);
+
+
+
+///
+/// \brief PIDX_header_block_size returns the size of a block from the binary header of a file
+/// \param idx
+/// \param headers
+/// \param variable_index
+/// \param block index of the block within the file
+/// \return
+///
+uint64_t PIDX_header_block_size(idx_dataset idx, uint32_t* headers, int variable_index, int block);
+
 #endif
@@ -54,6 +54,17 @@ PIDX_return_code PIDX_hz_encode_set_resolution(PIDX_hz_encode_id id, int resolut
 }
 
 
+PIDX_return_code PIDX_hz_encode_set_fused_restructure(PIDX_hz_encode_id id, int fused_restructure)
+{
+  if (fused_restructure != 0 && fused_restructure != 1)
+    return PIDX_err_hz;
+
+  id->fused_restructure = fused_restructure;
+
+  return PIDX_success;
+}
+
+
 PIDX_hz_encode_id PIDX_hz_encode_init(idx_dataset idx_meta_data, idx_comm idx_c, idx_debug idx_dbg, PIDX_metadata_cache meta_data_cache, int fs_block_size, int first_index, int last_index)
 {
   PIDX_hz_encode_id hz_id;
@@ -70,6 +81,7 @@ PIDX_hz_encode_id PIDX_hz_encode_init(idx_dataset idx_meta_data, idx_comm idx_c,
   
   hz_id->fs_block_size = fs_block_size;
   hz_id->resolution_to = 0;
+  hz_id->fused_restructure = 0;
 
   return hz_id;
 }
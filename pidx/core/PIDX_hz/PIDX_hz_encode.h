@@ -75,6 +75,8 @@ struct PIDX_hz_encode_struct
   int last_index;
 
   int resolution_to;
+
+  int fused_restructure;      ///< 1 if the restructured patches are encoded directly (no super patch, no chunking)
 };
 typedef struct PIDX_hz_encode_struct* PIDX_hz_encode_id;
 
@@ -116,27 +118,10 @@ PIDX_return_code PIDX_hz_encode_buf_create(PIDX_hz_encode_id id);
 
 
 
-///
-/// \brief PIDX_hz_encode_write_inverse
-/// \param id
-/// \param start_hz_index
-/// \param end_hz_index
-/// \return
-///
-PIDX_return_code PIDX_hz_encode_write_inverse(PIDX_hz_encode_id id, int start_hz_index, int end_hz_index);
-
-
-///
-/// \brief PIDX_hz_encode_write
-/// \param id
-/// \return
-///
-PIDX_return_code PIDX_hz_encode_write(PIDX_hz_encode_id id);
-
-
-
 ///
 /// \brief PIDX_hz_encode_fast_write
+/// Encodes the restructured boxes into the HZ buffers level by level (multithreaded), the level lattices are kept in the
+/// meta data cache
 /// \param id
 /// \return
 ///
@@ -145,11 +130,12 @@ PIDX_return_code PIDX_hz_encode_fast_write(PIDX_hz_encode_id id);
 
 
 ///
-/// \brief PIDX_hz_encode_read
+/// \brief PIDX_hz_encode_fast_read
+/// Decodes the HZ buffers into the restructured boxes level by level (multithreaded)
 /// \param id
 /// \return
 ///
-PIDX_return_code PIDX_hz_encode_read(PIDX_hz_encode_id id);
+PIDX_return_code PIDX_hz_encode_fast_read(PIDX_hz_encode_id id);
 
 
 
@@ -182,6 +168,18 @@ PIDX_return_code PIDX_hz_encode_set_resolution(PIDX_hz_encode_id id, int resolut
 
 
 
+///
+/// \brief PIDX_hz_encode_set_fused_restructure
+/// When set, PIDX_hz_encode_fast_write encodes every patch of the restructured super patch straight from its
+/// restructuring buffer, the super patch and the chunked super patch are never populated (needs a chunk size of 1)
+/// \param id
+/// \param fused_restructure 1 to encode from the restructured patches, 0 (default) to encode the chunked super patch
+/// \return
+///
+PIDX_return_code PIDX_hz_encode_set_fused_restructure(PIDX_hz_encode_id id, int fused_restructure);
+
+
+
 
 
 ///
@@ -0,0 +1,343 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+
+#include "../../PIDX_inc.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+// Computes the lattice (first sample, stride and number of samples) of every HZ level restricted to the patch
+static void hz_level_lattices(PIDX_hz_encode_id id, const uint64_t* patch_offset, const uint64_t* patch_size, int level_count, struct PIDX_metadata_cache_level_struct* lattice)
+{
+  int maxH = id->idx->maxh;
+
+  // get_grid works on the bitsequence without the leading V (and without regular expressions)
+  char bit_string[512];
+  for (int i = 1; i < maxH; i++)
+    bit_string[i - 1] = '0' + id->idx->bitPattern[i];
+  bit_string[maxH - 1] = '\0';
+
+  Point3D patch_from, patch_to;
+  patch_from.x = patch_offset[0];
+  patch_from.y = patch_offset[1];
+  patch_from.z = patch_offset[2];
+  patch_to.x = patch_offset[0] + patch_size[0] - 1;
+  patch_to.y = patch_offset[1] + patch_size[1] - 1;
+  patch_to.z = patch_offset[2] + patch_size[2] - 1;
+
+  for (int level = 0; level < level_count; level++)
+  {
+    Point3D from, to, stride;
+    get_grid(patch_from, patch_to, level, bit_string, maxH - 1, &from, &to, &stride);
+
+    // the lattice of the level does not intersect the patch
+    if (from.x > to.x || from.y > to.y || from.z > to.z)
+      continue;
+
+    lattice[level].from[0] = from.x;
+    lattice[level].from[1] = from.y;
+    lattice[level].from[2] = from.z;
+    lattice[level].stride[0] = stride.x;
+    lattice[level].stride[1] = stride.y;
+    lattice[level].stride[2] = stride.z;
+    lattice[level].count[0] = (to.x - from.x) / stride.x + 1;
+    lattice[level].count[1] = (to.y - from.y) / stride.y + 1;
+    lattice[level].count[2] = (to.z - from.z) / stride.z + 1;
+  }
+}
+
+
+
+// HZ encodes (decodes) one patch whose samples start at patch_buffer[v] for every variable v of the pack
+// The samples of HZ level j form a regular lattice (first sample and strides from get_grid), so instead of computing the
+// HZ index of every sample of the patch we walk the lattice of every level restricted to the patch, one row (along x) at a time.
+// The HZ indices of a row come from a single bit deposit followed by a masked increment and the patch buffer is read (written)
+// with a constant stride.
+// The lattices only depend on the patch geometry, they are kept in the meta data cache (if any) across files and time steps.
+static PIDX_return_code hz_encode_fast_patch(PIDX_hz_encode_id id, int mode, int level_count, const uint64_t* patch_offset, const uint64_t* patch_size, unsigned char** patch_buffer, const uint64_t* element_size, const PIDX_copy_kernel* kernel)
+{
+  int maxH = id->idx->maxh;
+  PIDX_variable var0 = id->idx->variable[id->first_index];
+  PIDX_hz_index hz_engine = id->idx->hz_index;
+
+  // Distance (in samples) between neighbors in the patch buffer along x, y and z
+  uint64_t patch_stride[PIDX_MAX_DIMENSIONS];
+  if (var0->data_layout == PIDX_row_major)
+  {
+    patch_stride[0] = 1;
+    patch_stride[1] = patch_size[0];
+    patch_stride[2] = patch_size[0] * patch_size[1];
+  }
+  else
+  {
+    patch_stride[0] = patch_size[2] * patch_size[1];
+    patch_stride[1] = patch_size[2];
+    patch_stride[2] = 1;
+  }
+
+  // Lattices of the HZ levels restricted to the patch, from the meta data cache if this patch geometry has been seen before
+  struct PIDX_metadata_cache_level_struct* lattice = NULL;
+  struct PIDX_metadata_cache_level_struct* local_lattice = NULL;
+  PIDX_metadata_cache_entry cache_entry = PIDX_metadata_cache_lookup(id->meta_data_cache, patch_offset, patch_size, id->idx->bitSequence, maxH, id->resolution_to);
+  if (cache_entry != NULL)
+    lattice = cache_entry->level;
+  else
+  {
+    local_lattice = malloc(level_count * sizeof(*local_lattice));
+    if (local_lattice == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_hz;
+    }
+    memset(local_lattice, 0, level_count * sizeof(*local_lattice));
+    hz_level_lattices(id, patch_offset, patch_size, level_count, local_lattice);
+
+    if (id->meta_data_cache != NULL && PIDX_metadata_cache_insert(id->meta_data_cache, patch_offset, patch_size, id->idx->bitSequence, maxH, id->resolution_to, local_lattice, &cache_entry) == PIDX_success)
+    {
+      lattice = cache_entry->level;
+      free(local_lattice);
+      local_lattice = NULL;
+    }
+    else
+      lattice = local_lattice;
+  }
+
+  int thread_count = id->idx->thread_count;
+  if (thread_count < 1)
+    thread_count = 1;
+
+  // HZ indices of one row of a level lattice, one row per thread (allocated here, a parallel region can not return)
+  uint64_t *hz_rows = malloc(thread_count * patch_size[0] * sizeof(*hz_rows));
+  if (hz_rows == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    free(local_lattice);
+    return PIDX_err_hz;
+  }
+
+  // Every (level, z, y) row touches a disjoint range of the HZ buffers (and of the patch buffer) so the rows of a level
+  // can be split across threads without any synchronization
+#ifdef _OPENMP
+  #pragma omp parallel num_threads(thread_count) if (thread_count > 1)
+#endif
+  {
+#ifdef _OPENMP
+    uint64_t *hz_row = hz_rows + omp_get_thread_num() * patch_size[0];
+#else
+    uint64_t *hz_row = hz_rows;
+#endif
+
+    for (int level = 0; level < level_count; level++)
+    {
+      const uint64_t* from = lattice[level].from;
+      const uint64_t* stride = lattice[level].stride;
+
+      // the lattice of the level does not intersect the patch
+      if (lattice[level].count[0] == 0)
+        continue;
+
+      uint64_t count = lattice[level].count[0];
+      uint64_t sample_stride = stride[0] * patch_stride[0];
+      int64_t row_count_y = lattice[level].count[1];
+      int64_t row_count = row_count_y * lattice[level].count[2];
+
+#ifdef _OPENMP
+      #pragma omp for schedule(static)
+#endif
+      for (int64_t r = 0; r < row_count; r++)
+      {
+        uint64_t j = from[1] + (r % row_count_y) * stride[1];
+        uint64_t k = from[2] + (r / row_count_y) * stride[2];
+
+        PIDX_hz_index_level_row(hz_engine, level, from[0], j, k, count, hz_row);
+
+        uint64_t index = (from[0] - patch_offset[0]) * patch_stride[0]
+                       + (j - patch_offset[1]) * patch_stride[1]
+                       + (k - patch_offset[2]) * patch_stride[2];
+
+        for (int v = id->first_index; v <= id->last_index; v++)
+        {
+          PIDX_variable var = id->idx->variable[v];
+          uint64_t bytes_for_datatype = element_size[v - id->first_index];
+          uint64_t start_hz_index = var->hz_buffer->start_hz_index[level];
+          unsigned char* hz_buffer = var->hz_buffer->buffer[level];
+          unsigned char* sample_buffer = patch_buffer[v - id->first_index] + index * bytes_for_datatype;
+
+          if (mode == PIDX_WRITE)
+            kernel[v - id->first_index]->scatter(hz_buffer, hz_row, start_hz_index, sample_buffer, sample_stride, count, bytes_for_datatype);
+          else
+            kernel[v - id->first_index]->gather(sample_buffer, sample_stride, hz_buffer, hz_row, start_hz_index, count, bytes_for_datatype);
+        }
+      }
+    }
+  }
+
+  free(hz_rows);
+  free(local_lattice);
+
+  return PIDX_success;
+}
+
+
+
+// Level by level HZ encoding of the chunked super patch, or of every restructured patch when the restructuring is fused
+// with HZ encoding (the restructured patches are then never combined into the super patch)
+static PIDX_return_code hz_encode_fast(PIDX_hz_encode_id id, int mode)
+{
+  int maxH = id->idx->maxh;
+  int chunk_size = id->idx->chunk_size[0] * id->idx->chunk_size[1] * id->idx->chunk_size[2];
+  PIDX_variable var0 = id->idx->variable[id->first_index];
+
+  // Basic checking
+  if (var0->sim_patch_count < 0)
+  {
+    fprintf(stderr, "[%s] [%d] id->idx_d->count not set.\n", __FILE__, __LINE__);
+    return PIDX_err_hz;
+  }
+
+  if (maxH <= 0)
+  {
+    fprintf(stderr, "[%s] [%d] maxH not set.\n", __FILE__, __LINE__);
+    return PIDX_err_hz;
+  }
+
+  // The process is not holding any patch after restructuring
+  if (var0->restructured_super_patch_count == 0)
+    return PIDX_success;
+
+  // The restructured patches are in sample space, they can only be encoded directly without chunking
+  if (id->fused_restructure == 1 && chunk_size != 1)
+  {
+    fprintf(stderr, "[%s] [%d] fused restructuring needs a chunk size of 1.\n", __FILE__, __LINE__);
+    return PIDX_err_hz;
+  }
+
+  // HZ addressing tables (built once per bitsequence)
+  if (PIDX_hz_index_acquire(&id->idx->hz_index, id->idx->bitPattern, maxH - 1) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_hz_index_acquire failed.\n", __FILE__, __LINE__);
+    return PIDX_err_hz;
+  }
+
+  int level_count = maxH - id->resolution_to;
+  if (level_count <= 0)
+    return PIDX_success;
+
+  // Copy kernels specialized for the sample size of every variable
+  int variable_count = id->last_index - id->first_index + 1;
+  uint64_t *element_size = malloc(variable_count * sizeof(*element_size));
+  PIDX_copy_kernel *kernel = malloc(variable_count * sizeof(*kernel));
+  unsigned char **patch_buffer = malloc(variable_count * sizeof(*patch_buffer));
+  if (element_size == NULL || kernel == NULL || patch_buffer == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    free(element_size);
+    free(kernel);
+    free(patch_buffer);
+    return PIDX_err_hz;
+  }
+  for (int v = id->first_index; v <= id->last_index; v++)
+  {
+    PIDX_variable var = id->idx->variable[v];
+    element_size[v - id->first_index] = ((var->bpv / 8) * chunk_size * var->vps) / id->idx->compression_factor;
+    kernel[v - id->first_index] = PIDX_copy_kernel_get(element_size[v - id->first_index]);
+  }
+
+  PIDX_return_code ret = PIDX_success;
+  if (id->fused_restructure == 1)
+  {
+    // every restructured patch goes straight from the restructuring (receive) buffers to the HZ buffers
+    for (uint32_t p = 0; p < var0->restructured_super_patch->patch_count; p++)
+    {
+      PIDX_patch patch = var0->restructured_super_patch->patch[p];
+      if (patch->size[0] == 0 || patch->size[1] == 0 || patch->size[2] == 0)
+        continue;
+
+      for (int v = id->first_index; v <= id->last_index; v++)
+        patch_buffer[v - id->first_index] = id->idx->variable[v]->restructured_super_patch->patch[p]->buffer;
+
+      ret = hz_encode_fast_patch(id, mode, level_count, patch->offset, patch->size, patch_buffer, element_size, kernel);
+      if (ret != PIDX_success)
+        break;
+    }
+  }
+  else
+  {
+    // adjusted patch size and offset due to zfp chunking and compression
+    uint64_t chunked_patch_offset[PIDX_MAX_DIMENSIONS] = {0, 0, 0};
+    uint64_t chunked_patch_size[PIDX_MAX_DIMENSIONS] = {0, 0, 0};
+    for (int l = 0; l < PIDX_MAX_DIMENSIONS; l++)
+    {
+      chunked_patch_offset[l] = var0->chunked_super_patch->restructured_patch->offset[l] / id->idx->chunk_size[l];
+      if (var0->chunked_super_patch->restructured_patch->size[l] % id->idx->chunk_size[l] == 0)
+        chunked_patch_size[l] = var0->chunked_super_patch->restructured_patch->size[l] / id->idx->chunk_size[l];
+      else
+        chunked_patch_size[l] = (var0->chunked_super_patch->restructured_patch->size[l] / id->idx->chunk_size[l]) + 1;
+    }
+
+    for (int v = id->first_index; v <= id->last_index; v++)
+      patch_buffer[v - id->first_index] = id->idx->variable[v]->chunked_super_patch->restructured_patch->buffer;
+
+    ret = hz_encode_fast_patch(id, mode, level_count, chunked_patch_offset, chunked_patch_size, patch_buffer, element_size, kernel);
+  }
+
+  free(element_size);
+  free(kernel);
+  free(patch_buffer);
+
+  return ret;
+}
+
+
+
+PIDX_return_code PIDX_hz_encode_fast_write(PIDX_hz_encode_id id)
+{
+  return hz_encode_fast(id, PIDX_WRITE);
+}
+
+
+
+PIDX_return_code PIDX_hz_encode_fast_read(PIDX_hz_encode_id id)
+{
+  return hz_encode_fast(id, PIDX_READ);
+}
@@ -42,8 +42,6 @@
 
 #include "../../PIDX_inc.h"
 
-static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf);
-static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf);
 
 static int write_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_start_index, uint64_t hz_count, unsigned char* hz_buffer, uint64_t buffer_offset, PIDX_block_layout layout);
 static int read_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_start_index, uint64_t hz_count, unsigned char* hz_buffer, uint64_t buffer_offset, PIDX_block_layout layout);
@@ -232,10 +230,9 @@ static int write_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_s
         MPI_File_close(&fp);
 
       //fprintf(stderr, "Opening file %s\n", file_name);
-      ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_WRONLY, MPI_INFO_NULL, &fp);
-      if (ret != MPI_SUCCESS)
+      if (PIDX_file_io_mpi_create(MPI_COMM_SELF, file_name, id->idx_c->access->info, &fp) != PIDX_success)
       {
-        fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_mpi_create() filename %s failed.\n", __FILE__, __LINE__, file_name);
         return PIDX_err_io;
       }
     }
@@ -275,32 +272,7 @@ static int write_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_s
 
     int ret;
     if (id->idx->flip_endian == 1)
-    {
-      if (curr_var->bpv/8 == 4 || curr_var->bpv/8 == 12)
-      {
-        int y = 0;
-        float temp, temp2;
-
-        for (y = 0; y < (file_count * curr_var->vps * (curr_var->bpv/8)) / sizeof(float); y++)
-        {
-          memcpy(&temp, hz_buffer + (y * sizeof(float)), sizeof(float));
-          bit32_reverse_endian((unsigned char*)&temp, (unsigned char*)&temp2);
-          memcpy(hz_buffer + (y * sizeof(float)), &temp2, sizeof(float));
-        }
-      }
-      else if (curr_var->bpv/8 == 8 || curr_var->bpv/8 == 24)
-      {
-        int y = 0;
-        double temp, temp2;
-
-        for (y = 0; y < (file_count * curr_var->vps * (curr_var->bpv/8)) / sizeof(double); y++)
-        {
-          memcpy(&temp, hz_buffer + (y * sizeof(double)), sizeof(double));
-          bit64_reverse_endian((unsigned char*)&temp, (unsigned char*)&temp2);
-          memcpy(hz_buffer + (y * sizeof(double)), &temp2, sizeof(double));
-        }
-      }
-    }
+      PIDX_file_io_flip_endian(curr_var, hz_buffer, (uint64_t) file_count * bytes_per_datatype);
 
     //if (id->idx_c->partition_rank == 0)
     //  fprintf(stderr, "[%d] Data offset %d data size %lld\n", variable_index, data_offset, file_count * bytes_per_datatype);
@@ -319,6 +291,12 @@ static int write_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_s
       return PIDX_err_io;
     }
 
+    if (id->idx->staging_directory[0] != '\0' && PIDX_file_io_drain_add(id->idx, id->idx_c, file_name, data_offset, write_count) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_drain_add() failed for %s.\n", __FILE__, __LINE__, file_name);
+      return PIDX_err_io;
+    }
+
     hz_count -= file_count;
     hz_start_index += file_count;
     hz_buffer += file_count * bytes_per_datatype;
@@ -356,34 +334,12 @@ static int read_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_st
       return PIDX_err_io;
     }
 
-    if (opened_file_number != file_number)
+    PIDX_file_io_handle fh;
+    uint32_t *file_headers;
+    if (PIDX_file_io_cache_get(id->idx, id->idx_c, file_name, &fh, &file_headers) != PIDX_success)
     {
-      opened_file_number = file_number;
-
-      if (fp != 0)
-        MPI_File_close(&fp);
-
-      ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp);
-      if (ret != MPI_SUCCESS)
-      {
-        fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
-        return PIDX_err_io;
-      }
-
-      ret = MPI_File_read_at(fp, 0, headers, total_header_size , MPI_BYTE, &status);
-      if (ret != MPI_SUCCESS)
-      {
-        fprintf(stderr, "Data offset = [%s] [%d] MPI_File_write_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
-        return PIDX_err_io;
-      }
-      int read_count = 0;
-      MPI_Get_count(&status, MPI_BYTE, &read_count);
-      if (read_count != total_header_size)
-      {
-        fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %dd\n", __FILE__, __LINE__, read_count, total_header_size);
-        return PIDX_err_io;
-      }
-
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_cache_get() filename %s failed.\n", __FILE__, __LINE__, file_name);
+      return PIDX_err_io;
     }
 
     if ((uint64_t)file_count > hz_count)
@@ -401,17 +357,19 @@ static int read_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_st
     for (bl = 0; bl < blocks_to_read; bl++)
     {
       memset(temp_buffer, 0, block_size_bytes);
-      data_offset = ntohl(headers[12 + ((((block_number % id->idx->blocks_per_file) + bl) + (id->idx->blocks_per_file * variable_index))*10 )]);
-      data_size = ntohl(headers[14 + ((((block_number % id->idx->blocks_per_file) + bl) + (id->idx->blocks_per_file * variable_index))*10 )]);
+      data_offset = PIDX_header_block_offset(id->idx, file_headers, variable_index, (block_number % id->idx->blocks_per_file) + bl);
+      data_size = PIDX_header_block_size(id->idx, file_headers, variable_index, (block_number % id->idx->blocks_per_file) + bl);
 
       if (data_size == 0)
         continue;
 
-      int ret;
-      ret = MPI_File_read_at(fp, data_offset, temp_buffer, block_size_bytes, MPI_BYTE, &status);
-      if (ret != MPI_SUCCESS)
+      if (data_size > (uint64_t)block_size_bytes)
+        data_size = block_size_bytes;
+
+      if (PIDX_file_io_read_at(fh, data_offset, temp_buffer, data_size) != PIDX_success)
       {
-        fprintf(stderr, "[%s] [%d] MPI_File_open() failed.\n", __FILE__, __LINE__);
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_read_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
+        free(temp_buffer);
         return PIDX_err_io;
       }
 
@@ -433,37 +391,3 @@ static int read_samples(PIDX_hz_encode_id id, int variable_index, uint64_t hz_st
   }
   return PIDX_success;
 }
-
-
-
-static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf)
-{
-  unsigned char *data = ((unsigned char *)val) + 3;
-  unsigned char *out = (unsigned char *)outbuf;
-
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out = *data;
-
-  return;
-}
-
-
-
-static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf)
-{
-  unsigned char *data = ((unsigned char *)val) + 7;
-  unsigned char *out = (unsigned char *)outbuf;
-
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out++ = *data--;
-  *out = *data;
-
-  return;
-}
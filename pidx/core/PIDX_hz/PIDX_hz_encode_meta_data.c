@@ -76,6 +76,12 @@ PIDX_return_code PIDX_hz_encode_meta_data_create(PIDX_hz_encode_id id)
     return PIDX_err_hz;
   }
 
+  if (PIDX_hz_index_acquire(&id->idx->hz_index, id->idx->bitPattern, maxH - 1) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_hz_index_acquire failed.\n", __FILE__, __LINE__);
+    return PIDX_err_hz;
+  }
+
   for (uint32_t v = id->first_index; v <= id->last_index; v++)
   {
     PIDX_variable var = id->idx->variable[v];
@@ -130,18 +136,8 @@ PIDX_return_code PIDX_hz_encode_meta_data_create(PIDX_hz_encode_id id)
       // Visus API call to compute start and end HZ for every HZ level
       Align((maxH - 1), j, id->idx->bitPattern, restructured_box, start_xyz_per_hz_level, end_xyz_per_hz_level, hz_buf->nsamples_per_level);
 
-      Point3D startXYZ;
-      startXYZ.x = start_xyz_per_hz_level[j][0];
-      startXYZ.y = start_xyz_per_hz_level[j][1];
-      startXYZ.z = start_xyz_per_hz_level[j][2];
-      hz_buf->start_hz_index[j] = xyz_to_HZ(id->idx->bitPattern, maxH - 1, startXYZ);
-
-      Point3D endXYZ;
-      endXYZ.x = end_xyz_per_hz_level[j][0];
-      endXYZ.y = end_xyz_per_hz_level[j][1];
-      endXYZ.z = end_xyz_per_hz_level[j][2];
-
-      hz_buf->end_hz_index[j] = xyz_to_HZ(id->idx->bitPattern, maxH - 1, endXYZ);
+      hz_buf->start_hz_index[j] = PIDX_hz_index_xyz_to_hz(id->idx->hz_index, start_xyz_per_hz_level[j][0], start_xyz_per_hz_level[j][1], start_xyz_per_hz_level[j][2]);
+      hz_buf->end_hz_index[j] = PIDX_hz_index_xyz_to_hz(id->idx->hz_index, end_xyz_per_hz_level[j][0], end_xyz_per_hz_level[j][1], end_xyz_per_hz_level[j][2]);
     }
 
     for (uint32_t j = 0; j < maxH; j++)
@@ -53,6 +53,9 @@ PIDX_return_code HELPER_Hz_encode(PIDX_hz_encode_id id)
   float fvalue_1 = 0, fvalue_2 = 0;
   uint64_t uvalue_1 = 0, uvalue_2 = 0;
 
+  if (PIDX_hz_index_acquire(&id->idx->hz_index, id->idx->bitPattern, id->idx->maxh - 1) != PIDX_success)
+    return PIDX_err_hz;
+
   for (v = id->first_index; v <= id->last_index; v++)
   {
     PIDX_variable var = id->idx->variable[v];
@@ -64,7 +67,7 @@ PIDX_return_code HELPER_Hz_encode(PIDX_hz_encode_id id)
         for (k = 0; k <= (var->hz_buffer->end_hz_index[i] - var->hz_buffer->start_hz_index[i]) * 1; k++)
         {
           global_hz = var->hz_buffer->start_hz_index[i] + k;
-          Hz_to_xyz(id->idx->bitPattern, id->idx->maxh - 1, global_hz, ZYX);
+          PIDX_hz_index_hz_to_xyz(id->idx->hz_index, global_hz, ZYX);
           if ((ZYX[0] < id->idx->box_bounds[0] && ZYX[1] < id->idx->box_bounds[1] && ZYX[2] < id->idx->box_bounds[2]))
           {
             check_bit = 1, s = 0;
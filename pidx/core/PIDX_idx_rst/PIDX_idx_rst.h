@@ -156,6 +156,17 @@ PIDX_return_code PIDX_idx_rst_buf_destroy(PIDX_idx_rst_id rst_id);
 
 
 
+///
+/// \brief PIDX_idx_rst_buf_destroy_variables Frees the patch buffers of a subset of the restructured variables
+/// \param rst_id
+/// \param svi first variable
+/// \param evi last variable
+/// \return
+///
+PIDX_return_code PIDX_idx_rst_buf_destroy_variables(PIDX_idx_rst_id rst_id, int svi, int evi);
+
+
+
 ///
 /// \brief PIDX_idx_rst_aggregate_buf_create
 /// \param rst_id
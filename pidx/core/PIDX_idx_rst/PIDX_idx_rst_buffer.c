@@ -130,6 +130,36 @@ PIDX_return_code PIDX_idx_rst_buf_destroy(PIDX_idx_rst_id rst_id)
 }
 
 
+// Free the patches of variables svi to evi only (once they have been consumed by the fused HZ encoding)
+PIDX_return_code PIDX_idx_rst_buf_destroy_variables(PIDX_idx_rst_id rst_id, int svi, int evi)
+{
+  PIDX_variable var0 = rst_id->idx_metadata->variable[rst_id->first_index];
+
+  // If the process does not hold a super patch
+  if (var0->restructured_super_patch_count == 0)
+      return PIDX_success;
+
+  if (svi < rst_id->first_index || evi > rst_id->last_index)
+  {
+    fprintf(stderr, "[%s] [%d] variables %d to %d are not restructured by this id.\n", __FILE__, __LINE__, svi, evi);
+    return PIDX_err_rst;
+  }
+
+  for (int v = svi; v <= evi; v++)
+  {
+    PIDX_variable var = rst_id->idx_metadata->variable[v];
+
+    for (uint32_t j = 0; j < var->restructured_super_patch->patch_count; j++)
+    {
+      free(var->restructured_super_patch->patch[j]->buffer);
+      var->restructured_super_patch->patch[j]->buffer = 0;
+    }
+  }
+
+  return PIDX_success;
+}
+
+
 // Create the buffer that holds all the patches of a super patch into one single patch
 PIDX_return_code PIDX_idx_rst_aggregate_buf_create(PIDX_idx_rst_id rst_id)
 {
@@ -67,6 +67,14 @@ PIDX_return_code PIDX_raw_rst_buf_aggregate_and_write(PIDX_raw_rst_id rst_id)
   char time_template[512];
   sprintf(time_template, "%%s/%s/%%d_%%d", rst_id->idx->filename_time_template);
 
+  // the files of all the groups are written together
+  PIDX_file_io_batch batch = PIDX_file_io_batch_create();
+  if (batch == NULL)
+  {
+    free(directory_path);
+    return PIDX_err_io;
+  }
+
   int g = 0;
   PIDX_variable var0 = rst_id->idx->variable[rst_id->first_index];
   for (g = 0; g < var0->raw_io_restructured_super_patch_count; ++g)
@@ -78,7 +86,15 @@ PIDX_return_code PIDX_raw_rst_buf_aggregate_and_write(PIDX_raw_rst_id rst_id)
     memset(file_name, 0, PATH_MAX * sizeof(*file_name));
 
     sprintf(file_name, time_template, directory_path, rst_id->idx->current_time_step, rst_id->idx_c->simulation_rank, g);
-    int fp = open(file_name, O_CREAT | O_WRONLY, 0664);
+    int fp = PIDX_file_io_batch_add_file(batch, file_name);
+    free(file_name);
+    if (fp < 0)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_add_file() failed.\n", __FILE__, __LINE__);
+      PIDX_file_io_batch_free(batch);
+      free(directory_path);
+      return PIDX_err_io;
+    }
 
     int v_start = 0, v_end = 0;
     int start_var_index = rst_id->first_index;
@@ -143,22 +159,29 @@ PIDX_return_code PIDX_raw_rst_buf_aggregate_and_write(PIDX_raw_rst_id rst_id)
       for (v1 = 0; v1 < v_start; v1++)
         data_offset = data_offset + (out_patch->size[0] * out_patch->size[1] * out_patch->size[2] * (rst_id->idx->variable[v1]->vps * (rst_id->idx->variable[v1]->bpv/8)));
 
+      // reg_patch_buffer is released with the batch
       uint64_t buffer_size =  out_patch->size[0] * out_patch->size[1] * out_patch->size[2] * bits;
-      uint64_t write_count = pwrite(fp, reg_patch_buffer, buffer_size, data_offset);
-      if (write_count != buffer_size)
+      if (PIDX_file_io_batch_add_write(batch, fp, reg_patch_buffer, buffer_size, data_offset, 1) != PIDX_success)
       {
-        fprintf(stderr, "[%s] [%d] pwrite() failed.\n", __FILE__, __LINE__);
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_add_write() failed.\n", __FILE__, __LINE__);
+        free(reg_patch_buffer);
+        PIDX_file_io_batch_free(batch);
+        free(directory_path);
         return PIDX_err_io;
       }
-
-      free(reg_patch_buffer);
       reg_patch_buffer = 0;
     }
-    close(fp);
-    free(file_name);
   }
   free(directory_path);
 
+  if (PIDX_file_io_batch_submit(batch) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_submit() failed.\n", __FILE__, __LINE__);
+    PIDX_file_io_batch_free(batch);
+    return PIDX_err_io;
+  }
+  PIDX_file_io_batch_free(batch);
+
   return PIDX_success;
 }
 
@@ -219,7 +242,7 @@ PIDX_return_code PIDX_raw_rst_buf_read_and_aggregate(PIDX_raw_rst_id rst_id)
 
       MPI_Status status;
       int ret = 0;
-      ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+      ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, rst_id->idx_c->access->info, &fh);
       if (ret != MPI_SUCCESS)
       {
         fprintf(stderr, "Line %d File %s File opening %s\n", __LINE__, __FILE__, file_name);
@@ -276,6 +299,14 @@ PIDX_return_code PIDX_raw_rst_buf_aggregated_write(PIDX_raw_rst_id rst_id)
   memset(directory_path, 0, sizeof(*directory_path) * PATH_MAX);
   strncpy(directory_path, rst_id->idx->filename, strlen(rst_id->idx->filename) - 4);
 
+  // the files of all the groups are written together
+  PIDX_file_io_batch batch = PIDX_file_io_batch_create();
+  if (batch == NULL)
+  {
+    free(directory_path);
+    return PIDX_err_io;
+  }
+
   PIDX_variable var0 = rst_id->idx->variable[rst_id->first_index];
   for (g = 0; g < var0->raw_io_restructured_super_patch_count; ++g)
   {
@@ -285,7 +316,15 @@ PIDX_return_code PIDX_raw_rst_buf_aggregated_write(PIDX_raw_rst_id rst_id)
     memset(file_name, 0, PATH_MAX * sizeof(*file_name));
 
     sprintf(file_name, "%s/time%09d/%d_%d", directory_path, rst_id->idx->current_time_step, rst_id->idx_c->simulation_rank, g);
-    int fp = open(file_name, O_CREAT | O_WRONLY, 0664);
+    int fp = PIDX_file_io_batch_add_file(batch, file_name);
+    free(file_name);
+    if (fp < 0)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_add_file() failed.\n", __FILE__, __LINE__);
+      PIDX_file_io_batch_free(batch);
+      free(directory_path);
+      return PIDX_err_io;
+    }
 
     int v_start = 0;
     int svi = rst_id->first_index;
@@ -305,19 +344,26 @@ PIDX_return_code PIDX_raw_rst_buf_aggregated_write(PIDX_raw_rst_id rst_id)
         data_offset = data_offset + (out_patch->size[0] * out_patch->size[1] * out_patch->size[2] * (rst_id->idx->variable[v1]->vps * (rst_id->idx->variable[v1]->bpv/8)));
 
       uint64_t buffer_size =  out_patch->size[0] * out_patch->size[1] * out_patch->size[2] * bits;
-      uint64_t write_count = pwrite(fp, var_start->raw_io_restructured_super_patch[g]->restructured_patch->buffer, buffer_size, data_offset);
-      if (write_count != buffer_size)
+      if (PIDX_file_io_batch_add_write(batch, fp, var_start->raw_io_restructured_super_patch[g]->restructured_patch->buffer, buffer_size, data_offset, 0) != PIDX_success)
       {
-        fprintf(stderr, "[%s] [%d] pwrite() failed.\n", __FILE__, __LINE__);
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_add_write() failed.\n", __FILE__, __LINE__);
+        PIDX_file_io_batch_free(batch);
+        free(directory_path);
         return PIDX_err_io;
       }
     }
-    close(fp);
-    free(file_name);
   }
 
   free(directory_path);
 
+  if (PIDX_file_io_batch_submit(batch) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_submit() failed.\n", __FILE__, __LINE__);
+    PIDX_file_io_batch_free(batch);
+    return PIDX_err_io;
+  }
+  PIDX_file_io_batch_free(batch);
+
   return PIDX_success;
 }
 
@@ -51,6 +51,9 @@ struct PIDX_HZ_Agg_buffer_struct
   int file_number;                                      ///< Target file number for the aggregator
   int var_number;                                       ///< Target variable number for the aggregator
 
+  int first_block;                                      ///< First block held (among the blocks present in the file)
+  int block_count;                                      ///< Number of blocks held (all of them without aggregation rounds)
+
   uint64_t buffer_size;                                 ///< Aggregator buffer size
   unsigned char* buffer;                                ///< The actual aggregator buffer
 };
@@ -114,6 +114,10 @@ int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_bl
   if (layout->resolution_to > maxH - res_to)
     adjusted_res_to = maxH - res_to;//layout->resolution_to - res_to;
 
+  PIDX_hz_index hz_index;
+  if (PIDX_hz_index_create(bitPattern, maxH - 1, &hz_index) != PIDX_success)
+    return PIDX_err_hz;
+
   ZYX_to = (uint64_t*) malloc(sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
   ZYX_from = (uint64_t*) malloc(sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
 
@@ -136,8 +140,8 @@ int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_bl
       memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
       memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
 
-      Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
-      Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
+      PIDX_hz_index_hz_to_xyz(hz_index, hz_from, ZYX_from);
+      PIDX_hz_index_hz_to_xyz(hz_index, hz_to, ZYX_to);
 
       if (ZYX_to[0] >= bounding_box[0][0] && ZYX_from[0] < bounding_box[1][0] && ZYX_to[1] >= bounding_box[0][1] && ZYX_from[1] < bounding_box[1][1] && ZYX_to[2] >= bounding_box[0][2] && ZYX_from[2] < bounding_box[1][2])
         layout->hz_block_number_array[m][0] = 0;
@@ -154,8 +158,8 @@ int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_bl
         memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
         memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
 
-        Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
-        Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
+        PIDX_hz_index_hz_to_xyz(hz_index, hz_from, ZYX_from);
+        PIDX_hz_index_hz_to_xyz(hz_index, hz_to, ZYX_to);
       
         if (ZYX_to[0] >= bounding_box[0][0] && ZYX_from[0] < bounding_box[1][0] && ZYX_to[1] >= bounding_box[0][1] && ZYX_from[1] < bounding_box[1][1] && ZYX_to[2] >= bounding_box[0][2] && ZYX_from[2] < bounding_box[1][2])
           layout->hz_block_number_array[m][t] = block_number;
@@ -179,8 +183,8 @@ int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_bl
           memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
           memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
 
-          Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
-          Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
+          PIDX_hz_index_hz_to_xyz(hz_index, hz_from, ZYX_from);
+          PIDX_hz_index_hz_to_xyz(hz_index, hz_to, ZYX_to);
 
           if (ZYX_to[0] >= bounding_box[0][0] && ZYX_from[0] < bounding_box[1][0] && ZYX_to[1] >= bounding_box[0][1] && ZYX_from[1] < bounding_box[1][1] && ZYX_to[2] >= bounding_box[0][2] && ZYX_from[2] < bounding_box[1][2])
             layout->hz_block_number_array[m][t] = block_number;
@@ -197,6 +201,8 @@ int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_bl
   free(ZYX_to);
   ZYX_to = 0;
 
+  PIDX_hz_index_free(hz_index);
+
   return 0;
 }
 
@@ -61,6 +61,11 @@ struct idx_comm_struct
   MPI_Comm partition_comm;      /// Communicator associated with every partition
   int partition_rank;           /// rank of a process within partition_comm
   int partition_nprocs;         /// number of processes in partition_comm
+
+
+  PIDX_access access;           /// access the file was created (opened) with, it holds the RMA aggregation window
+  int uses_access_comm;         /// 1 if simulation_comm is the communicator of the access (0 after PIDX_set_comm),
+                                /// the aggregation window and node map of the access are only used then
 };
 typedef struct idx_comm_struct* idx_comm;
 
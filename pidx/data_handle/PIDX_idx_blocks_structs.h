@@ -150,6 +150,13 @@ struct idx_blocks_struct
   int nfile0_agg_group_count;
 
   int agg_level;
+
+  // the aggregation of a file is done in rounds when the aggregation buffers do not fit in agg_memory_limit, round r
+  // covers the blocks [r * agg_blocks_per_round, (r + 1) * agg_blocks_per_round) of the blocks present in every file
+  int agg_blocks_per_round;
+  int agg_round_count;                          /// 1 when there is no limit
+  int agg_round;                                /// the round being aggregated
+
   PIDX_block_layout block_layout;               /// block layout for the entire idx file
   PIDX_block_layout* block_layout_by_agg_group; /// block layout for every agg group (file0_agg_group_count + nfile0_agg_group_count)
 
@@ -160,7 +167,7 @@ struct idx_blocks_struct
   int **block_bitmap;
 
   // you can ignore this, it is only used in one case (serial run), it stores offset of every block, for every variable in every idx file
-  int ***block_offset_bitmap;
+  uint64_t ***block_offset_bitmap;
 };
 typedef struct idx_blocks_struct* idx_blocks;
 
@@ -86,6 +86,7 @@ struct idx_file_struct
   int maxh;                                         /// total number of hz levels
   char bitSequence[512];                            /// bitsequence used for HZ indexing, controls the layout
   char bitPattern[512];
+  PIDX_hz_index hz_index;                           /// HZ addressing tables for bitPattern (built on first use, see PIDX_hz_index_acquire)
 
   int particle_regridding_factor;
   float restructuring_factor[PIDX_MAX_DIMENSIONS];    /// To be used for restructuring only (controls two phase IO)
@@ -93,6 +94,9 @@ struct idx_file_struct
   int compression_type;
   int compression_factor;
   float compression_bit_rate;
+  double zfp_accuracy;                              /// absolute error tolerance of PIDX_CHUNKING_ZFP_ACCURACY
+  int zfp_precision;                                /// bit planes kept by PIDX_CHUNKING_ZFP_PRECISION
+  uint64_t* packed_file_end;                        /// end of the packed blocks written to each file (max_file_count) by the variable size ZFP modes
   uint64_t chunk_size[PIDX_MAX_DIMENSIONS];
 
   int particle_res_base;
@@ -112,6 +116,26 @@ struct idx_file_struct
 
   int cached_ts;                                    /// used for raw io, to cache meta data (1) or not (0)
 
+  int thread_count;                                 /// number of threads used for HZ encoding and decoding
+
+  int fused_restructure;                            /// HZ encode the restructured patches directly when writing without compression (1) or not (0)
+
+  int aggregation_backend;                          /// PIDX_RMA_AGGREGATION, PIDX_ALLTOALL_AGGREGATION or PIDX_P2P_AGGREGATION
+
+  int aggregators_per_node;                         /// maximum number of aggregators placed on one node (0 no limit)
+  int shm_aggregation;                              /// combine the pieces of a node in shared memory before RMA aggregation (1) or not (0)
+  unsigned long long agg_memory_limit;              /// bytes of aggregation buffers a process may hold at once (0 no limit)
+  int collective_io;                                /// the aggregators of a file write it with collective MPI-IO (1) or independently (0)
+  int io_backend;                                   /// PIDX_MPI_IO_BACKEND, PIDX_POSIX_IO_BACKEND, PIDX_DIRECT_IO_BACKEND or PIDX_MMAP_IO_BACKEND
+  int read_access_pattern;                          /// PIDX_READ_ACCESS_NORMAL, PIDX_READ_ACCESS_SEQUENTIAL or PIDX_READ_ACCESS_RANDOM
+  int file_cache_open_limit;                        /// binary files kept open by the readers
+  int file_cache_header_limit;                      /// binary file headers kept by the readers
+  struct PIDX_file_io_cache_struct* file_cache;     /// open binary files and headers of the readers (see PIDX_file_io_cache_get)
+  char staging_directory[PIDX_FILE_PATH_LENGTH];    /// node local directory the binary files are written to and drained from (empty for none)
+  int agg_map_count;                                /// number of aggregators of the last flush in agg_map
+  int agg_map_capacity;
+  int *agg_map;                                     /// PIDX_AGG_MAP_ENTRY_SIZE ints (file, variable, rank, node) per aggregator
+
   unsigned long long max_file_size;
 };
 typedef struct idx_file_struct* idx_dataset;
@@ -99,6 +99,10 @@ struct PIDX_timming_struct
   double **agg_compress_start, **agg_compress_end;
   double **agg_meta_cleanup_start, **agg_meta_cleanup_end;
 
+  uint64_t agg_rma_segment_count;                 ///< contiguous pieces moved by aggregation (one RMA call each without coalescing)
+  uint64_t agg_rma_op_count;                      ///< RMA calls actually issued by aggregation
+  uint64_t agg_rma_byte_count;                    ///< bytes moved by aggregation
+
   double *io_start, *io_end;
 };
 typedef struct PIDX_timming_struct* PIDX_time;
@@ -89,6 +89,27 @@ PIDX_return_code PIDX_write(PIDX_io file, int svi, int evi, int MODE)
   else
 #endif
 
+  // the files cached by the readers may be rewritten
+  PIDX_file_io_cache_free(file->idx->file_cache);
+  file->idx->file_cache = NULL;
+
+  // the RMA aggregation window and the node map used to place the aggregators are created once per access, by the
+  // first flush that needs them
+  if (MODE == PIDX_IDX_IO || MODE == PIDX_LOCAL_PARTITION_IDX_IO)
+  {
+    if (file->idx->aggregation_backend == PIDX_RMA_AGGREGATION && PIDX_agg_window_create(file->idx_c) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+
+    if (PIDX_agg_node_map_create(file->idx_c) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+  }
+
   if (MODE == PIDX_IDX_IO)
     ret = PIDX_idx_write(file, svi, evi);
 
@@ -135,6 +156,22 @@ PIDX_return_code PIDX_read(PIDX_io file, int svi, int evi, int MODE)
   PIDX_return_code ret = 0;
   file->time->SX = PIDX_get_time();
 
+  // the RMA aggregation window and the node map used to place the aggregators are created once per access, by the
+  // first flush that needs them
+  if (MODE == PIDX_IDX_IO || MODE == PIDX_LOCAL_PARTITION_IDX_IO)
+  {
+    if (file->idx->aggregation_backend == PIDX_RMA_AGGREGATION && PIDX_agg_window_create(file->idx_c) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+
+    if (PIDX_agg_node_map_create(file->idx_c) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+  }
 
   if (MODE == PIDX_IDX_IO)
     ret = PIDX_idx_read(file, svi, evi);
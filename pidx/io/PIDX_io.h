@@ -52,6 +52,13 @@ struct PIDX_io_descriptor
 
   int variable_index_tracker;                       ///< tracking upto which variable io has been done (used for flushing)
 
+  int fused_restructure;                            ///< the restructured patches are HZ encoded directly (no super patch and no chunked copy)
+
+  int async_write;                                  ///< the file writes are left pending in the access (PIDX_flush_async)
+
+  int header_first_index;                           ///< variables of the headers written by the aggregators with the data
+  int header_last_index;                            ///< (file_io_writes_header), both 0 when the headers are written apart
+
   // Different IO phases
   PIDX_header_io_id header_io_id;                   ///< Creates the file hierarchy and populates the raw header
   // only one of the three is activated at a time
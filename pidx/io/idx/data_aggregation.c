@@ -108,6 +108,10 @@ PIDX_return_code aggregation(PIDX_io file, int svi, int mode )
         return PIDX_err_agg;
       }
       time->agg_end[svi][j] = PIDX_get_time();
+
+      time->agg_rma_segment_count += file->agg_id[svi][j]->rma_segment_count;
+      time->agg_rma_op_count += file->agg_id[svi][j]->rma_op_count;
+      time->agg_rma_byte_count += file->agg_id[svi][j]->rma_byte_count;
     }
 
     time->agg_meta_cleanup_start[svi][j] = PIDX_get_time();
@@ -129,13 +133,19 @@ PIDX_return_code aggregation_cleanup(PIDX_io file, int start_index)
   for (uint32_t i = file->idx_b->file0_agg_group_from_index; i < file->idx_b->agg_level; i++)
   {
     uint32_t i_1 = i - file->idx_b->file0_agg_group_from_index;
-    if (PIDX_agg_buf_destroy(file->idx->agg_buffer[start_index][i_1]) != PIDX_success)
+
+    // the buffer of a pending write (PIDX_flush_async) belongs to the access now
+    if (file->idx->agg_buffer[start_index][i_1] != NULL)
     {
-      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-      return PIDX_err_agg;
+      if (PIDX_agg_buf_destroy(file->idx->agg_buffer[start_index][i_1]) != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_agg;
+      }
+
+      free(file->idx->agg_buffer[start_index][i_1]);
     }
 
-    free(file->idx->agg_buffer[start_index][i_1]);
     PIDX_agg_finalize(file->agg_id[start_index][i_1]);
   }
 
@@ -42,13 +42,71 @@
 
 
 
+static PIDX_return_code async_write(PIDX_io file, int svi, int agg_group);
+static PIDX_return_code collective_write(PIDX_io file, int svi, int agg_group);
+static PIDX_return_code blocking_write(PIDX_io file, int svi, int agg_group);
+static PIDX_return_code packed_write(PIDX_io file, int svi, int agg_group);
+static int header_agg_group(PIDX_io file, int file_number);
+
+
+// the writes of the aggregators of the agg groups go through PIDX_file_io_blocking_write (or PIDX_file_io_packed_write)
+static int blocking_write_path(PIDX_io file)
+{
+  if (file->idx_dbg->debug_do_io != 1)
+    return 0;
+
+  if (file->idx->staging_directory[0] != '\0' || PIDX_compression_variable_size(file->idx))
+    return 1;
+
+  return file->idx->collective_io == 0 && file->async_write == 0;
+}
+
+
+
+int file_io_writes_header(PIDX_io file, int file_number)
+{
+  // the headers of the packed files are written block by block (packed_write)
+  if (PIDX_compression_variable_size(file->idx))
+    return 0;
+
+  return blocking_write_path(file) && header_agg_group(file, file_number) != -1;
+}
+
+
+
+// first agg group with blocks of the file, the aggregator of the first block of its first variable writes the header
+static int header_agg_group(PIDX_io file, int file_number)
+{
+  for (uint32_t j = file->idx_b->file0_agg_group_from_index; j < file->idx_b->agg_level; j++)
+  {
+    PIDX_block_layout layout = file->idx_b->block_layout_by_agg_group[j];
+    if (layout->file_bitmap[file_number] == 1 && layout->bcpf[file_number] > 0)
+      return j;
+  }
+
+  return -1;
+}
+
+
 PIDX_return_code file_io(PIDX_io file, int svi, int mode)
 {
   int ret = 0;
   assert(file->idx_b->file0_agg_group_from_index == 0);
   PIDX_time time = file->time;
 
+  // Double buffering of PIDX_flush_async: the aggregation buffers of this round were filled while the previous ones
+  // were being written, those writes have to complete before the new ones start
+  if (mode == PIDX_WRITE && file->async_write == 1 && file->idx->collective_io == 0)
+  {
+    if (PIDX_file_io_pending_wait(file->idx_c->access) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_io;
+    }
+  }
+
   time->io_start[svi] = PIDX_get_time();
+  int blocking = blocking_write_path(file);
   for (uint32_t j = file->idx_b->file0_agg_group_from_index; j < file->idx_b->agg_level; j++)
   {
     Agg_buffer temp_agg = file->idx->agg_buffer[svi][j];
@@ -56,10 +114,31 @@ PIDX_return_code file_io(PIDX_io file, int svi, int mode)
 
     file->io_id[svi][j] = PIDX_file_io_init(file->idx, file->idx_c, file->fs_block_size, svi, svi);
 
-    if (file->idx_dbg->debug_do_io == 1)
+    if (file->idx_dbg->debug_do_io == 1 && mode == PIDX_WRITE && file->idx->collective_io == 1 && blocking == 0)
     {
-      if (mode == PIDX_WRITE)
-        ret = PIDX_file_io_blocking_write(file->io_id[svi][j], temp_agg, temp_layout, file->idx->filename_template_partition);
+      ret = collective_write(file, svi, j);
+      if (ret != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_io;
+      }
+    }
+    // the staged and the packed files are written blocking, every staged write is handed to the drain when it is done
+    else if (file->idx_dbg->debug_do_io == 1 && mode == PIDX_WRITE && file->async_write == 1 && blocking == 0)
+    {
+      ret = async_write(file, svi, j);
+      if (ret != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_io;
+      }
+    }
+    else if (file->idx_dbg->debug_do_io == 1)
+    {
+      if (mode == PIDX_WRITE && PIDX_compression_variable_size(file->idx))
+        ret = packed_write(file, svi, j);
+      else if (mode == PIDX_WRITE)
+        ret = blocking_write(file, svi, j);
       else
         ret = PIDX_file_io_blocking_read(file->io_id[svi][j], temp_agg, temp_layout, file->idx->filename_template_partition);
 
@@ -75,3 +154,166 @@ PIDX_return_code file_io(PIDX_io file, int svi, int mode)
 
   return PIDX_success;
 }
+
+
+
+// Starts the write of the aggregation buffer of an aggregation group and hands it over to the access, the buffer is
+// destroyed when the write completes instead of by aggregation_cleanup
+static PIDX_return_code async_write(PIDX_io file, int svi, int agg_group)
+{
+  Agg_buffer agg_buf = file->idx->agg_buffer[svi][agg_group];
+  MPI_File fh;
+  MPI_Request request;
+
+  if (agg_buf->var_number == -1 || agg_buf->file_number == -1)
+    return PIDX_success;
+
+  if (PIDX_file_io_async_write(file->io_id[svi][agg_group], agg_buf, file->idx_b->block_layout_by_agg_group[agg_group], &request, &fh, file->idx->filename_template_partition) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  if (PIDX_file_io_pending_add(file->idx_c->access, agg_buf, fh, request) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+  file->idx->agg_buffer[svi][agg_group] = NULL;
+
+  return PIDX_success;
+}
+
+
+
+// The aggregators of the pack writing to the same file (one per variable) write it together, every process of the
+// partition takes part in the split
+static PIDX_return_code collective_write(PIDX_io file, int svi, int agg_group)
+{
+  Agg_buffer agg_buf = file->idx->agg_buffer[svi][agg_group];
+  MPI_Comm file_comm;
+
+  int color = (agg_buf->var_number == -1 || agg_buf->file_number == -1) ? MPI_UNDEFINED : agg_buf->file_number;
+  if (MPI_Comm_split(file->idx_c->partition_comm, color, file->idx_c->partition_rank, &file_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  if (file_comm == MPI_COMM_NULL)
+    return PIDX_success;
+
+  int ret = PIDX_file_io_collective_write(file->io_id[svi][agg_group], agg_buf, file->idx_b->block_layout_by_agg_group[agg_group], file_comm, file->idx->filename_template_partition);
+  MPI_Comm_free(&file_comm);
+
+  return ret;
+}
+
+
+
+// Writes the aggregation buffer of an aggregation group, and the header of its file if the buffer starts the file
+// (file_io_writes_header)
+static PIDX_return_code blocking_write(PIDX_io file, int svi, int agg_group)
+{
+  Agg_buffer agg_buf = file->idx->agg_buffer[svi][agg_group];
+  uint32_t* headers = NULL;
+  uint64_t header_size = 0;
+
+  if (file->header_last_index != 0 && agg_buf->var_number == file->header_first_index && agg_buf->file_number != -1 && agg_buf->first_block == 0 && header_agg_group(file, agg_buf->file_number) == agg_group)
+  {
+    header_size = (10 + (10 * file->idx->blocks_per_file)) * sizeof (uint32_t) * file->idx->variable_count;
+    headers = malloc(header_size);
+    if (headers == NULL)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_io;
+    }
+    PIDX_header_io_file_header(file->idx, file->idx_b->block_layout, file->fs_block_size, agg_buf->file_number, file->header_first_index, file->header_last_index, headers);
+  }
+
+  int ret = PIDX_file_io_blocking_write(file->io_id[svi][agg_group], agg_buf, file->idx_b->block_layout_by_agg_group[agg_group], file->idx->filename_template_partition, headers, header_size);
+  free(headers);
+
+  return ret;
+}
+
+
+
+// Compresses the IDX blocks of the aggregation buffer of an aggregation group and packs them after the blocks already
+// written to its file (idx->packed_file_end). Every process of the partition takes part, the aggregators of a file
+// place their blocks one after the other in rank order.
+static PIDX_return_code packed_write(PIDX_io file, int svi, int agg_group)
+{
+  Agg_buffer agg_buf = file->idx->agg_buffer[svi][agg_group];
+  unsigned char* compressed = NULL;
+  uint64_t* block_size = NULL;
+  long long packed[2] = {-1, 0};
+
+  // a process that fails to compress still takes part in the exchange, with file -2, so that all of them give up
+  if (agg_buf->var_number != -1 && agg_buf->file_number != -1)
+  {
+    block_size = malloc(agg_buf->block_count * sizeof (*block_size));
+    if (block_size == NULL)
+      packed[0] = -2;
+    else
+    {
+      memset(block_size, 0, agg_buf->block_count * sizeof (*block_size));
+      if (PIDX_compression_encode_blocks(file->idx, file->idx->variable[agg_buf->var_number], agg_buf->buffer, agg_buf->block_count, &compressed, block_size) != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        packed[0] = -2;
+      }
+      else
+      {
+        packed[0] = agg_buf->file_number;
+        for (int b = 0; b < agg_buf->block_count; b++)
+          packed[1] = packed[1] + block_size[b];
+      }
+    }
+  }
+
+  long long* all_packed = malloc(2 * file->idx_c->partition_nprocs * sizeof (*all_packed));
+  if (MPI_Allgather(packed, 2, MPI_LONG_LONG, all_packed, 2, MPI_LONG_LONG, file->idx_c->partition_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    free(all_packed);
+    free(compressed);
+    free(block_size);
+    return PIDX_err_io;
+  }
+
+  for (int r = 0; r < file->idx_c->partition_nprocs; r++)
+  {
+    if (all_packed[2 * r] == -2)
+    {
+      free(all_packed);
+      free(compressed);
+      free(block_size);
+      return PIDX_err_compress;
+    }
+  }
+
+  uint64_t data_offset = 0;
+  if (packed[0] != -1)
+  {
+    data_offset = file->idx->packed_file_end[packed[0]];
+    for (int r = 0; r < file->idx_c->partition_rank; r++)
+    {
+      if (all_packed[2 * r] == packed[0])
+        data_offset = data_offset + all_packed[2 * r + 1];
+    }
+  }
+
+  for (int r = 0; r < file->idx_c->partition_nprocs; r++)
+  {
+    if (all_packed[2 * r] != -1)
+      file->idx->packed_file_end[all_packed[2 * r]] = file->idx->packed_file_end[all_packed[2 * r]] + all_packed[2 * r + 1];
+  }
+  free(all_packed);
+
+  int ret = PIDX_file_io_packed_write(file->io_id[svi][agg_group], agg_buf, file->idx_b->block_layout_by_agg_group[agg_group], file->idx->filename_template_partition, compressed, block_size, data_offset);
+  free(compressed);
+  free(block_size);
+
+  return ret;
+}
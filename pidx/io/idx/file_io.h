@@ -43,4 +43,8 @@
 
 PIDX_return_code file_io(PIDX_io file, int start_index, int mode);
 
+/// Whether the header of the binary file is written by an aggregator with the data (file_io) rather than by
+/// write_headers
+int file_io_writes_header(PIDX_io file, int file_number);
+
 #endif
@@ -42,7 +42,8 @@
 #include "timming.h"
 
 
-static PIDX_return_code write_idx_headers_layout(PIDX_io file, int start_var_index, int end_var_index, char* filename, char* filename_template, PIDX_block_layout bl);
+static PIDX_return_code write_idx_headers_layout(PIDX_io file, int start_var_index, int end_var_index, char* filename, char* filename_template, char* dataset_filename_template, PIDX_block_layout bl);
+static void reset_packed_file_end(PIDX_io file);
 
 PIDX_return_code write_global_idx(PIDX_io file, int start_var_index, int end_var_index, int mode)
 {
@@ -82,12 +83,25 @@ PIDX_return_code write_headers(PIDX_io file, int start_var_index, int end_var_in
   
   generate_file_name_template(file->idx->maxh, file->idx->bits_per_block, file->idx->filename_partition, file->idx->filename_time_template, file->idx->current_time_step, file->idx->filename_template_partition);
 
+  // the binary files are written below a directory of the process in the staging directory and drained to the dataset
+  // (the .idx file is not staged). The processes of a node do not share staged files, each one removes its own.
+  char filename_template[PIDX_FILE_PATH_LENGTH];
+  strcpy(filename_template, file->idx->filename_template_partition);
+  if (mode == PIDX_WRITE && file->idx->staging_directory[0] != '\0')
+  {
+    if (snprintf(file->idx->filename_template_partition, PIDX_FILE_PATH_LENGTH, "%s/%d/%s", file->idx->staging_directory, file->idx_c->simulation_rank, filename_template) >= PIDX_FILE_PATH_LENGTH)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_name;
+    }
+  }
+
   //fprintf(stderr, "(maxh %d) FN %s FNT %s\n",file->idx->maxh, file->idx->filename_partition, file->idx->filename_template_partition);
 
   if (mode == PIDX_READ)
     return PIDX_success;
 
-  if (write_idx_headers_layout(file, start_var_index, end_var_index, file->idx->filename_partition, file->idx->filename_template_partition, file->idx_b->block_layout) != PIDX_success)
+  if (write_idx_headers_layout(file, start_var_index, end_var_index, file->idx->filename_partition, file->idx->filename_template_partition, filename_template, file->idx_b->block_layout) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_file;
@@ -98,37 +112,72 @@ PIDX_return_code write_headers(PIDX_io file, int start_var_index, int end_var_in
 
 
 
-static PIDX_return_code write_idx_headers_layout(PIDX_io file, int start_var_index, int end_var_index, char* filename, char* filename_template, PIDX_block_layout bl)
+static PIDX_return_code write_idx_headers_layout(PIDX_io file, int start_var_index, int end_var_index, char* filename, char* filename_template, char* dataset_filename_template, PIDX_block_layout bl)
 {
   if (file->idx_dbg->debug_do_io == 1)
   {
     /* STEP 1 */
     file->header_io_id = PIDX_header_io_init(file->idx, file->idx_c, file->idx_b, file->restructured_grid, file->fs_block_size, start_var_index, end_var_index);
 
-    if (PIDX_header_io_idx_file_create(file->header_io_id, bl, filename_template) != PIDX_success)
+    // the directories of the dataset, on the first flush of the time step (the staged files are in directories of
+    // their process, created by their writer, the drain finds the ones of the dataset)
+    if (start_var_index == 0 && PIDX_header_io_idx_file_directories(file->header_io_id, bl, dataset_filename_template) != PIDX_success)
     {
       fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
       return PIDX_err_header;
     }
 
     /* STEP 2 */
-    if (file->variable_index_tracker < file->idx->variable_count )
+    file->header_first_index = 0;
+    file->header_last_index = 0;
+    // the entries of the packed blocks of the variable size ZFP modes are written by their aggregators (file_io), the
+    // first flush of the time step starts the files over (the empty headers are not staged)
+    if (PIDX_compression_variable_size(file->idx))
+    {
+      if (PIDX_header_io_idx_file_write(file->header_io_id, bl, filename_template, NULL, 0) != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_header;
+      }
+
+      if (start_var_index == 0)
+      {
+        reset_packed_file_end(file);
+        if (PIDX_header_io_idx_file_clear(file->header_io_id, bl, dataset_filename_template) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_header;
+        }
+      }
+    }
+    else if (file->variable_index_tracker < file->idx->variable_count )
     {
       // Create the header
-      if (PIDX_header_io_idx_file_write(file->header_io_id, bl, filename_template,  0) != PIDX_success)
+      if (PIDX_header_io_idx_file_write(file->header_io_id, bl, filename_template, NULL, 0) != PIDX_success)
       {
         fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
         return PIDX_err_header;
       }
     }
-
-    if (file->variable_index_tracker == file->idx->variable_count)
+    else if (file->variable_index_tracker == file->idx->variable_count)
     {
-      if (PIDX_header_io_idx_file_write(file->header_io_id, bl, filename_template, 1) != PIDX_success)
+      // the aggregator of the first block of a file writes its header together with its data (no file is created and
+      // written ahead of the data), the other files get theirs from the round robin writer
+      int* fused_file_bitmap = malloc(file->idx->max_file_count * sizeof (*fused_file_bitmap));
+      memset(fused_file_bitmap, 0, file->idx->max_file_count * sizeof (*fused_file_bitmap));
+      for (int i = 0; i < file->idx->max_file_count; i++)
+        fused_file_bitmap[i] = (bl->file_bitmap[i] == 1 && file_io_writes_header(file, i));
+
+      file->header_first_index = start_var_index;
+      file->header_last_index = end_var_index;
+
+      if (PIDX_header_io_idx_file_write(file->header_io_id, bl, filename_template, fused_file_bitmap, 1) != PIDX_success)
       {
         fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        free(fused_file_bitmap);
         return PIDX_err_header;
       }
+      free(fused_file_bitmap);
     }
 
     /* STEP 3 */
@@ -150,6 +199,22 @@ static PIDX_return_code write_idx_headers_layout(PIDX_io file, int start_var_ind
 
 
 
+// the packed blocks of the files start at the first file system block after the header
+static void reset_packed_file_end(PIDX_io file)
+{
+  uint64_t total_header_size = (10 + (10 * file->idx->blocks_per_file)) * sizeof (uint32_t) * file->idx->variable_count;
+  uint64_t start_fs_block = total_header_size / file->fs_block_size;
+  if (total_header_size % file->fs_block_size)
+    start_fs_block++;
+
+  free(file->idx->packed_file_end);
+  file->idx->packed_file_end = malloc(file->idx->max_file_count * sizeof (*file->idx->packed_file_end));
+  for (int i = 0; i < file->idx->max_file_count; i++)
+    file->idx->packed_file_end[i] = start_fs_block * file->fs_block_size;
+}
+
+
+
 //
 PIDX_return_code raw_headers_create_folder_structure(PIDX_io file, int start_var_index, int end_var_index, char* filename)
 {
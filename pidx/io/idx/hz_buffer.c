@@ -169,6 +169,14 @@ static PIDX_return_code hz_init(PIDX_io file, int svi, int evi)
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_rst;
   }
+
+  // encode the restructured patches directly
+  ret = PIDX_hz_encode_set_fused_restructure(file->hz_id, file->fused_restructure);
+  if (ret != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_rst;
+  }
   time->hz_init_end[cvi] = PIDX_get_time();
 
   return PIDX_success;
@@ -237,12 +245,15 @@ static PIDX_return_code buffer_create(PIDX_io file)
   PIDX_time time = file->time;
 
   time->chunk_buffer_start[cvi] = PIDX_get_time();
-  // Creating the buffers required for chunking
-  ret = PIDX_chunk_buf_create(file->chunk_id);
-  if (ret != PIDX_success)
+  // Creating the buffers required for chunking (the HZ encoding reads the restructured patches when fused)
+  if (file->fused_restructure == 0)
   {
-    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-    return PIDX_err_chunk;
+    ret = PIDX_chunk_buf_create(file->chunk_id);
+    if (ret != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_chunk;
+    }
   }
   time->chunk_buffer_end[cvi] = PIDX_get_time();
 
@@ -267,7 +278,7 @@ static PIDX_return_code compress_and_encode(PIDX_io file)
 
   time->chunk_start[cvi] = PIDX_get_time();
   // Perform Chunking
-  if (file->idx_dbg->debug_do_chunk == 1)
+  if (file->idx_dbg->debug_do_chunk == 1 && file->fused_restructure == 0)
   {
     ret = PIDX_chunk(file->chunk_id, PIDX_WRITE);
     if (ret != PIDX_success)
@@ -297,7 +308,7 @@ static PIDX_return_code compress_and_encode(PIDX_io file)
   if (file->idx_dbg->debug_do_hz == 1)
   {
     time->hz_start[cvi] = PIDX_get_time();
-    ret = PIDX_hz_encode_write(file->hz_id);
+    ret = PIDX_hz_encode_fast_write(file->hz_id);
     if (ret != PIDX_success)
     {
       fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
@@ -321,7 +332,7 @@ static PIDX_return_code compress_and_encode(PIDX_io file)
 
   time->chunk_buffer_free_start[cvi] = PIDX_get_time();
   // Destroy buffers allocated during chunking phase
-  if (PIDX_chunk_buf_destroy(file->chunk_id) != PIDX_success)
+  if (file->fused_restructure == 0 && PIDX_chunk_buf_destroy(file->chunk_id) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_chunk;
@@ -351,7 +362,7 @@ static PIDX_return_code encode_and_uncompress(PIDX_io file)
   // Perform HZ encoding
   if (file->idx_dbg->debug_do_hz == 1)
   {
-    ret = PIDX_hz_encode_read(file->hz_id);
+    ret = PIDX_hz_encode_fast_read(file->hz_id);
     if (ret != PIDX_success)
     {
       fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
@@ -77,7 +77,8 @@ PIDX_return_code idx_restructure_setup(PIDX_io file, int svi, int evi)
 
 
   // Aggregating the aligned small buffers after restructuring into one single buffer
-  if (PIDX_idx_rst_aggregate_buf_create(file->idx_rst_id) != PIDX_success)
+  // (not needed when the restructured patches are HZ encoded directly)
+  if (file->fused_restructure == 0 && PIDX_idx_rst_aggregate_buf_create(file->idx_rst_id) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_rst;
@@ -111,6 +112,11 @@ PIDX_return_code idx_restructure(PIDX_io file, int mode)
         if (ret != PIDX_success) {fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__); return PIDX_err_rst;}
       }
 
+      // With fused restructuring the restructured buffers are HZ encoded as they are, and freed one pack of variables
+      // at a time (idx_restructure_buf_destroy)
+      if (file->fused_restructure == 1)
+        return PIDX_success;
+
       // Aggregating in memory restructured buffers into one large buffer
       time->rst_buff_agg_start[cvi] = PIDX_get_time();
       ret = PIDX_idx_rst_buf_aggregate(file->idx_rst_id, PIDX_WRITE);
@@ -160,6 +166,23 @@ PIDX_return_code idx_restructure(PIDX_io file, int mode)
 
 
 
+PIDX_return_code idx_restructure_buf_destroy(PIDX_io file, int svi, int evi)
+{
+  PIDX_time time = file->time;
+
+  time->rst_buff_agg_free_start[cvi] = PIDX_get_time();
+  if (PIDX_idx_rst_buf_destroy_variables(file->idx_rst_id, svi, evi) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_rst;
+  }
+  time->rst_buff_agg_free_end[cvi] = PIDX_get_time();
+
+  return PIDX_success;
+}
+
+
+
 PIDX_return_code idx_restructure_io(PIDX_io file, int mode)
 {
   int ret = 0;
@@ -199,6 +222,12 @@ PIDX_return_code idx_restructure_cleanup(PIDX_io file)
 
   // Destroy buffers allocated during restructuring phase
   time->rst_cleanup_start[cvi] = PIDX_get_time();
+  if (file->fused_restructure == 1 && PIDX_idx_rst_buf_destroy(file->idx_rst_id) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_rst;
+  }
+
   if (PIDX_idx_rst_aggregate_buf_destroy(file->idx_rst_id) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
@@ -66,6 +66,18 @@ PIDX_return_code idx_restructure(PIDX_io file, int mode);
 
 
 
+///
+/// \brief idx_restructure_buf_destroy Frees the restructured patches of variables svi to evi once they are HZ encoded
+/// (fused restructuring only)
+/// \param file
+/// \param svi
+/// \param evi
+/// \return
+///
+PIDX_return_code idx_restructure_buf_destroy(PIDX_io file, int svi, int evi);
+
+
+
 ///
 /// \brief restructure_io
 /// \param file
@@ -143,5 +143,68 @@ PIDX_return_code find_agg_level(PIDX_io file, int svi, int evi)
   //if (file->idx_c->partition_rank == 0)
   //  fprintf(stderr, "agg level %d pipe length %d\n", file->idx_b->agg_level, file->idx->variable_pipe_length);
 
+  // the blocks of the variable size ZFP modes are compressed whole by their aggregator, the levels written directly
+  // by HZ IO (parts of blocks) can not be compressed
+  if (PIDX_compression_variable_size(file->idx) && file->idx_b->agg_level < file->idx_b->file0_agg_group_count + file->idx_b->nfile0_agg_group_count)
+  {
+    if (file->idx_c->partition_rank == 0)
+      fprintf(stderr, "[%s] [%d] compression type %d needs every level aggregated (aggregation disabled or fewer processes than aggregators)\n", __FILE__, __LINE__, file->idx->compression_type);
+    return PIDX_err_file;
+  }
+
+  // checked by every process before the aggregation, the aggregators compress the variables they hold only
+  if (PIDX_compression_variable_size(file->idx))
+  {
+    for (int v = svi; v < evi; v++)
+    {
+      if (!PIDX_compression_variable_supported(file->idx, file->idx->variable[v]))
+      {
+        if (file->idx_c->partition_rank == 0)
+          fprintf(stderr, "[%s] [%d] compression type %d does not support variable %d (type %s)\n", __FILE__, __LINE__, file->idx->compression_type, v, file->idx->variable[v]->type_name);
+        return PIDX_err_file;
+      }
+    }
+  }
+
+  // Split the aggregation of every file in rounds of blocks so that the aggregation buffers of a process (at most one
+  // per aggregation group) stay within agg_memory_limit
+  int max_bcpf = 0;
+  for (int j = 0; j < file->idx_b->agg_level; j++)
+  {
+    PIDX_block_layout layout = file->idx_b->block_layout_by_agg_group[j];
+    for (int k = 0; k < layout->efc; k++)
+    {
+      if (layout->bcpf[layout->existing_file_index[k]] > max_bcpf)
+        max_bcpf = layout->bcpf[layout->existing_file_index[k]];
+    }
+  }
+
+  file->idx_b->agg_blocks_per_round = (max_bcpf == 0) ? 1 : max_bcpf;
+  if (file->idx->agg_memory_limit != 0 && max_bcpf != 0)
+  {
+    int chunk_size = file->idx->chunk_size[0] * file->idx->chunk_size[1] * file->idx->chunk_size[2];
+    uint64_t bytes_per_block = 0;
+    for (int v = svi; v < evi; v++)
+    {
+      uint64_t bytes = (uint64_t) file->idx->samples_per_block * ((chunk_size * file->idx->variable[v]->bpv/8) / file->idx->compression_factor);
+      if (bytes > bytes_per_block)
+        bytes_per_block = bytes;
+    }
+
+    uint64_t blocks_per_round = file->idx->agg_memory_limit / ((uint64_t) file->idx_b->agg_level * bytes_per_block);
+    if (blocks_per_round == 0)
+    {
+      if (file->idx_c->simulation_rank == 0)
+        fprintf(stderr, "[%s] [%d] Warning: aggregation memory limit %llu is below one block per buffer (%llu bytes), using one block per round\n", __FILE__, __LINE__, file->idx->agg_memory_limit, (unsigned long long) (file->idx_b->agg_level * bytes_per_block));
+      blocks_per_round = 1;
+    }
+    if (blocks_per_round < (uint64_t) max_bcpf)
+      file->idx_b->agg_blocks_per_round = (int) blocks_per_round;
+  }
+  file->idx_b->agg_round_count = (max_bcpf + file->idx_b->agg_blocks_per_round - 1) / file->idx_b->agg_blocks_per_round;
+  if (file->idx_b->agg_round_count == 0)
+    file->idx_b->agg_round_count = 1;
+  file->idx_b->agg_round = 0;
+
   return PIDX_success;
 }
@@ -41,7 +41,7 @@
 #include "../../../PIDX_inc.h"
 
 static PIDX_return_code parse_local_partition_idx_file(PIDX_io file, int partition_index);
-static PIDX_return_code read_block(PIDX_io file, int vi, int p, int block_number, uint64_t *patch_offset, uint64_t *patch_size, unsigned char* patch_buffer);
+static PIDX_return_code read_blocks(PIDX_io file, int vi, uint32_t* block_numbers, int block_count, uint64_t *patch_offset, uint64_t *patch_size, unsigned char* patch_buffer);
 
 
 PIDX_return_code PIDX_local_partition_idx_generic_read(PIDX_io file, int svi, int evi)
@@ -150,36 +150,43 @@ PIDX_return_code PIDX_local_partition_idx_generic_read(PIDX_io file, int svi, in
           }
 
 
+          // the first block contains data from a lot of hz levels, it is followed by the blocks from HZ level
+          // file->idx->bits_per_block + 1 to per_patch_local_block_layout->resolution_to
+          int block_count = 1;
           uint32_t ctr = 1;
-          uint32_t block_number = 0;
-
-          // read the first block, the first block contains data from a lot of hz levels, so just make one accumulated read
-          if (read_block(file, si, p, block_number, intersected_box_offset, intersected_box_size, intersected_box_buffer) != PIDX_success)
+          for (uint32_t i = file->idx->bits_per_block + 1 ; i < per_patch_local_block_layout->resolution_to ; i++)
           {
-            fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-            return PIDX_err_io;
+            for (uint32_t j = 0 ; j < ctr ; j++)
+            {
+              if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
+                block_count++;
+            }
+            ctr = ctr * 2;
           }
 
-          // Iterate through the blocks from HZ level file->idx->bits_per_block + 1 to per_patch_local_block_layout->resolution_to
+          uint32_t *block_numbers = malloc(block_count * sizeof (*block_numbers));
+          memset(block_numbers, 0, block_count * sizeof (*block_numbers));
+
+          block_count = 1;
+          ctr = 1;
           for (uint32_t i = file->idx->bits_per_block + 1 ; i < per_patch_local_block_layout->resolution_to ; i++)
           {
             for (uint32_t j = 0 ; j < ctr ; j++)
             {
               if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
-              {
-                block_number = per_patch_local_block_layout->hz_block_number_array[i][j];
-
-                // Iterating through all other blocks
-                if (read_block(file, si, p, block_number, intersected_box_offset, intersected_box_size, intersected_box_buffer) != PIDX_success)
-                {
-                  fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-                  return PIDX_err_io;
-                }
-              }
+                block_numbers[block_count++] = per_patch_local_block_layout->hz_block_number_array[i][j];
             }
             ctr = ctr * 2;
           }
 
+          if (read_blocks(file, si, block_numbers, block_count, intersected_box_offset, intersected_box_size, intersected_box_buffer) != PIDX_success)
+          {
+            fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+            free(block_numbers);
+            return PIDX_err_io;
+          }
+          free(block_numbers);
+
           // With the reads completed, free the block bitmap
           PIDX_blocks_free_layout(file->idx->bits_per_block, file->idx->maxh, per_patch_local_block_layout);
           free(per_patch_local_block_layout);
@@ -312,98 +319,115 @@ static PIDX_return_code parse_local_partition_idx_file(PIDX_io file, int partiti
 }
 
 
-static PIDX_return_code read_block(PIDX_io file, int vi, int p, int block_number, uint64_t* patch_offset, uint64_t* patch_size, unsigned char* patch_buffer)
+static PIDX_return_code read_blocks(PIDX_io file, int vi, uint32_t* block_numbers, int block_count, uint64_t* patch_offset, uint64_t* patch_size, unsigned char* patch_buffer)
 {
-  MPI_File fp = 0;
-  MPI_Status status;
+  int bytes_for_datatype = ((file->idx->variable[vi]->bpv / 8) * file->idx->variable[vi]->vps);
+  uint64_t block_bytes = (uint64_t) file->idx->samples_per_block * bytes_for_datatype;
 
-  // populate the name of the binary file to read
-  char file_name[PATH_MAX];
-  int file_number = block_number / file->idx->blocks_per_file;
-  if (generate_file_name(file->idx->blocks_per_file, file->idx->filename_template_partition, file_number, file_name, PATH_MAX) == 1)
+  if (PIDX_hz_index_acquire(&file->idx->hz_index, file->idx->bitPattern, file->idx->maxh - 1) != PIDX_success)
   {
-    fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+    fprintf(stderr, "[%s] [%d] PIDX_hz_index_acquire() failed.\n", __FILE__, __LINE__);
     return PIDX_err_io;
   }
-  
-  char *directory_path;
 
-  directory_path = malloc(sizeof(*directory_path) * PATH_MAX);
-  memset(directory_path, 0, sizeof(*directory_path) * PATH_MAX);
+  int b = 0;
+  while (b < block_count)
+  {
+    // populate the name of the binary file to read
+    char file_name[PATH_MAX];
+    int file_number = block_numbers[b] / file->idx->blocks_per_file;
+    if (generate_file_name(file->idx->blocks_per_file, file->idx->filename_template_partition, file_number, file_name, PATH_MAX) == 1)
+    {
+      fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_io;
+    }
 
-  char full_path_file_name[PATH_MAX];
-  char *lastdir = strrchr(file->idx->filename, '/');
-  if (lastdir != NULL && file_name[0] == '.') { // if using relative paths use absolute path
-    strncpy(directory_path, file->idx->filename, lastdir - file->idx->filename + 1);
-    sprintf(full_path_file_name, "%s/%s", directory_path,file_name);
-  }
-  else{ 
-    sprintf(full_path_file_name, "%s", file_name);
-  }
+    char full_path_file_name[PATH_MAX];
+    char *lastdir = strrchr(file->idx->filename, '/');
+    if (lastdir != NULL && file_name[0] == '.') { // if using relative paths use absolute path
+      char directory_path[PIDX_FILE_PATH_LENGTH];
+      memset(directory_path, 0, PIDX_FILE_PATH_LENGTH);
+      strncpy(directory_path, file->idx->filename, lastdir - file->idx->filename + 1);
+      if (snprintf(full_path_file_name, PATH_MAX, "%s/%s", directory_path, file_name) >= PATH_MAX)
+      {
+        fprintf(stderr, "[%s] [%d] path of file number %d is too long.\n", __FILE__, __LINE__, file_number);
+        return PIDX_err_io;
+      }
+    }
+    else{
+      snprintf(full_path_file_name, PATH_MAX, "%s", file_name);
+    }
 
-  // open the binary file
-  if (MPI_File_open(MPI_COMM_SELF, full_path_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
-  {
-    fprintf(stderr, "[%s] [%d] MPI_File_open() block number %d file number %d filename %s failed.\n", __FILE__, __LINE__, block_number, file_number, full_path_file_name);
-    return PIDX_err_io;
-  }
+    // the open file and its header stay in the cache of the dataset across the blocks and the patches
+    PIDX_file_io_handle fh;
+    uint32_t *headers;
+    if (PIDX_file_io_cache_get(file->idx, file->idx_c, full_path_file_name, &fh, &headers) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_cache_get() block number %d file number %d filename %s failed.\n", __FILE__, __LINE__, block_numbers[b], file_number, full_path_file_name);
+      return PIDX_err_io;
+    }
 
-  // read the header
-  uint32_t *headers;
-  int total_header_size = (10 + (10 * file->idx->blocks_per_file)) * sizeof (uint32_t) * file->idx->variable_count;
-  headers = malloc(total_header_size);
-  memset(headers, 0, total_header_size);
+    // the run of consecutive blocks of the file that are stored one after the other is read at once
+    uint64_t run_offset = PIDX_header_block_offset(file->idx, headers, vi, block_numbers[b] % file->idx->blocks_per_file);
+    uint64_t run_size = PIDX_header_block_size(file->idx, headers, vi, block_numbers[b] % file->idx->blocks_per_file);
+    assert (run_size != 0);
 
-  if (MPI_File_read_at(fp, 0, headers, total_header_size , MPI_BYTE, &status) != MPI_SUCCESS)
-  {
-    fprintf(stderr, "Data offset = [%s] [%d] MPI_File_write_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
-    return PIDX_err_io;
-  }
+    int run_end = b + 1;
+    while (run_end < block_count && block_numbers[run_end] == block_numbers[run_end - 1] + 1 && block_numbers[run_end] / file->idx->blocks_per_file == (uint32_t)file_number)
+    {
+      uint64_t offset = PIDX_header_block_offset(file->idx, headers, vi, block_numbers[run_end] % file->idx->blocks_per_file);
+      uint64_t size = PIDX_header_block_size(file->idx, headers, vi, block_numbers[run_end] % file->idx->blocks_per_file);
+      if (size == 0 || offset != run_offset + run_size)
+        break;
 
-  int read_count = 0;
-  MPI_Get_count(&status, MPI_BYTE, &read_count);
-  if (read_count != total_header_size)
-  {
-    fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %dd\n", __FILE__, __LINE__, read_count, total_header_size);
-    return PIDX_err_io;
-  }
+      run_size = run_size + size;
+      run_end++;
+    }
 
-  // use the header to find the offset in file that contains data corresponding to block_number
-  uint64_t data_offset = htonl(headers[12 + (( (block_number % file->idx->blocks_per_file) + (file->idx->blocks_per_file * vi))*10 )]);
-  uint64_t data_size = htonl(headers[14 + (( (block_number % file->idx->blocks_per_file) + (file->idx->blocks_per_file * vi))*10 )]);
-  assert (data_size != 0);
+    // the last block of the run is given a full block of space, as it may be stored smaller
+    uint64_t last_offset = PIDX_header_block_offset(file->idx, headers, vi, block_numbers[run_end - 1] % file->idx->blocks_per_file);
+    uint64_t buffer_size = last_offset - run_offset + block_bytes;
+    if (buffer_size < run_size)
+      buffer_size = run_size;
 
-  // read the data
-  int bytes_for_datatype = ((file->idx->variable[vi]->bpv / 8) * file->idx->variable[vi]->vps);
-  unsigned char* block_buffer = malloc(file->idx->samples_per_block * bytes_for_datatype);
-  if (MPI_File_read_at(fp, data_offset, block_buffer, data_size, MPI_BYTE, &status) != MPI_SUCCESS)
-  {
-    fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at() failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
-    return PIDX_err_io;
-  }
+    unsigned char* run_buffer = malloc(buffer_size);
+    if (run_buffer == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] malloc() of %llu bytes failed.\n", __FILE__, __LINE__, (unsigned long long) buffer_size);
+      return PIDX_err_io;
+    }
+    memset(run_buffer + run_size, 0, buffer_size - run_size);
 
-  // copy the data from the block space to the box space
-  uint64_t xyz[PIDX_MAX_DIMENSIONS];
-  for (uint64_t k = 0; k < file->idx->samples_per_block; k++)
-  {
-    uint64_t hz = (block_number * file->idx->samples_per_block) + k;
-    Hz_to_xyz(file->idx->bitPattern, file->idx->maxh, hz, xyz);
+    if (PIDX_file_io_read_at(fh, run_offset, run_buffer, run_size) != PIDX_success)
+    {
+      fprintf(stderr, "Data offset = %lld [%s] [%d] PIDX_file_io_read_at() failed for filename %s.\n", (long long) run_offset, __FILE__, __LINE__, full_path_file_name);
+      free(run_buffer);
+      return PIDX_err_io;
+    }
 
-    // check if the sample in the block is within the box query
-    if ( ((xyz[0] < patch_offset[0] || xyz[0] >= patch_offset[0] + patch_size[0]) || (xyz[1] < patch_offset[1] || xyz[1] >= patch_offset[1] + patch_size[1]) || (xyz[2] < patch_offset[2] || xyz[2] >= patch_offset[2] + patch_size[2]) ) )
-      continue;
+    for (int r = b; r < run_end; r++)
+    {
+      unsigned char* block_buffer = run_buffer + (PIDX_header_block_offset(file->idx, headers, vi, block_numbers[r] % file->idx->blocks_per_file) - run_offset);
 
-    uint64_t index = (patch_size[0] * patch_size[1] * (xyz[2] - patch_offset[2])) + (patch_size[0] * (xyz[1] - patch_offset[1])) + (xyz[0] - patch_offset[0]);
-    memcpy(patch_buffer + (index * bytes_for_datatype), block_buffer + (k * bytes_for_datatype), bytes_for_datatype);
+      // copy the data from the block space to the box space
+      uint64_t xyz[PIDX_MAX_DIMENSIONS];
+      for (uint64_t k = 0; k < file->idx->samples_per_block; k++)
+      {
+        uint64_t hz = ((uint64_t) block_numbers[r] * file->idx->samples_per_block) + k;
+        PIDX_hz_index_hz_to_xyz(file->idx->hz_index, hz, xyz);
 
-  }
+        // check if the sample in the block is within the box query
+        if ( ((xyz[0] < patch_offset[0] || xyz[0] >= patch_offset[0] + patch_size[0]) || (xyz[1] < patch_offset[1] || xyz[1] >= patch_offset[1] + patch_size[1]) || (xyz[2] < patch_offset[2] || xyz[2] >= patch_offset[2] + patch_size[2]) ) )
+          continue;
 
-  MPI_File_close(&fp);
+        uint64_t index = (patch_size[0] * patch_size[1] * (xyz[2] - patch_offset[2])) + (patch_size[0] * (xyz[1] - patch_offset[1])) + (xyz[0] - patch_offset[0]);
+        memcpy(patch_buffer + (index * bytes_for_datatype), block_buffer + (k * bytes_for_datatype), bytes_for_datatype);
+      }
+    }
 
-  // free buffers
-  free(headers);
-  free(block_buffer);
-  free(directory_path);
+    free(run_buffer);
+    b = run_end;
+  }
 
   return PIDX_success;
 }
@@ -181,40 +181,46 @@ PIDX_return_code PIDX_local_partition_idx_write(PIDX_io file, int svi, int evi)
       log_status("[Local partition idx io 12]: Performing hz io\n", 12, __LINE__, file->idx_c->partition_comm);
 
 
-      // Setup 13: Setup aggregation buffers
-      if (aggregation_setup(file, si, ei) != PIDX_success)
+      // Steps repeated for every aggregation round, the aggregation buffers only hold the blocks of one round
+      for (int r = 0; r < file->idx_b->agg_round_count; r++)
       {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-      log_status("[Local partition idx io 13]: Setting up aggregation phase\n", 13, __LINE__, file->idx_c->partition_comm);
-
-
-      // Setup 14: Performs data aggregation
-      if (aggregation(file, si, PIDX_WRITE) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
+        file->idx_b->agg_round = r;
+
+        // Setup 13: Setup aggregation buffers
+        if (aggregation_setup(file, si, ei) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+        log_status("[Local partition idx io 13]: Setting up aggregation phase\n", 13, __LINE__, file->idx_c->partition_comm);
+
+
+        // Setup 14: Performs data aggregation
+        if (aggregation(file, si, PIDX_WRITE) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+        log_status("[Local partition idx io 14]: Performing aggregation\n", 14, __LINE__, file->idx_c->partition_comm);
+
+
+        // Setup 15: Performs actual file io
+        if (file_io(file, si, PIDX_WRITE) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+        log_status("[Local partition idx io 15]: Performing file io\n", 15, __LINE__, file->idx_c->partition_comm);
+
+
+        // Step 16: free aggregation buffers
+        if (aggregation_cleanup(file, si) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+        log_status("[Local partition idx io 16]: Cleaning up aggregation phase\n", 16, __LINE__, file->idx_c->partition_comm);
       }
-      log_status("[Local partition idx io 14]: Performing aggregation\n", 14, __LINE__, file->idx_c->partition_comm);
-
-
-      // Setup 15: Performs actual file io
-      if (file_io(file, si, PIDX_WRITE) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-      log_status("[Local partition idx io 15]: Performing file io\n", 15, __LINE__, file->idx_c->partition_comm);
-
-
-      // Step 16: free aggregation buffers
-      if (aggregation_cleanup(file, si) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-      log_status("[Local partition idx io 16]: Cleaning up aggregation phase\n", 16, __LINE__, file->idx_c->partition_comm);
 
 
       // Step 17: Cleanup HZ buffers
@@ -348,32 +354,38 @@ PIDX_return_code PIDX_local_partition_idx_read(PIDX_io file, int svi, int evi)
         return PIDX_err_file;
       }
 
-      // Setup 10: Setup aggregation buffers
-      if (aggregation_setup(file, si, ei) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Setup 11: Performs actual file io
-      if (file_io(file, si, PIDX_READ) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Setup 12: Performs data aggregation
-      if (aggregation(file, si, PIDX_READ) != PIDX_success)
+      // Steps repeated for every aggregation round, the aggregation buffers only hold the blocks of one round
+      for (int r = 0; r < file->idx_b->agg_round_count; r++)
       {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Step 13: free aggregation buffers
-      if (aggregation_cleanup(file, si) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
+        file->idx_b->agg_round = r;
+
+        // Setup 10: Setup aggregation buffers
+        if (aggregation_setup(file, si, ei) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Setup 11: Performs actual file io
+        if (file_io(file, si, PIDX_READ) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Setup 12: Performs data aggregation
+        if (aggregation(file, si, PIDX_READ) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 13: free aggregation buffers
+        if (aggregation_cleanup(file, si) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
       }
 
       // Step 14: Perform HZ encoding
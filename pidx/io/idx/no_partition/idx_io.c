@@ -41,6 +41,8 @@
 
 #include "../../../PIDX_inc.h"
 
+static int fused_restructure_possible(PIDX_io file, int svi);
+
 
 // IDX Write Steps
 PIDX_return_code PIDX_idx_write(PIDX_io file, int svi, int evi)
@@ -58,6 +60,10 @@ PIDX_return_code PIDX_idx_write(PIDX_io file, int svi, int evi)
     return PIDX_err_file;
   }
 
+  // Without compression the restructured patches are HZ encoded as they are received, skipping the super patch and
+  // the chunked copy of it
+  file->fused_restructure = fused_restructure_possible(file, svi);
+
   // Step 2: Setting the stage for restructuring (meta data)
   if (idx_restructure_setup(file, svi, evi - 1) != PIDX_success)
   {
@@ -112,40 +118,53 @@ PIDX_return_code PIDX_idx_write(PIDX_io file, int svi, int evi)
         return PIDX_err_file;
       }
 
-      // Step 8: This is not performed by default, it only happens when aggregation is
-      // turned off or when there are a limited number of aggregators
-      if (hz_io(file, PIDX_WRITE) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Step 9: Setup aggregation data buffers
-      if (aggregation_setup(file, si, ei) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Step 10: Performs data aggregation
-      if (aggregation(file, si, PIDX_WRITE) != PIDX_success)
+      // Step 7b: The restructured patches of the pack are not needed any more
+      if (file->fused_restructure == 1 && idx_restructure_buf_destroy(file, si, ei) != PIDX_success)
       {
         fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
         return PIDX_err_file;
       }
 
-      // Step 11: Performs actual file io
-      if (file_io(file, si, PIDX_WRITE) != PIDX_success)
+      // Step 8: This is not performed by default, it only happens when aggregation is
+      // turned off or when there are a limited number of aggregators
+      if (hz_io(file, PIDX_WRITE) != PIDX_success)
       {
         fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
         return PIDX_err_file;
       }
 
-      // Step 12: free aggregation buffers
-      if (aggregation_cleanup(file, si) != PIDX_success)
+      // Steps repeated for every aggregation round, the aggregation buffers only hold the blocks of one round
+      for (int r = 0; r < file->idx_b->agg_round_count; r++)
       {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
+        file->idx_b->agg_round = r;
+
+        // Step 9: Setup aggregation data buffers
+        if (aggregation_setup(file, si, ei) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 10: Performs data aggregation
+        if (aggregation(file, si, PIDX_WRITE) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 11: Performs actual file io
+        if (file_io(file, si, PIDX_WRITE) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 12: free aggregation buffers
+        if (aggregation_cleanup(file, si) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
       }
 
       // Step 13: Cleanup hz buffers and ids
@@ -177,6 +196,7 @@ PIDX_return_code PIDX_idx_write(PIDX_io file, int svi, int evi)
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_file;
   }
+  file->fused_restructure = 0;
 
   return PIDX_success;
 }
@@ -238,32 +258,38 @@ PIDX_return_code PIDX_idx_read(PIDX_io file, int svi, int evi)
         return PIDX_err_file;
       }
 
-      // Step 7: Setting for file io phase by creating aggregation buffers
-      if (aggregation_setup(file, si, ei) != PIDX_success)
+      // Steps repeated for every aggregation round, the aggregation buffers only hold the blocks of one round
+      for (int r = 0; r < file->idx_b->agg_round_count; r++)
       {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Step 8: Performs actual file io
-      if (file_io(file, si, PIDX_READ) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Step 9: Scatter data from aggregators to all processes (reverse aggregation)
-      if (aggregation(file, si, PIDX_READ) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
-      }
-
-      // Step 10: free aggregation buffers
-      if (aggregation_cleanup(file, si) != PIDX_success)
-      {
-        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-        return PIDX_err_file;
+        file->idx_b->agg_round = r;
+
+        // Step 7: Setting for file io phase by creating aggregation buffers
+        if (aggregation_setup(file, si, ei) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 8: Performs actual file io
+        if (file_io(file, si, PIDX_READ) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 9: Scatter data from aggregators to all processes (reverse aggregation)
+        if (aggregation(file, si, PIDX_READ) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
+
+        // Step 10: free aggregation buffers
+        if (aggregation_cleanup(file, si) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_file;
+        }
       }
 
       // Step 11: Perform reverse HZ encoding, converting data from idx layout to row/column major application layout
@@ -312,3 +338,28 @@ PIDX_return_code PIDX_idx_read(PIDX_io file, int svi, int evi)
 
   return PIDX_success;
 }
+
+
+
+// The restructured patches can be HZ encoded directly when the user allows it, nothing has to be chunked or compressed
+// and they share the layout of the super patch
+static int fused_restructure_possible(PIDX_io file, int svi)
+{
+  if (file->idx->fused_restructure == 0)
+    return 0;
+
+  if (file->idx->compression_type != PIDX_NO_COMPRESSION)
+    return 0;
+
+  if (file->idx->chunk_size[0] != 1 || file->idx->chunk_size[1] != 1 || file->idx->chunk_size[2] != 1)
+    return 0;
+
+  if (file->idx->variable[svi]->data_layout != PIDX_row_major)
+    return 0;
+
+  // the restructuring verification works on the super patch
+  if (file->idx_dbg->debug_rst == 1)
+    return 0;
+
+  return 1;
+}
@@ -183,8 +183,15 @@ static PIDX_return_code partition_setup(PIDX_io file, int svi)
   for (uint32_t i = 0; i <= maxH; i++)
     bitPattern[i] = RegExBitmaskBit(bitSequence, i);
 
+  // the partitions are numbered with the z address of their index
+  PIDX_hz_index partition_index;
+  if (PIDX_hz_index_create(bitPattern, maxH - 1, &partition_index) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
+  }
+
   int z_order = 0;
-  int number_levels = maxH - 1;
 
   // iterate through all the partitions and finding out which partition a process belongs to
   for (uint32_t i = 0, index_i = 0; i < file->idx->bounds[0]; i = i + file->idx->partition_size[0], index_i++)
@@ -203,25 +210,7 @@ static PIDX_return_code partition_setup(PIDX_io file, int svi)
 
         if (intersectNDChunk(partition_patch, local_p))
         {
-          Point3D xyzuv_Index;
-          xyzuv_Index.x = index_i;
-          xyzuv_Index.y = index_j;
-          xyzuv_Index.z = index_k;
-
-          z_order = 0;
-          Point3D zero;
-          zero.x = 0;
-          zero.y = 0;
-          zero.z = 0;
-          memset(&zero, 0, sizeof (Point3D));
-
-          int cnt = 0;
-          for (cnt = 0; memcmp(&xyzuv_Index, &zero, sizeof (Point3D)); cnt++, number_levels--)
-          {
-            int bit = bitPattern[number_levels];
-            z_order |= ((uint64_t) PGET(xyzuv_Index, bit) & 1) << cnt;
-            PGET(xyzuv_Index, bit) >>= 1;
-          }
+          z_order = PIDX_hz_index_xyz_to_z(partition_index, index_i, index_j, index_k);
 
           // the partitions are arranged in z order
           file->idx_c->color = colors[z_order];
@@ -236,6 +225,7 @@ static PIDX_return_code partition_setup(PIDX_io file, int svi)
     }
   }
   free(partition_patch);
+  PIDX_hz_index_free(partition_index);
 
   free(colors);
 
@@ -513,8 +503,14 @@ static PIDX_return_code create_midx(PIDX_io file, int svi)
       for (uint32_t i = 0; i <= maxH; i++)
         bitPattern[i] = RegExBitmaskBit(bitSequence, i);
 
+      PIDX_hz_index partition_index;
+      if (PIDX_hz_index_create(bitPattern, maxH - 1, &partition_index) != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_file;
+      }
+
       int z_order = 0;
-      int number_levels = maxH - 1;
       for (uint32_t i = 0, index_i = 0; i < file->idx->bounds[0]; i = i + file->idx->partition_size[0], index_i++)
       {
         for (uint32_t j = 0, index_j = 0; j < file->idx->bounds[1]; j = j + file->idx->partition_size[1], index_j++)
@@ -530,24 +526,7 @@ static PIDX_return_code create_midx(PIDX_io file, int svi)
 
             if (intersectNDChunk(partition_patch, curr_local_p))
             {
-              Point3D xyzuv_Index;
-              xyzuv_Index.x = index_i;
-              xyzuv_Index.y = index_j;
-              xyzuv_Index.z = index_k;
-
-              z_order = 0;
-              Point3D zero;
-              zero.x = 0;
-              zero.y = 0;
-              zero.z = 0;
-              memset(&zero, 0, sizeof (Point3D));
-
-              for (uint32_t cnt = 0; memcmp(&xyzuv_Index, &zero, sizeof (Point3D)); cnt++, number_levels--)
-              {
-                int bit = bitPattern[number_levels];
-                z_order |= ((uint64_t) PGET(xyzuv_Index, bit) & 1) << cnt;
-                PGET(xyzuv_Index, bit) >>= 1;
-              }
+              z_order = PIDX_hz_index_xyz_to_z(partition_index, index_i, index_j, index_k);
               sprintf(&partition_filenames[colors[z_order]*PIDX_STRING_SIZE], "%s_%d.idx", file_name_skeleton, colors[z_order]);
 
               uint64_t curr_off = colors[z_order]*PIDX_MAX_DIMENSIONS;
@@ -563,6 +542,7 @@ static PIDX_return_code create_midx(PIDX_io file, int svi)
 
       free(curr_local_p);
       free(partition_patch);
+      PIDX_hz_index_free(partition_index);
 
     }
 
@@ -72,6 +72,12 @@ PIDX_return_code PIDX_serial_idx_write(PIDX_io file, int svi, int evi)
     return PIDX_err_file;
   }
 
+  if (PIDX_hz_index_acquire(&file->idx->hz_index, file->idx->bitPattern, file->idx->maxh - 1) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
+  }
+
   for (si = svi; si < evi; si++)
   {
     bytes_for_datatype = ((file->idx->variable[si]->bpv / 8) * file->idx->variable[si]->vps);
@@ -90,9 +96,9 @@ PIDX_return_code PIDX_serial_idx_write(PIDX_io file, int svi, int evi)
         return PIDX_err_io;
       }
 
-      if (MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_WRONLY, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
+      if (PIDX_file_io_mpi_create(MPI_COMM_SELF, file_name, file->idx_c->access->info, &fp) != PIDX_success)
       {
-        fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_mpi_create() filename %s failed.\n", __FILE__, __LINE__, file_name);
         return PIDX_err_io;
       }
 
@@ -104,7 +110,7 @@ PIDX_return_code PIDX_serial_idx_write(PIDX_io file, int svi, int evi)
           for (k = 0; k < file->idx->samples_per_block; k++)
           {
             hz = (i * file->idx->blocks_per_file * file->idx->samples_per_block) + (j * file->idx->samples_per_block) + k;
-            Hz_to_xyz(file->idx->bitPattern, file->idx->maxh, hz, xyz);
+            PIDX_hz_index_hz_to_xyz(file->idx->hz_index, hz, xyz);
 
             index = (file->idx->variable[si]->sim_patch[0]->size[0] * file->idx->variable[si]->sim_patch[0]->size[1] * xyz[2])
                 + (file->idx->variable[si]->sim_patch[0]->size[0] * xyz[1])
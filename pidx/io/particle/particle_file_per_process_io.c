@@ -71,6 +71,16 @@ PIDX_return_code PIDX_particle_file_per_process_write(PIDX_io file, int svi, int
   char time_template[512];
   sprintf(time_template, "%%s/%s/%%d_%%d", file->idx->filename_time_template);
 
+  // the files of all the patches are written together
+  PIDX_file_io_batch batch = PIDX_file_io_batch_create();
+  if (batch == NULL)
+  {
+    free(directory_path);
+    return PIDX_err_io;
+  }
+
+  // a file or write that can not be queued fails the flush after the loop, the particle counts are still reduced
+  int batch_error = 0;
   uint64_t local_pcount = 0;
   PIDX_variable var0 = file->idx->variable[svi];
   for (int p = 0; p < var0->sim_patch_count; p++)
@@ -79,11 +89,11 @@ PIDX_return_code PIDX_particle_file_per_process_write(PIDX_io file, int svi, int
     memset(file_name, 0, PATH_MAX * sizeof(*file_name));
     sprintf(file_name, time_template, directory_path, file->idx->current_time_step, file->idx_c->simulation_rank, p);
 
-    int fp = open(file_name, O_CREAT | O_WRONLY, 0664);
+    int fp = PIDX_file_io_batch_add_file(batch, file_name);
     if (fp < 0)
     {
-      fprintf(stderr, "[%s] [%d] pwrite() failed Filename %s fp %d\n", __FILE__, __LINE__, file_name, fp);
-      return PIDX_err_io;
+      fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_add_file() failed.\n", __FILE__, __LINE__);
+      batch_error = 1;
     }
 
     uint64_t data_offset = 0;
@@ -114,20 +124,26 @@ PIDX_return_code PIDX_particle_file_per_process_write(PIDX_io file, int svi, int
 #endif
 
       uint64_t buffer_size = var->sim_patch[p]->particle_count * sample_count * (bits_per_sample/CHAR_BIT);
-      uint64_t write_count = pwrite(fp, var->sim_patch[p]->buffer, buffer_size, data_offset);
-      if (write_count != buffer_size)
+      if (fp >= 0 && PIDX_file_io_batch_add_write(batch, fp, var->sim_patch[p]->buffer, buffer_size, data_offset, 0) != PIDX_success)
       {
-        fprintf(stderr, "[%s] [%d] pwrite() failed Filename %s [%lld != %lld]\n", __FILE__, __LINE__, file_name, (unsigned long long)buffer_size, (unsigned long long)write_count);
-        return PIDX_err_io;
+        fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_add_write() failed.\n", __FILE__, __LINE__);
+        batch_error = 1;
       }
       data_offset = data_offset + buffer_size;
     }
 
     local_pcount += var0->sim_patch[p]->particle_count;
     MPI_Allreduce(&local_pcount, &file->idx->particle_number, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, file->idx_c->simulation_comm);
+  }
 
-    close(fp);
+  if (batch_error == 1 || PIDX_file_io_batch_submit(batch) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d] PIDX_file_io_batch_submit() failed.\n", __FILE__, __LINE__);
+    PIDX_file_io_batch_free(batch);
+    free(directory_path);
+    return PIDX_err_io;
   }
+  PIDX_file_io_batch_free(batch);
 
   free (directory_path);
   time->particle_data_io_end = MPI_Wtime();
@@ -42,25 +42,148 @@
 #include "../PIDX_inc.h"
 
 
+static uint64_t metadata_cache_entry_memory(int level_count)
+{
+  return sizeof(struct PIDX_metadata_cache_entry_struct) + level_count * sizeof(struct PIDX_metadata_cache_level_struct);
+}
+
+
+static void metadata_cache_entry_free(PIDX_metadata_cache cache, PIDX_metadata_cache_entry entry)
+{
+  cache->memory_used -= metadata_cache_entry_memory(entry->maxh - entry->resolution_to);
+  cache->entry_count--;
+
+  free(entry->level);
+  free(entry);
+}
+
+
+// Evicts least recently used entries until the cache (plus extra_memory bytes) fits in the memory budget
+static void metadata_cache_evict(PIDX_metadata_cache cache, uint64_t extra_memory)
+{
+  if (cache->memory_limit == 0)
+    return;
+
+  while (cache->head != NULL && cache->memory_used + extra_memory > cache->memory_limit)
+  {
+    PIDX_metadata_cache_entry* lru = &cache->head;
+    for (PIDX_metadata_cache_entry* e = &cache->head; *e != NULL; e = &(*e)->next)
+    {
+      if ((*e)->last_used < (*lru)->last_used)
+        lru = e;
+    }
+
+    PIDX_metadata_cache_entry entry = *lru;
+    *lru = entry->next;
+    metadata_cache_entry_free(cache, entry);
+  }
+}
+
+
 PIDX_return_code PIDX_create_metadata_cache(PIDX_metadata_cache* cache)
 {
 
   *cache = malloc(sizeof (*(*cache)));
   memset(*cache, 0, sizeof (*(*cache)));
 
+  (*cache)->memory_limit = PIDX_default_metadata_cache_memory_limit;
+
   return PIDX_success;
 }
 
 
 PIDX_return_code PIDX_free_metadata_cache(PIDX_metadata_cache cache)
 {
-  if (cache->is_set == 1)
+  if (cache == NULL)
+    return PIDX_success;
+
+  while (cache->head != NULL)
   {
-      free(cache->hz_level);
-      free(cache->index_level);
-      free(cache->xyz_mapped_index);
+    PIDX_metadata_cache_entry entry = cache->head;
+    cache->head = entry->next;
+    metadata_cache_entry_free(cache, entry);
   }
 
   free(cache);
   return PIDX_success;
 }
+
+
+PIDX_return_code PIDX_metadata_cache_set_memory_limit(PIDX_metadata_cache cache, uint64_t memory_limit)
+{
+  if (cache == NULL)
+    return PIDX_err_metadata;
+
+  cache->memory_limit = memory_limit;
+  metadata_cache_evict(cache, 0);
+
+  return PIDX_success;
+}
+
+
+PIDX_metadata_cache_entry PIDX_metadata_cache_lookup(PIDX_metadata_cache cache, const uint64_t* offset, const uint64_t* size, const char* bitSequence, int maxh, int resolution_to)
+{
+  if (cache == NULL)
+    return NULL;
+
+  cache->clock++;
+
+  for (PIDX_metadata_cache_entry entry = cache->head; entry != NULL; entry = entry->next)
+  {
+    if (entry->maxh != maxh || entry->resolution_to != resolution_to)
+      continue;
+
+    if (memcmp(entry->offset, offset, sizeof(entry->offset)) != 0 || memcmp(entry->size, size, sizeof(entry->size)) != 0)
+      continue;
+
+    if (strncmp(entry->bitSequence, bitSequence, sizeof(entry->bitSequence)) != 0)
+      continue;
+
+    entry->last_used = cache->clock;
+    cache->hit_count++;
+    return entry;
+  }
+
+  cache->miss_count++;
+  return NULL;
+}
+
+
+PIDX_return_code PIDX_metadata_cache_insert(PIDX_metadata_cache cache, const uint64_t* offset, const uint64_t* size, const char* bitSequence, int maxh, int resolution_to, const struct PIDX_metadata_cache_level_struct* level, PIDX_metadata_cache_entry* entry)
+{
+  int level_count = maxh - resolution_to;
+  if (cache == NULL || level_count < 0)
+    return PIDX_err_metadata;
+
+  uint64_t memory = metadata_cache_entry_memory(level_count);
+
+  // The geometry alone does not fit in the budget
+  if (cache->memory_limit != 0 && memory > cache->memory_limit)
+  {
+    *entry = NULL;
+    return PIDX_err_size;
+  }
+
+  metadata_cache_evict(cache, memory);
+
+  *entry = malloc(sizeof (*(*entry)));
+  memset(*entry, 0, sizeof (*(*entry)));
+
+  memcpy((*entry)->offset, offset, sizeof((*entry)->offset));
+  memcpy((*entry)->size, size, sizeof((*entry)->size));
+  strncpy((*entry)->bitSequence, bitSequence, sizeof((*entry)->bitSequence) - 1);
+  (*entry)->maxh = maxh;
+  (*entry)->resolution_to = resolution_to;
+  (*entry)->last_used = cache->clock;
+
+  (*entry)->level = malloc(level_count * sizeof(*(*entry)->level));
+  memcpy((*entry)->level, level, level_count * sizeof(*(*entry)->level));
+
+  (*entry)->next = cache->head;
+  cache->head = *entry;
+
+  cache->entry_count++;
+  cache->memory_used += memory;
+
+  return PIDX_success;
+}
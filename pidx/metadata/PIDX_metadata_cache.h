@@ -52,13 +52,51 @@
 #define __PIDX_METADATA_CACHE_H
 
 
+/// Default memory budget of a cache (in bytes)
+#define PIDX_default_metadata_cache_memory_limit (1 << 20)
+
+
+/// Samples of one HZ level that fall inside a patch. They form a regular lattice,
+/// every row (along x) of the lattice is a run of count[0] samples.
+struct PIDX_metadata_cache_level_struct
+{
+  uint64_t from[PIDX_MAX_DIMENSIONS];    /// first sample of the lattice (global index space)
+  uint64_t stride[PIDX_MAX_DIMENSIONS];  /// distance between two samples of the lattice
+  uint64_t count[PIDX_MAX_DIMENSIONS];   /// number of samples of the lattice (0 if the level does not intersect the patch)
+};
+typedef struct PIDX_metadata_cache_level_struct* PIDX_metadata_cache_level;
+
+
+/// One patch geometry and its HZ level lattices
+struct PIDX_metadata_cache_entry_struct
+{
+  uint64_t offset[PIDX_MAX_DIMENSIONS];  /// patch offset (key)
+  uint64_t size[PIDX_MAX_DIMENSIONS];    /// patch size (key)
+  char bitSequence[512];                 /// bitsequence (key)
+  int maxh;                              /// number of HZ levels (key)
+  int resolution_to;                     /// levels >= maxh - resolution_to are skipped (key)
+
+  uint64_t last_used;                    /// used to evict the least recently used entry
+  PIDX_metadata_cache_level level;       /// maxh - resolution_to level lattices
+
+  struct PIDX_metadata_cache_entry_struct* next;
+};
+typedef struct PIDX_metadata_cache_entry_struct* PIDX_metadata_cache_entry;
+
+
+/// Cache of HZ addressing metadata, keyed by patch geometry.
+/// A cache can be shared by any number of PIDX_file (see PIDX_set_meta_data_cache) and time steps.
 struct PIDX_metadata_cache_struct
 {
-  int is_set;               /// flag to specify if cache buffer is populated
-  int element_count;        /// Number of elements (tuples) in the cache
-  int *xyz_mapped_index;    /// The xyz index (application row-order index)
-  int *hz_level;            /// Corresponding HZ index to the xyz index
-  int *index_level;         /// The hz index level
+  int entry_count;                       /// Number of cached geometries
+  uint64_t memory_used;                  /// Memory held by the entries (in bytes)
+  uint64_t memory_limit;                 /// Memory budget (in bytes), least recently used entries are evicted beyond it
+  uint64_t clock;                        /// Incremented at every lookup
+
+  uint64_t hit_count;                    /// Number of lookups served by the cache
+  uint64_t miss_count;                   /// Number of lookups that had to compute the lattices
+
+  PIDX_metadata_cache_entry head;        /// Entries (most recently inserted first)
 };
 typedef struct PIDX_metadata_cache_struct* PIDX_metadata_cache;
 
@@ -69,4 +107,41 @@ PIDX_return_code PIDX_create_metadata_cache(PIDX_metadata_cache* cache);
 PIDX_return_code PIDX_free_metadata_cache(PIDX_metadata_cache cache);
 
 
+///
+/// \brief PIDX_metadata_cache_set_memory_limit Sets the memory budget of the cache (evicts entries if needed)
+/// \param cache
+/// \param memory_limit Number of bytes, 0 for no limit
+/// \return
+///
+PIDX_return_code PIDX_metadata_cache_set_memory_limit(PIDX_metadata_cache cache, uint64_t memory_limit);
+
+
+///
+/// \brief PIDX_metadata_cache_lookup Finds the level lattices of a patch geometry
+/// \param cache
+/// \param offset Patch offset
+/// \param size Patch size
+/// \param bitSequence Bitsequence (as in idx_dataset)
+/// \param maxh
+/// \param resolution_to
+/// \return The cached entry or NULL
+///
+PIDX_metadata_cache_entry PIDX_metadata_cache_lookup(PIDX_metadata_cache cache, const uint64_t* offset, const uint64_t* size, const char* bitSequence, int maxh, int resolution_to);
+
+
+///
+/// \brief PIDX_metadata_cache_insert Adds the level lattices of a patch geometry to the cache
+/// \param cache
+/// \param offset Patch offset
+/// \param size Patch size
+/// \param bitSequence Bitsequence (as in idx_dataset)
+/// \param maxh
+/// \param resolution_to
+/// \param level maxh - resolution_to level lattices (copied)
+/// \param entry The new entry
+/// \return
+///
+PIDX_return_code PIDX_metadata_cache_insert(PIDX_metadata_cache cache, const uint64_t* offset, const uint64_t* size, const char* bitSequence, int maxh, int resolution_to, const struct PIDX_metadata_cache_level_struct* level, PIDX_metadata_cache_entry* entry);
+
+
 #endif
@@ -341,6 +341,22 @@ PIDX_return_code PIDX_metadata_parse_v6_1(FILE *fp, PIDX_file* file)
       (*file)->idx->compression_bit_rate = atof(line);
     }
 
+    if (strcmp(line, "(zfp accuracy)") == 0)
+    {
+      if (fgets(line, sizeof line, fp) == NULL)
+        return PIDX_err_file;
+      line[strcspn(line, "\r\n")] = 0;
+      (*file)->idx->zfp_accuracy = atof(line);
+    }
+
+    if (strcmp(line, "(zfp precision)") == 0)
+    {
+      if (fgets(line, sizeof line, fp) == NULL)
+        return PIDX_err_file;
+      line[strcspn(line, "\r\n")] = 0;
+      (*file)->idx->zfp_precision = atoi(line);
+    }
+
     if (strcmp(line, "(blocksperfile)") == 0)
     {
       if ( fgets(line, sizeof line, fp) == NULL)
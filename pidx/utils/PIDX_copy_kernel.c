@@ -0,0 +1,357 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#include "../PIDX_inc.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PIDX_COPY_KERNEL_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+
+static int copy_kernel_cpu_has_avx2()
+{
+#if PIDX_COPY_KERNEL_HAVE_AVX2
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return 0;
+#endif
+}
+
+
+static void copy_strided_generic(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, uint64_t src_stride, uint64_t count, uint64_t element_size)
+{
+  for (uint64_t i = 0; i < count; i++)
+    memcpy(dst + i * dst_stride * element_size, src + i * src_stride * element_size, element_size);
+}
+
+
+static void copy_scatter_generic(unsigned char* dst, const uint64_t* index, uint64_t base, const unsigned char* src, uint64_t src_stride, uint64_t count, uint64_t element_size)
+{
+  for (uint64_t i = 0; i < count; i++)
+    memcpy(dst + (index[i] - base) * element_size, src + i * src_stride * element_size, element_size);
+}
+
+
+static void copy_gather_generic(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, const uint64_t* index, uint64_t base, uint64_t count, uint64_t element_size)
+{
+  for (uint64_t i = 0; i < count; i++)
+    memcpy(dst + i * dst_stride * element_size, src + (index[i] - base) * element_size, element_size);
+}
+
+
+// Kernels for elements of SIZE bytes, the constant size memcpy is turned into plain (unaligned) loads and stores.
+// The contiguous case (stride 1) is split out so that the compiler can vectorize it.
+#define PIDX_COPY_KERNEL_DEFINE(SIZE) \
+static void copy_strided_##SIZE(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, uint64_t src_stride, uint64_t count, uint64_t element_size) \
+{ \
+  (void)element_size; \
+  if (dst_stride == 1 && src_stride == 1) \
+    memcpy(dst, src, count * SIZE); \
+  else if (dst_stride == 1) \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(dst + i * SIZE, src + i * src_stride * SIZE, SIZE); \
+  } \
+  else if (src_stride == 1) \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(dst + i * dst_stride * SIZE, src + i * SIZE, SIZE); \
+  } \
+  else \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(dst + i * dst_stride * SIZE, src + i * src_stride * SIZE, SIZE); \
+  } \
+} \
+\
+static void copy_scatter_##SIZE(unsigned char* dst, const uint64_t* index, uint64_t base, const unsigned char* src, uint64_t src_stride, uint64_t count, uint64_t element_size) \
+{ \
+  (void)element_size; \
+  unsigned char* d = dst - base * SIZE; \
+  if (src_stride == 1) \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(d + index[i] * SIZE, src + i * SIZE, SIZE); \
+  } \
+  else \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(d + index[i] * SIZE, src + i * src_stride * SIZE, SIZE); \
+  } \
+} \
+\
+static void copy_gather_##SIZE(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, const uint64_t* index, uint64_t base, uint64_t count, uint64_t element_size) \
+{ \
+  (void)element_size; \
+  const unsigned char* s = src - base * SIZE; \
+  if (dst_stride == 1) \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(dst + i * SIZE, s + index[i] * SIZE, SIZE); \
+  } \
+  else \
+  { \
+    for (uint64_t i = 0; i < count; i++) \
+      memcpy(dst + i * dst_stride * SIZE, s + index[i] * SIZE, SIZE); \
+  } \
+}
+
+PIDX_COPY_KERNEL_DEFINE(1)
+PIDX_COPY_KERNEL_DEFINE(2)
+PIDX_COPY_KERNEL_DEFINE(4)
+PIDX_COPY_KERNEL_DEFINE(8)
+PIDX_COPY_KERNEL_DEFINE(12)
+PIDX_COPY_KERNEL_DEFINE(24)
+
+#undef PIDX_COPY_KERNEL_DEFINE
+
+
+#if PIDX_COPY_KERNEL_HAVE_AVX2
+// Hardware gathers (4 indices at a time) for 4 and 8 byte elements
+__attribute__((target("avx2")))
+static void copy_gather_4_avx2(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, const uint64_t* index, uint64_t base, uint64_t count, uint64_t element_size)
+{
+  if (dst_stride != 1)
+  {
+    copy_gather_4(dst, dst_stride, src, index, base, count, element_size);
+    return;
+  }
+
+  const unsigned char* s = src - base * 4;
+  uint64_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256i vindex = _mm256_loadu_si256((const __m256i*)(index + i));
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm256_i64gather_epi32((const int*)s, vindex, 4));
+  }
+  for (; i < count; i++)
+    memcpy(dst + i * 4, s + index[i] * 4, 4);
+}
+
+
+__attribute__((target("avx2")))
+static void copy_gather_8_avx2(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, const uint64_t* index, uint64_t base, uint64_t count, uint64_t element_size)
+{
+  if (dst_stride != 1)
+  {
+    copy_gather_8(dst, dst_stride, src, index, base, count, element_size);
+    return;
+  }
+
+  const unsigned char* s = src - base * 8;
+  uint64_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256i vindex = _mm256_loadu_si256((const __m256i*)(index + i));
+    _mm256_storeu_si256((__m256i*)(dst + i * 8), _mm256_i64gather_epi64((const long long*)s, vindex, 8));
+  }
+  for (; i < count; i++)
+    memcpy(dst + i * 8, s + index[i] * 8, 8);
+}
+
+
+static const struct PIDX_copy_kernel_struct copy_kernel_avx2[] =
+{
+  {4, "4avx2", copy_strided_4, copy_scatter_4, copy_gather_4_avx2},
+  {8, "8avx2", copy_strided_8, copy_scatter_8, copy_gather_8_avx2}
+};
+#endif
+
+
+static const struct PIDX_copy_kernel_struct copy_kernel_generic = {0, "memcpy", copy_strided_generic, copy_scatter_generic, copy_gather_generic};
+
+static const struct PIDX_copy_kernel_struct copy_kernel[] =
+{
+  {1, "1", copy_strided_1, copy_scatter_1, copy_gather_1},
+  {2, "2", copy_strided_2, copy_scatter_2, copy_gather_2},
+  {4, "4", copy_strided_4, copy_scatter_4, copy_gather_4},
+  {8, "8", copy_strided_8, copy_scatter_8, copy_gather_8},
+  {12, "12", copy_strided_12, copy_scatter_12, copy_gather_12},
+  {24, "24", copy_strided_24, copy_scatter_24, copy_gather_24}
+};
+
+
+PIDX_copy_kernel PIDX_copy_kernel_get(uint64_t element_size)
+{
+#if PIDX_COPY_KERNEL_HAVE_AVX2
+  if (copy_kernel_cpu_has_avx2())
+  {
+    for (uint64_t i = 0; i < sizeof(copy_kernel_avx2) / sizeof(copy_kernel_avx2[0]); i++)
+    {
+      if (copy_kernel_avx2[i].element_size == element_size)
+        return &copy_kernel_avx2[i];
+    }
+  }
+#endif
+
+  for (uint64_t i = 0; i < sizeof(copy_kernel) / sizeof(copy_kernel[0]); i++)
+  {
+    if (copy_kernel[i].element_size == element_size)
+      return &copy_kernel[i];
+  }
+
+  return &copy_kernel_generic;
+}
+
+
+PIDX_copy_kernel PIDX_copy_kernel_generic()
+{
+  return &copy_kernel_generic;
+}
+
+
+
+static void byteswap_scalar(unsigned char* dst, const unsigned char* src, uint64_t count, uint64_t value_size)
+{
+  if (value_size == 2)
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      uint16_t v;
+      memcpy(&v, src + i * 2, 2);
+      v = (uint16_t) ((v >> 8) | (v << 8));
+      memcpy(dst + i * 2, &v, 2);
+    }
+  }
+  else if (value_size == 4)
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      uint32_t v;
+      memcpy(&v, src + i * 4, 4);
+      v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+      memcpy(dst + i * 4, &v, 4);
+    }
+  }
+  else if (value_size == 8)
+  {
+    for (uint64_t i = 0; i < count; i++)
+    {
+      uint64_t v;
+      memcpy(&v, src + i * 8, 8);
+      v = ((v >> 56) | ((v >> 40) & 0xff00ULL) | ((v >> 24) & 0xff0000ULL) | ((v >> 8) & 0xff000000ULL) |
+           ((v << 8) & 0xff00000000ULL) | ((v << 24) & 0xff0000000000ULL) | ((v << 40) & 0xff000000000000ULL) | (v << 56));
+      memcpy(dst + i * 8, &v, 8);
+    }
+  }
+  else if (dst != src)
+    memmove(dst, src, count * value_size);
+}
+
+
+#if PIDX_COPY_KERNEL_HAVE_AVX2
+// Shuffle control reversing every value_size bytes of a 16 byte lane
+static void byteswap_shuffle(unsigned char* control, uint64_t value_size)
+{
+  for (int i = 0; i < 32; i++)
+    control[i] = (unsigned char) ((i % 16) / value_size * value_size + (value_size - 1 - i % value_size));
+}
+
+
+__attribute__((target("ssse3")))
+static void byteswap_ssse3(unsigned char* dst, const unsigned char* src, uint64_t count, uint64_t value_size)
+{
+  unsigned char control[32];
+  byteswap_shuffle(control, value_size);
+  const __m128i shuffle = _mm_loadu_si128((const __m128i*)control);
+
+  uint64_t size = count * value_size;
+  uint64_t i = 0;
+  for (; i + 16 <= size; i += 16)
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i)), shuffle));
+
+  byteswap_scalar(dst + i, src + i, (size - i) / value_size, value_size);
+}
+
+
+__attribute__((target("avx2")))
+static void byteswap_avx2(unsigned char* dst, const unsigned char* src, uint64_t count, uint64_t value_size)
+{
+  unsigned char control[32];
+  byteswap_shuffle(control, value_size);
+  const __m256i shuffle = _mm256_loadu_si256((const __m256i*)control);
+
+  uint64_t size = count * value_size;
+  uint64_t i = 0;
+  for (; i + 64 <= size; i += 64)
+  {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(a, shuffle));
+    _mm256_storeu_si256((__m256i*)(dst + i + 32), _mm256_shuffle_epi8(b, shuffle));
+  }
+  for (; i + 32 <= size; i += 32)
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + i)), shuffle));
+
+  byteswap_scalar(dst + i, src + i, (size - i) / value_size, value_size);
+}
+#endif
+
+
+void PIDX_copy_byteswap(unsigned char* dst, const unsigned char* src, uint64_t count, uint64_t value_size)
+{
+#if PIDX_COPY_KERNEL_HAVE_AVX2
+  static int isa = -1;
+  if (isa == -1)
+  {
+    __builtin_cpu_init();
+    isa = __builtin_cpu_supports("avx2") ? 2 : (__builtin_cpu_supports("ssse3") ? 1 : 0);
+  }
+
+  if (value_size == 2 || value_size == 4 || value_size == 8)
+  {
+    if (isa == 2)
+    {
+      byteswap_avx2(dst, src, count, value_size);
+      return;
+    }
+    if (isa == 1)
+    {
+      byteswap_ssse3(dst, src, count, value_size);
+      return;
+    }
+  }
+#endif
+
+  byteswap_scalar(dst, src, count, value_size);
+}
@@ -0,0 +1,102 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file PIDX_copy_kernel.h
+ *
+ * Element copy kernels.
+ *
+ * The HZ encoding and the chunking move samples of (bpv/8)*vps*chunk bytes
+ * one at a time. A runtime sized memcpy per sample can neither be inlined nor
+ * vectorized, so the kernels below are specialized at build time for the
+ * common element sizes (1, 2, 4, 8 bytes and 12, 24 bytes for 3 component
+ * float and double samples). A kernel set is selected once per patch with
+ * PIDX_copy_kernel_get, other sizes fall back to memcpy. On x86 CPUs with
+ * AVX2 the gathers of 4 and 8 byte elements use the hardware gather.
+ *
+ * PIDX_copy_byteswap is the copy used for datasets of the other endianness,
+ * it reverses the bytes of 2, 4 and 8 byte values with SSSE3 or AVX2 byte
+ * shuffles when the CPU has them.
+ *
+ */
+
+#ifndef __PIDX_COPY_KERNEL_H
+#define __PIDX_COPY_KERNEL_H
+
+
+/// dst[i * dst_stride] = src[i * src_stride] for i < count (strides in elements)
+typedef void (*PIDX_copy_strided_fn)(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, uint64_t src_stride, uint64_t count, uint64_t element_size);
+
+/// dst[index[i] - base] = src[i * src_stride] for i < count
+typedef void (*PIDX_copy_scatter_fn)(unsigned char* dst, const uint64_t* index, uint64_t base, const unsigned char* src, uint64_t src_stride, uint64_t count, uint64_t element_size);
+
+/// dst[i * dst_stride] = src[index[i] - base] for i < count
+typedef void (*PIDX_copy_gather_fn)(unsigned char* dst, uint64_t dst_stride, const unsigned char* src, const uint64_t* index, uint64_t base, uint64_t count, uint64_t element_size);
+
+
+struct PIDX_copy_kernel_struct
+{
+  uint64_t element_size;                            /// Size of an element in bytes
+  const char* name;                                 /// Name of the kernel set (for benchmarks)
+  PIDX_copy_strided_fn strided;
+  PIDX_copy_scatter_fn scatter;
+  PIDX_copy_gather_fn gather;
+};
+typedef const struct PIDX_copy_kernel_struct* PIDX_copy_kernel;
+
+
+
+/// \brief Returns the kernel set for elements of element_size bytes
+/// The generic (memcpy) kernels are returned if there is no specialization for element_size
+PIDX_copy_kernel PIDX_copy_kernel_get(uint64_t element_size);
+
+
+
+/// \brief Returns the generic (memcpy per element) kernel set, used as reference by the benchmarks
+PIDX_copy_kernel PIDX_copy_kernel_generic();
+
+
+
+/// \brief Copies count values of value_size bytes from src to dst reversing the bytes of each value
+/// dst can be src. Values of 2, 4 and 8 bytes are swapped, other sizes (single bytes) are copied unchanged.
+void PIDX_copy_byteswap(unsigned char* dst, const unsigned char* src, uint64_t count, uint64_t value_size);
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#include "../PIDX_inc.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PIDX_HZ_INDEX_HAVE_BMI2 1
+#include <immintrin.h>
+#endif
+
+
+static int hz_index_cpu_has_bmi2()
+{
+#if PIDX_HZ_INDEX_HAVE_BMI2
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+#else
+  return 0;
+#endif
+}
+
+
+static int hz_index_ctz(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(v);
+#else
+  int n = 0;
+  while (!(v & 1)) { v >>= 1; n++; }
+  return n;
+#endif
+}
+
+
+static int hz_index_msb(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(v);
+#else
+  int n = 0;
+  while (v >>= 1) n++;
+  return n;
+#endif
+}
+
+
+// z address -> HZ address (the part of xyz_to_HZ after the interleaving)
+static inline uint64_t hz_index_z_to_hz(uint64_t zaddress, int maxh)
+{
+  zaddress |= ((uint64_t)1) << maxh;
+  zaddress >>= hz_index_ctz(zaddress);
+  return zaddress >> 1;
+}
+
+
+// HZ address -> z address (the part of Hz_to_xyz before the deinterleaving)
+static inline uint64_t hz_index_hz_to_z(uint64_t hzaddress, int maxh)
+{
+  uint64_t lastbitmask = ((uint64_t)1) << maxh;
+  uint64_t zaddress = (hzaddress << 1) | 1;
+  int msb = hz_index_msb(zaddress);
+
+  if (msb < maxh)
+    zaddress <<= (maxh - msb);
+
+  return zaddress & (lastbitmask - 1);
+}
+
+
+// bit cnt of the z address belongs to dimension bitPattern[maxh - cnt] (see xyz_to_HZ)
+static void hz_index_masks(const char* bitPattern, int maxh, uint64_t* mask)
+{
+  memset(mask, 0, PIDX_MAX_DIMENSIONS * sizeof(*mask));
+  for (int cnt = 0; cnt < maxh; cnt++)
+  {
+    int bit = bitPattern[maxh - cnt];
+    if (bit >= 0 && bit < PIDX_MAX_DIMENSIONS)
+      mask[bit] |= ((uint64_t)1) << cnt;
+  }
+}
+
+
+static PIDX_return_code hz_index_build_lut(PIDX_hz_index index)
+{
+  if (index->deposit_lut != NULL)
+    return PIDX_success;
+
+  index->deposit_lut = malloc(PIDX_MAX_DIMENSIONS * sizeof(*index->deposit_lut));
+  index->extract_lut = malloc(8 * sizeof(*index->extract_lut));
+  if (index->deposit_lut == NULL || index->extract_lut == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    free(index->deposit_lut);
+    free(index->extract_lut);
+    index->deposit_lut = NULL;
+    index->extract_lut = NULL;
+    return PIDX_err_hz;
+  }
+  memset(index->deposit_lut, 0, PIDX_MAX_DIMENSIONS * sizeof(*index->deposit_lut));
+  memset(index->extract_lut, 0, 8 * sizeof(*index->extract_lut));
+
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    // position in the z address of every bit of the coordinate
+    int position[64];
+    int bits = 0;
+    for (int p = 0; p < 64; p++)
+      if (index->mask[d] & (((uint64_t)1) << p))
+        position[bits++] = p;
+
+    for (int b = 0; b < 8; b++)
+      for (int v = 0; v < 256; v++)
+        for (int t = 0; t < 8; t++)
+        {
+          // bit n of the coordinate (deposit) or of the z address (extract)
+          int n = 8 * b + t;
+          if ((v & (1 << t)) == 0)
+            continue;
+
+          if (n < bits)
+            index->deposit_lut[d][b][v] |= ((uint64_t)1) << position[n];
+
+          if (index->mask[d] & (((uint64_t)1) << n))
+          {
+            // bit n of the z address is bit cnt of the coordinate, cnt being the number of bits of d below n
+            uint64_t below = index->mask[d] & ((((uint64_t)1) << n) - 1);
+            int cnt = 0;
+            for (; below; below &= below - 1)
+              cnt++;
+            index->extract_lut[b][v][d] |= ((uint64_t)1) << cnt;
+          }
+        }
+  }
+
+  return PIDX_success;
+}
+
+
+PIDX_return_code PIDX_hz_index_create(const char* bitPattern, int maxh, PIDX_hz_index* index)
+{
+  if (maxh < 0 || maxh > 63)
+  {
+    fprintf(stderr, "[%s] [%d] Unsupported maxh %d.\n", __FILE__, __LINE__, maxh);
+    return PIDX_err_hz;
+  }
+
+  *index = malloc(sizeof (*(*index)));
+  memset(*index, 0, sizeof (*(*index)));
+
+  (*index)->maxh = maxh;
+  hz_index_masks(bitPattern, maxh, (*index)->mask);
+
+  enum PIDX_hz_index_backend backend = hz_index_cpu_has_bmi2() ? PIDX_hz_index_bmi2 : PIDX_hz_index_lut;
+
+  // PDEP/PEXT are microcoded (slow) on some CPUs, allow to fall back to the tables
+  char* env = getenv("PIDX_HZ_INDEX");
+  if (env != NULL && strcmp(env, "lut") == 0)
+    backend = PIDX_hz_index_lut;
+
+  if (PIDX_hz_index_set_backend(*index, backend) != PIDX_success)
+  {
+    PIDX_hz_index_free(*index);
+    *index = NULL;
+    return PIDX_err_hz;
+  }
+
+  return PIDX_success;
+}
+
+
+PIDX_return_code PIDX_hz_index_acquire(PIDX_hz_index* index, const char* bitPattern, int maxh)
+{
+  uint64_t mask[PIDX_MAX_DIMENSIONS];
+
+  if (*index != NULL && (*index)->maxh == maxh)
+  {
+    hz_index_masks(bitPattern, maxh, mask);
+    if (memcmp(mask, (*index)->mask, sizeof(mask)) == 0)
+      return PIDX_success;
+  }
+
+  if (*index != NULL)
+  {
+    PIDX_hz_index_free(*index);
+    *index = NULL;
+  }
+
+  return PIDX_hz_index_create(bitPattern, maxh, index);
+}
+
+
+PIDX_return_code PIDX_hz_index_set_backend(PIDX_hz_index index, enum PIDX_hz_index_backend backend)
+{
+  if (backend == PIDX_hz_index_bmi2)
+  {
+    if (!hz_index_cpu_has_bmi2())
+      return PIDX_err_unsupported_flags;
+
+    index->backend = PIDX_hz_index_bmi2;
+    return PIDX_success;
+  }
+
+  if (hz_index_build_lut(index) != PIDX_success)
+    return PIDX_err_hz;
+
+  index->backend = PIDX_hz_index_lut;
+  return PIDX_success;
+}
+
+
+const char* PIDX_hz_index_backend_name(PIDX_hz_index index)
+{
+  return (index->backend == PIDX_hz_index_bmi2) ? "bmi2" : "lut";
+}
+
+
+PIDX_return_code PIDX_hz_index_free(PIDX_hz_index index)
+{
+  if (index == NULL)
+    return PIDX_success;
+
+  free(index->deposit_lut);
+  free(index->extract_lut);
+  free(index);
+
+  return PIDX_success;
+}
+
+
+#if PIDX_HZ_INDEX_HAVE_BMI2
+__attribute__((target("bmi2")))
+static uint64_t hz_index_deposit_bmi2(const uint64_t* mask, uint64_t x, uint64_t y, uint64_t z)
+{
+  return _pdep_u64(x, mask[0]) | _pdep_u64(y, mask[1]) | _pdep_u64(z, mask[2]);
+}
+
+
+__attribute__((target("bmi2")))
+static void hz_index_extract_bmi2(const uint64_t* mask, uint64_t zaddress, uint64_t* xyz)
+{
+  xyz[0] = _pext_u64(zaddress, mask[0]);
+  xyz[1] = _pext_u64(zaddress, mask[1]);
+  xyz[2] = _pext_u64(zaddress, mask[2]);
+}
+#endif
+
+
+static inline uint64_t hz_index_deposit_lut(PIDX_hz_index index, int d, uint64_t v)
+{
+  uint64_t zaddress = 0;
+  for (int b = 0; v; b++, v >>= 8)
+    zaddress |= index->deposit_lut[d][b][v & 0xff];
+
+  return zaddress;
+}
+
+
+uint64_t PIDX_hz_index_xyz_to_z(PIDX_hz_index index, uint64_t x, uint64_t y, uint64_t z)
+{
+#if PIDX_HZ_INDEX_HAVE_BMI2
+  if (index->backend == PIDX_hz_index_bmi2)
+    return hz_index_deposit_bmi2(index->mask, x, y, z);
+#endif
+
+  return hz_index_deposit_lut(index, 0, x) | hz_index_deposit_lut(index, 1, y) | hz_index_deposit_lut(index, 2, z);
+}
+
+
+uint64_t PIDX_hz_index_xyz_to_hz(PIDX_hz_index index, uint64_t x, uint64_t y, uint64_t z)
+{
+  return hz_index_z_to_hz(PIDX_hz_index_xyz_to_z(index, x, y, z), index->maxh);
+}
+
+
+void PIDX_hz_index_xyz_to_hz_row(PIDX_hz_index index, uint64_t x, uint64_t y, uint64_t z, uint64_t count, uint64_t* hz)
+{
+  uint64_t mx = index->mask[0];
+  uint64_t zx = PIDX_hz_index_xyz_to_z(index, x, 0, 0);
+  uint64_t zyz = PIDX_hz_index_xyz_to_z(index, 0, y, z);
+
+  for (uint64_t i = 0; i < count; i++)
+  {
+    hz[i] = hz_index_z_to_hz(zx | zyz, index->maxh);
+
+    // adds one to the bits of zx selected by mx, carries propagate through the bits of the other dimensions
+    zx = ((zx | ~mx) + 1) & mx;
+  }
+}
+
+
+void PIDX_hz_index_level_row(PIDX_hz_index index, int level, uint64_t x, uint64_t y, uint64_t z, uint64_t count, uint64_t* hz)
+{
+  // level 0 holds the single sample (0, 0, 0)
+  if (level == 0)
+  {
+    for (uint64_t i = 0; i < count; i++)
+      hz[i] = 0;
+    return;
+  }
+
+  // the samples of the level have bit (maxh - level) of the z address set and the bits below it cleared,
+  // their HZ address is 2^(level - 1) plus the z address bits above that bit
+  int shift = index->maxh - level + 1;
+  uint64_t fixed = (((uint64_t)1) << shift) - 1;
+  uint64_t mx = index->mask[0] & ~fixed;
+  uint64_t zaddress = PIDX_hz_index_xyz_to_z(index, x, y, z);
+  uint64_t zx = zaddress & mx;
+  uint64_t zyz = zaddress & ~mx & ~fixed;
+  uint64_t level_start = ((uint64_t)1) << (level - 1);
+
+  for (uint64_t i = 0; i < count; i++)
+  {
+    hz[i] = level_start + ((zx | zyz) >> shift);
+    zx = ((zx | ~mx) + 1) & mx;
+  }
+}
+
+
+void PIDX_hz_index_hz_to_xyz(PIDX_hz_index index, uint64_t hz, uint64_t* xyz)
+{
+  uint64_t zaddress = hz_index_hz_to_z(hz, index->maxh);
+
+#if PIDX_HZ_INDEX_HAVE_BMI2
+  if (index->backend == PIDX_hz_index_bmi2)
+  {
+    hz_index_extract_bmi2(index->mask, zaddress, xyz);
+    return;
+  }
+#endif
+
+  xyz[0] = 0;
+  xyz[1] = 0;
+  xyz[2] = 0;
+  for (int b = 0; zaddress; b++, zaddress >>= 8)
+  {
+    const uint64_t* e = index->extract_lut[b][zaddress & 0xff];
+    xyz[0] |= e[0];
+    xyz[1] |= e[1];
+    xyz[2] |= e[2];
+  }
+}
@@ -0,0 +1,138 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file PIDX_hz_index.h
+ *
+ * Fast HZ addressing.
+ *
+ * The bitmask of a dataset assigns every bit of the z address to one of the
+ * dimensions. Instead of walking the bitmask bit by bit for every sample (as
+ * xyz_to_HZ and Hz_to_xyz do), the per dimension bit masks are computed once
+ * and the z address is obtained with a bit deposit (xyz -> z) or a bit
+ * extract (z -> xyz). On x86 CPUs with BMI2 the PDEP/PEXT instructions are
+ * used, otherwise byte lookup tables. The backend is selected at runtime and
+ * can be forced with the PIDX_HZ_INDEX environment variable (bmi2 or lut).
+ *
+ */
+
+#ifndef __PIDX_HZ_INDEX_H
+#define __PIDX_HZ_INDEX_H
+
+
+enum PIDX_hz_index_backend {PIDX_hz_index_lut = 0, PIDX_hz_index_bmi2 = 1};
+
+
+struct PIDX_hz_index_struct
+{
+  int maxh;                                         /// Number of bits of the z address (idx->maxh - 1)
+  uint64_t mask[PIDX_MAX_DIMENSIONS];               /// z address bits owned by each of the dimensions
+  enum PIDX_hz_index_backend backend;               /// Backend used for deposit and extract
+
+  uint64_t (*deposit_lut)[8][256];                  /// [dimension][coordinate byte][byte value] -> z address bits
+  uint64_t (*extract_lut)[256][PIDX_MAX_DIMENSIONS];/// [z address byte][byte value][dimension] -> coordinate bits
+};
+typedef struct PIDX_hz_index_struct* PIDX_hz_index;
+
+
+
+/// \brief Builds the HZ addressing tables for a bit pattern
+/// \param bitPattern the bit pattern (bitPattern[i] = RegExBitmaskBit(bitSequence, i))
+/// \param maxh the number of bits of the z address, same as the maxh passed to xyz_to_HZ (usually idx->maxh - 1)
+/// \param index the created HZ index
+/// \return error code
+PIDX_return_code PIDX_hz_index_create(const char* bitPattern, int maxh, PIDX_hz_index* index);
+
+
+
+/// \brief Returns in *index an HZ index matching bitPattern and maxh
+/// An existing index is reused if it was built for the same bit pattern, otherwise it is rebuilt
+/// \param index pointer to the (possibly NULL) cached HZ index
+/// \param bitPattern the bit pattern
+/// \param maxh the number of bits of the z address
+/// \return error code
+PIDX_return_code PIDX_hz_index_acquire(PIDX_hz_index* index, const char* bitPattern, int maxh);
+
+
+
+/// \brief Forces the backend used by the HZ index (used for testing and benchmarking)
+/// \return PIDX_err_unsupported_flags if the backend is not supported by the CPU
+PIDX_return_code PIDX_hz_index_set_backend(PIDX_hz_index index, enum PIDX_hz_index_backend backend);
+
+
+
+/// \brief Returns the name of the backend in use
+const char* PIDX_hz_index_backend_name(PIDX_hz_index index);
+
+
+
+/// \brief Releases the HZ index
+PIDX_return_code PIDX_hz_index_free(PIDX_hz_index index);
+
+
+
+/// \brief z address (interleaved bits, no hierarchy) of a sample
+uint64_t PIDX_hz_index_xyz_to_z(PIDX_hz_index index, uint64_t x, uint64_t y, uint64_t z);
+
+
+
+/// \brief HZ address of a sample, same as xyz_to_HZ(bitPattern, maxh, xyz)
+uint64_t PIDX_hz_index_xyz_to_hz(PIDX_hz_index index, uint64_t x, uint64_t y, uint64_t z);
+
+
+
+/// \brief HZ addresses of count consecutive samples along x starting at (x, y, z)
+/// Only one deposit is done per row, the x part of the z address is advanced with a masked increment
+void PIDX_hz_index_xyz_to_hz_row(PIDX_hz_index index, uint64_t x, uint64_t y, uint64_t z, uint64_t count, uint64_t* hz);
+
+
+
+/// \brief HZ addresses of count consecutive samples of one HZ level along x, starting at (x, y, z)
+/// The samples of a level form a regular lattice (see get_grid), consecutive samples are one lattice step apart in x
+/// \param level HZ level of the samples, (x, y, z) has to be a sample of that level
+void PIDX_hz_index_level_row(PIDX_hz_index index, int level, uint64_t x, uint64_t y, uint64_t z, uint64_t count, uint64_t* hz);
+
+
+
+/// \brief Coordinates of an HZ address, same as Hz_to_xyz(bitPattern, maxh, hz, xyz)
+void PIDX_hz_index_hz_to_xyz(PIDX_hz_index index, uint64_t hz, uint64_t* xyz);
+
+#endif
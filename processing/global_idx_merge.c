@@ -110,6 +110,37 @@ static int max_file_count = 0;
 static int start_time_step = 0;
 static int end_time_step = 0;
 
+// Metadata versions before 6.2 only stored the lower 32 bits of the block offsets and sizes (words 2 and 4 of a block
+// header), 6.2 keeps the upper ones in words 3 and 5
+static int wide_blocks = 1;
+
+// Offset and size of block (block + blocks_per_file * variable) of a binary header
+static uint64_t block_offset(uint32_t* binheader, int block)
+{
+  uint64_t offset = ntohl(binheader[block * 10 + 12]);
+  if (wide_blocks)
+    offset = offset | ((uint64_t) ntohl(binheader[block * 10 + 13]) << 32);
+
+  return offset;
+}
+
+static uint64_t block_size(uint32_t* binheader, int block)
+{
+  uint64_t size = ntohl(binheader[block * 10 + 14]);
+  if (wide_blocks)
+    size = size | ((uint64_t) ntohl(binheader[block * 10 + 15]) << 32);
+
+  return size;
+}
+
+static void set_block(uint32_t* binheader, int block, uint64_t offset, uint64_t size)
+{
+  binheader[block * 10 + 12] = htonl((uint32_t) (offset & 0xFFFFFFFF));
+  binheader[block * 10 + 13] = htonl((uint32_t) (offset >> 32));
+  binheader[block * 10 + 14] = htonl((uint32_t) (size & 0xFFFFFFFF));
+  binheader[block * 10 + 15] = htonl((uint32_t) (size >> 32));
+}
+
 static int get_default_bits_per_datatype(char* type, int* bits);
 static unsigned long long getPowerOf2(int x);
 static int generate_file_name(int blocks_per_file, char* filename_template, int file_number, char* filename, int maxlen) ;
@@ -256,6 +287,14 @@ static int IDX_file_open(const char* filename)
       //fprintf(stderr, "%s", line);
       line[strcspn(line, "\r\n")] = 0;
 
+      if (strcmp(line, "(version)") == 0)
+      {
+        if( fgets(line, sizeof line, fp) == NULL)
+          return (-1);
+        line[strcspn(line, "\r\n")] = 0;
+        wide_blocks = !(strcmp(line, "6") == 0 || strcmp(line, "6.1") == 0);
+      }
+
       if (strcmp(line, "(box)") == 0)
       {
         if( fgets(line, sizeof line, fp) == NULL)
@@ -813,16 +852,15 @@ int main(int argc, char **argv)
               off_t data_offset = 0;
               for (bpf = 0; bpf < shared_block_count; bpf++)
               {
-                data_offset = ntohl(read_binheader[ic][(bpf + var * blocks_per_file)*10 + 12]);
-                data_size = ntohl(read_binheader[ic][(bpf + var * blocks_per_file)*10 + 14]);
-                fprintf(stderr, "[%s] [Partition %d Block %d Variable %d] --> Offset %d Count %d\n", partition_file_name, ic, bpf, var, (int)data_offset, (int)data_size);
+                data_offset = block_offset(read_binheader[ic], bpf + var * blocks_per_file);
+                data_size = block_size(read_binheader[ic], bpf + var * blocks_per_file);
+                fprintf(stderr, "[%s] [Partition %d Block %d Variable %d] --> Offset %lld Count %lld\n", partition_file_name, ic, bpf, var, (long long)data_offset, (long long)data_size);
 
                 if (data_offset != 0 && data_size != 0)
                 {
                   pread(fd, read_data_buffer[ic] + (bpf * samples_per_block * (bpv[var] / 8)), data_size, data_offset);
 
-                  write_binheader[((bpf + var * blocks_per_file)*10 + 12)] = htonl(write_binheader_length + (bpf * data_size) + var * shared_block_count);
-                  write_binheader[((bpf + var * blocks_per_file)*10 + 14)] = htonl(data_size);
+                  set_block(write_binheader, bpf + var * blocks_per_file, write_binheader_length + ((uint64_t) bpf * data_size) + var * shared_block_count, data_size);
 
                   // Merge happening while the shared block is being read
                   // Hardcoded stupid merge
@@ -108,6 +108,37 @@ static PIDX_block_layout* local_block_layout_shared_files;
 static PIDX_block_layout global_block_layout_file_zero;
 static PIDX_block_layout* local_block_layout_file_zero;
 
+// Metadata versions before 6.2 only stored the lower 32 bits of the block offsets and sizes (words 2 and 4 of a block
+// header), 6.2 keeps the upper ones in words 3 and 5
+static int wide_blocks = 1;
+
+// Offset and size of block (block + blocks_per_file * variable) of a binary header
+static uint64_t block_offset(uint32_t* binheader, int block)
+{
+  uint64_t offset = ntohl(binheader[block * 10 + 12]);
+  if (wide_blocks)
+    offset = offset | ((uint64_t) ntohl(binheader[block * 10 + 13]) << 32);
+
+  return offset;
+}
+
+static uint64_t block_size(uint32_t* binheader, int block)
+{
+  uint64_t size = ntohl(binheader[block * 10 + 14]);
+  if (wide_blocks)
+    size = size | ((uint64_t) ntohl(binheader[block * 10 + 15]) << 32);
+
+  return size;
+}
+
+static void set_block(uint32_t* binheader, int block, uint64_t offset, uint64_t size)
+{
+  binheader[block * 10 + 12] = htonl((uint32_t) (offset & 0xFFFFFFFF));
+  binheader[block * 10 + 13] = htonl((uint32_t) (offset >> 32));
+  binheader[block * 10 + 14] = htonl((uint32_t) (size & 0xFFFFFFFF));
+  binheader[block * 10 + 15] = htonl((uint32_t) (size >> 32));
+}
+
 
 static char *usage = "Serial Usage: ./checkpoint -g 32x32x32 -l 32x32x32 -v 3 -t 16 -f output_idx_file_name\n"
                      "Parallel Usage: mpirun -n 8 ./checkpoint -g 32x32x32 -l 16x16x16 -f output_idx_file_name -v 3 -t 16\n"
@@ -250,6 +281,14 @@ static PIDX_return_code IDX_file_open(const char* filename)
       //fprintf(stderr, "%s", line);
       line[strcspn(line, "\r\n")] = 0;
 
+      if (strcmp(line, "(version)") == 0)
+      {
+        if( fgets(line, sizeof line, fp) == NULL)
+          return PIDX_err_file;
+        line[strcspn(line, "\r\n")] = 0;
+        wide_blocks = !(strcmp(line, "6") == 0 || strcmp(line, "6.1") == 0);
+      }
+
       if (strcmp(line, "(box)") == 0)
       {
         if( fgets(line, sizeof line, fp) == NULL)
@@ -697,12 +736,12 @@ int main(int argc, char **argv)
           file_initialize_time_step(ts, output_file_name, output_file_template);
           generate_file_name(blocks_per_file, output_file_template, fc, new_file_name, PATH_MAX);
 
-          int* block_header_offset = malloc(idx_count[0] * idx_count[1] * idx_count[2] * sizeof(int));
-          memset(block_header_offset, 0, idx_count[0] * idx_count[1] * idx_count[2] * sizeof(int));
+          uint64_t* block_header_offset = malloc(idx_count[0] * idx_count[1] * idx_count[2] * sizeof(*block_header_offset));
+          memset(block_header_offset, 0, idx_count[0] * idx_count[1] * idx_count[2] * sizeof(*block_header_offset));
 
 
-          int** block_header_block_offset = malloc(idx_count[0] * idx_count[1] * idx_count[2] * sizeof(int*));
-          memset(block_header_block_offset, 0, idx_count[0] * idx_count[1] * idx_count[2] * sizeof(int*));
+          uint64_t** block_header_block_offset = malloc(idx_count[0] * idx_count[1] * idx_count[2] * sizeof(*block_header_block_offset));
+          memset(block_header_block_offset, 0, idx_count[0] * idx_count[1] * idx_count[2] * sizeof(*block_header_block_offset));
 
           size_t totl_data_size = 0;
           off_t totl_data_offset = 0;
@@ -726,11 +765,11 @@ int main(int argc, char **argv)
             {
               // file exists
               uint32_t* read_binheader;
-              uint32_t adjusted_offset;
+              uint64_t adjusted_offset;
               int read_binheader_count;
 
-              block_header_block_offset[ic] = malloc(blocks_per_file * sizeof(int));
-              memset(block_header_block_offset[ic], 0, blocks_per_file * sizeof(int));
+              block_header_block_offset[ic] = malloc(blocks_per_file * sizeof(*block_header_block_offset[ic]));
+              memset(block_header_block_offset[ic], 0, blocks_per_file * sizeof(*block_header_block_offset[ic]));
 
               read_binheader_count = 10 + 10 * blocks_per_file * variable_count;
               read_binheader = (uint32_t*) malloc(sizeof (*read_binheader)*(read_binheader_count));
@@ -764,15 +803,15 @@ int main(int argc, char **argv)
               int read_block_counter = 0;
 
               int prev_ic = 0;
-              int previous_block_offset = 0;
+              uint64_t previous_block_offset = 0;
               for (prev_ic = 0; prev_ic < ic; prev_ic++)
                 previous_block_offset = previous_block_offset + block_header_offset[prev_ic];
 
               for (bpf = 0; bpf < blocks_per_file; bpf++)
               {
-                data_offset = ntohl(read_binheader[(bpf + var * blocks_per_file)*10 + 12]);
-                data_size = ntohl(read_binheader[(bpf + var * blocks_per_file)*10 + 14]);
-                fprintf(stderr, "[%s] [%d %d %d] --> %d %d\n", partition_file_name, bpf, var, blocks_per_file, (int)data_offset, (int)data_size);
+                data_offset = block_offset(read_binheader, bpf + var * blocks_per_file);
+                data_size = block_size(read_binheader, bpf + var * blocks_per_file);
+                fprintf(stderr, "[%s] [%d %d %d] --> %lld %lld\n", partition_file_name, bpf, var, blocks_per_file, (long long)data_offset, (long long)data_size);
 
                 if (data_offset != 0 && data_size != 0)
                 {
@@ -781,10 +820,9 @@ int main(int argc, char **argv)
 
                   adjusted_offset = data_offset + previous_block_offset;
 
-                  write_binheader[((bpf + var * blocks_per_file)*10 + 12)] = htonl(adjusted_offset);
-                  write_binheader[((bpf + var * blocks_per_file)*10 + 14)] = htonl(data_size);
+                  set_block(write_binheader, bpf + var * blocks_per_file, adjusted_offset, data_size);
 
-                  fprintf(stderr, "IC %d RBC %d WBC %d RO %d WO %d AO %d [%d + %d]\n", ic, read_block_counter, write_block_counter, (read_block_counter * (int)pow(2, bits_per_block) * (bpv[var] / 8)), (write_block_counter * (int)pow(2, bits_per_block) * (bpv[var] / 8)), adjusted_offset, (int)data_offset, previous_block_offset);
+                  fprintf(stderr, "IC %d RBC %d WBC %d RO %d WO %d AO %lld [%lld + %lld]\n", ic, read_block_counter, write_block_counter, (read_block_counter * (int)pow(2, bits_per_block) * (bpv[var] / 8)), (write_block_counter * (int)pow(2, bits_per_block) * (bpv[var] / 8)), (long long)adjusted_offset, (long long)data_offset, (long long)previous_block_offset);
                   memcpy(write_data_buffer + (write_block_counter * (int)pow(2, bits_per_block) * (bpv[var] / 8)), read_data_buffer + (read_block_counter * (int)pow(2, bits_per_block) * (bpv[var] / 8)), (int)pow(2, bits_per_block) * (bpv[var] / 8));
 
                   read_block_counter++;
@@ -838,7 +876,7 @@ int main(int argc, char **argv)
             // file doesn't exist
             int fd;
             fd = open(new_file_name, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
-            fprintf(stderr, "Write File %s Offset %d Count %d\n", new_file_name, (int)first_offset, (int)totl_data_size);
+            fprintf(stderr, "Write File %s Offset %lld Count %lld\n", new_file_name, (long long)first_offset, (long long)totl_data_size);
 
             pwrite(fd, write_binheader, sizeof (*write_binheader)*(write_binheader_count), 0);
             pwrite(fd, write_data_buffer, totl_data_size, first_offset);
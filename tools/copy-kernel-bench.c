@@ -0,0 +1,194 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file copy-kernel-bench.c
+ *
+ * Microbenchmark of the element copy kernels (PIDX_copy_kernel): for every
+ * specialized element size compares the strided copy, the scatter (HZ
+ * encoding) and the gather (HZ decoding) against the generic memcpy per
+ * element path, and checks that both produce the same bytes.
+ *
+ * Usage: ./copykernelbench -n 4194304 -r 3
+ *
+ */
+
+#include <unistd.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <PIDX.h>
+
+static uint64_t count = 4194304;
+static int repetitions = 3;
+
+static char *usage = "Usage: ./copykernelbench -n 4194304 -r 3\n"
+                     "  -n: number of elements copied\n"
+                     "  -r: number of repetitions (the best time is reported)\n";
+
+enum bench_kind {bench_strided, bench_scatter, bench_gather};
+
+static void parse_args(int argc, char **argv);
+static double bench(PIDX_copy_kernel kernel, enum bench_kind kind, uint64_t element_size, unsigned char* dst, const unsigned char* src, const uint64_t* index);
+
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  parse_args(argc, argv);
+
+  // Source stride of the strided copy (deinterleaving of a 3 component sample, as in the chunking)
+  const uint64_t src_stride = 3;
+  const uint64_t element_sizes[] = {1, 2, 4, 8, 12, 24};
+  const uint64_t max_element_size = 24;
+
+  unsigned char* src = malloc(count * src_stride * max_element_size);
+  unsigned char* dst_ref = malloc(count * src_stride * max_element_size);
+  unsigned char* dst = malloc(count * src_stride * max_element_size);
+  for (uint64_t i = 0; i < count * src_stride * max_element_size; i++)
+    src[i] = (unsigned char)(i * 2654435761u >> 13);
+
+  // Scatter/gather indices: a permutation that keeps short increasing runs, like the HZ indices of a row of a level
+  uint64_t* index = malloc(count * sizeof(*index));
+  for (uint64_t i = 0; i < count; i++)
+    index[i] = i;
+  srand(1);
+  for (uint64_t i = 0; i + 8 <= count; i += 8)
+  {
+    uint64_t j = ((uint64_t)rand() % (count / 8)) * 8;
+    for (int l = 0; l < 8; l++)
+    {
+      uint64_t t = index[i + l];
+      index[i + l] = index[j + l];
+      index[j + l] = t;
+    }
+  }
+
+  const char* kind_name[3] = {"strided", "scatter", "gather"};
+  int ret = 0;
+
+  printf("%" PRIu64 " elements\n", count);
+  for (uint64_t e = 0; e < sizeof(element_sizes) / sizeof(element_sizes[0]); e++)
+  {
+    uint64_t element_size = element_sizes[e];
+    PIDX_copy_kernel generic = PIDX_copy_kernel_generic();
+    PIDX_copy_kernel kernel = PIDX_copy_kernel_get(element_size);
+
+    for (int k = 0; k < 3; k++)
+    {
+      memset(dst_ref, 0, count * src_stride * max_element_size);
+      memset(dst, 0, count * src_stride * max_element_size);
+
+      double generic_time = bench(generic, k, element_size, dst_ref, src, index);
+      double kernel_time = bench(kernel, k, element_size, dst, src, index);
+
+      int match = memcmp(dst, dst_ref, count * src_stride * max_element_size) == 0;
+      if (!match)
+        ret = 1;
+
+      printf("size %2" PRIu64 " %-8s memcpy %8.4f s  kernel %-6s %8.4f s (%5.1fx) %s\n", element_size, kind_name[k],
+             generic_time, kernel->name, kernel_time, generic_time / kernel_time, match ? "" : "MISMATCH");
+    }
+  }
+
+  free(index);
+  free(dst);
+  free(dst_ref);
+  free(src);
+
+  printf("%s\n", ret == 0 ? "results match" : "RESULTS DIFFER");
+
+  MPI_Finalize();
+  return ret;
+}
+
+
+static void parse_args(int argc, char **argv)
+{
+  char flags[] = "n:r:";
+  int one_opt = 0;
+
+  while ((one_opt = getopt(argc, argv, flags)) != EOF)
+  {
+    switch (one_opt)
+    {
+    case('n'):
+      if (sscanf(optarg, "%" SCNu64, &count) != 1 || count < 8)
+      {
+        fprintf(stderr, "Invalid element count\n%s", usage);
+        exit(1);
+      }
+      break;
+
+    case('r'):
+      if (sscanf(optarg, "%d", &repetitions) != 1 || repetitions < 1)
+      {
+        fprintf(stderr, "Invalid repetition count\n%s", usage);
+        exit(1);
+      }
+      break;
+
+    default:
+      fprintf(stderr, "Wrong arguments\n%s", usage);
+      exit(1);
+    }
+  }
+}
+
+
+static double bench(PIDX_copy_kernel kernel, enum bench_kind kind, uint64_t element_size, unsigned char* dst, const unsigned char* src, const uint64_t* index)
+{
+  double best = 0;
+  for (int r = 0; r < repetitions; r++)
+  {
+    double start = PIDX_get_time();
+    if (kind == bench_strided)
+      kernel->strided(dst, 1, src, 3, count, element_size);
+    else if (kind == bench_scatter)
+      kernel->scatter(dst, index, 0, src, 1, count, element_size);
+    else
+      kernel->gather(dst, 1, src, index, 0, count, element_size);
+    double time = PIDX_get_time() - start;
+    if (r == 0 || time < best)
+      best = time;
+  }
+  return best;
+}
@@ -0,0 +1,324 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file hz-index-bench.c
+ *
+ * Microbenchmark of the HZ addressing: compares the per bit loops
+ * (xyz_to_HZ / Hz_to_xyz) against the table driven and the BMI2 (PDEP/PEXT)
+ * backends of PIDX_hz_index, and checks that all of them agree.
+ *
+ * Usage: ./hzindexbench -g 256x256x256 -r 3
+ *
+ */
+
+#include <unistd.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <PIDX.h>
+
+static uint64_t dims[3] = {256, 256, 256};
+static int repetitions = 3;
+static char bitSequence[512];
+static char bitPattern[512];
+static int maxh = 0;
+
+static char *usage = "Usage: ./hzindexbench -g 256x256x256 -r 3\n"
+                     "  -g: dimensions of the box that is encoded\n"
+                     "  -r: number of repetitions (the best time is reported)\n";
+
+static void parse_args(int argc, char **argv);
+static double bench_legacy_encode(uint64_t* checksum);
+static double bench_legacy_decode(uint64_t* checksum);
+static double bench_encode(PIDX_hz_index index, uint64_t* checksum);
+static double bench_encode_row(PIDX_hz_index index, uint64_t* checksum);
+static double bench_decode(PIDX_hz_index index, uint64_t* checksum);
+static int verify(PIDX_hz_index index);
+
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+
+  parse_args(argc, argv);
+
+  Point3D box;
+  box.x = (int)dims[0];
+  box.y = (int)dims[1];
+  box.z = (int)dims[2];
+  GuessBitmaskPattern(bitSequence, box);
+  maxh = strlen(bitSequence);
+  for (int i = 0; i <= maxh; i++)
+    bitPattern[i] = RegExBitmaskBit(bitSequence, i);
+
+  uint64_t samples = dims[0] * dims[1] * dims[2];
+  printf("box %" PRIu64 "x%" PRIu64 "x%" PRIu64 " bitsequence %s (%" PRIu64 " samples)\n", dims[0], dims[1], dims[2], bitSequence, samples);
+
+  uint64_t ref_encode = 0, ref_decode = 0, checksum = 0;
+  double legacy_encode = bench_legacy_encode(&ref_encode);
+  double legacy_decode = bench_legacy_decode(&ref_decode);
+  printf("%-12s encode %8.4f s (%7.1f Msamples/s)          decode %8.4f s\n", "loop", legacy_encode, samples / legacy_encode / 1e6, legacy_decode);
+
+  PIDX_hz_index index;
+  if (PIDX_hz_index_create(bitPattern, maxh - 1, &index) != PIDX_success)
+  {
+    fprintf(stderr, "PIDX_hz_index_create failed\n");
+    MPI_Abort(MPI_COMM_WORLD, -1);
+  }
+
+  int ret = 0;
+  enum PIDX_hz_index_backend backends[2] = {PIDX_hz_index_lut, PIDX_hz_index_bmi2};
+  for (int b = 0; b < 2; b++)
+  {
+    if (PIDX_hz_index_set_backend(index, backends[b]) != PIDX_success)
+    {
+      printf("%-12s not supported by this CPU\n", backends[b] == PIDX_hz_index_bmi2 ? "bmi2" : "lut");
+      continue;
+    }
+
+    if (verify(index) != 0)
+      ret = 1;
+
+    double encode = bench_encode(index, &checksum);
+    if (checksum != ref_encode)
+      ret = 1;
+
+    double encode_row = bench_encode_row(index, &checksum);
+    if (checksum != ref_encode)
+      ret = 1;
+
+    double decode = bench_decode(index, &checksum);
+    if (checksum != ref_decode)
+      ret = 1;
+
+    printf("%-12s encode %8.4f s (%5.1fx) row %8.4f s (%5.1fx) decode %8.4f s (%5.1fx)\n", PIDX_hz_index_backend_name(index),
+           encode, legacy_encode / encode, encode_row, legacy_encode / encode_row, decode, legacy_decode / decode);
+  }
+
+  PIDX_hz_index_free(index);
+
+  printf("%s\n", ret == 0 ? "results match" : "RESULTS DIFFER");
+
+  MPI_Finalize();
+  return ret;
+}
+
+
+static void parse_args(int argc, char **argv)
+{
+  char flags[] = "g:r:";
+  int one_opt = 0;
+
+  while ((one_opt = getopt(argc, argv, flags)) != EOF)
+  {
+    switch (one_opt)
+    {
+    case('g'):
+      if ((sscanf(optarg, "%" SCNu64 "x%" SCNu64 "x%" SCNu64, &dims[0], &dims[1], &dims[2]) != 3) || dims[0] < 1 || dims[1] < 1 || dims[2] < 1)
+      {
+        fprintf(stderr, "Invalid dimensions\n%s", usage);
+        exit(1);
+      }
+      break;
+
+    case('r'):
+      if (sscanf(optarg, "%d", &repetitions) != 1 || repetitions < 1)
+      {
+        fprintf(stderr, "Invalid repetition count\n%s", usage);
+        exit(1);
+      }
+      break;
+
+    default:
+      fprintf(stderr, "Wrong arguments\n%s", usage);
+      exit(1);
+    }
+  }
+}
+
+
+// The checksums are accumulated so that the compiler can not drop the loops
+static double bench_legacy_encode(uint64_t* checksum)
+{
+  double best = 0;
+  for (int r = 0; r < repetitions; r++)
+  {
+    uint64_t sum = 0;
+    double start = PIDX_get_time();
+    for (uint64_t k = 0; k < dims[2]; k++)
+      for (uint64_t j = 0; j < dims[1]; j++)
+        for (uint64_t i = 0; i < dims[0]; i++)
+        {
+          Point3D p;
+          p.x = i;
+          p.y = j;
+          p.z = k;
+          sum += xyz_to_HZ(bitPattern, maxh - 1, p);
+        }
+    double time = PIDX_get_time() - start;
+    if (r == 0 || time < best)
+      best = time;
+    *checksum = sum;
+  }
+  return best;
+}
+
+
+static double bench_legacy_decode(uint64_t* checksum)
+{
+  double best = 0;
+  uint64_t samples = dims[0] * dims[1] * dims[2];
+  for (int r = 0; r < repetitions; r++)
+  {
+    uint64_t sum = 0;
+    uint64_t xyz[PIDX_MAX_DIMENSIONS];
+    double start = PIDX_get_time();
+    for (uint64_t hz = 0; hz < samples; hz++)
+    {
+      Hz_to_xyz(bitPattern, maxh - 1, hz, xyz);
+      sum += xyz[0] + (xyz[1] << 20) + (xyz[2] << 40);
+    }
+    double time = PIDX_get_time() - start;
+    if (r == 0 || time < best)
+      best = time;
+    *checksum = sum;
+  }
+  return best;
+}
+
+
+static double bench_encode(PIDX_hz_index index, uint64_t* checksum)
+{
+  double best = 0;
+  for (int r = 0; r < repetitions; r++)
+  {
+    uint64_t sum = 0;
+    double start = PIDX_get_time();
+    for (uint64_t k = 0; k < dims[2]; k++)
+      for (uint64_t j = 0; j < dims[1]; j++)
+        for (uint64_t i = 0; i < dims[0]; i++)
+          sum += PIDX_hz_index_xyz_to_hz(index, i, j, k);
+    double time = PIDX_get_time() - start;
+    if (r == 0 || time < best)
+      best = time;
+    *checksum = sum;
+  }
+  return best;
+}
+
+
+static double bench_encode_row(PIDX_hz_index index, uint64_t* checksum)
+{
+  double best = 0;
+  uint64_t *row = malloc(dims[0] * sizeof(*row));
+  for (int r = 0; r < repetitions; r++)
+  {
+    uint64_t sum = 0;
+    double start = PIDX_get_time();
+    for (uint64_t k = 0; k < dims[2]; k++)
+      for (uint64_t j = 0; j < dims[1]; j++)
+      {
+        PIDX_hz_index_xyz_to_hz_row(index, 0, j, k, dims[0], row);
+        for (uint64_t i = 0; i < dims[0]; i++)
+          sum += row[i];
+      }
+    double time = PIDX_get_time() - start;
+    if (r == 0 || time < best)
+      best = time;
+    *checksum = sum;
+  }
+  free(row);
+  return best;
+}
+
+
+static double bench_decode(PIDX_hz_index index, uint64_t* checksum)
+{
+  double best = 0;
+  uint64_t samples = dims[0] * dims[1] * dims[2];
+  for (int r = 0; r < repetitions; r++)
+  {
+    uint64_t sum = 0;
+    uint64_t xyz[PIDX_MAX_DIMENSIONS];
+    double start = PIDX_get_time();
+    for (uint64_t hz = 0; hz < samples; hz++)
+    {
+      PIDX_hz_index_hz_to_xyz(index, hz, xyz);
+      sum += xyz[0] + (xyz[1] << 20) + (xyz[2] << 40);
+    }
+    double time = PIDX_get_time() - start;
+    if (r == 0 || time < best)
+      best = time;
+    *checksum = sum;
+  }
+  return best;
+}
+
+
+// Sample by sample comparison against the per bit loops
+static int verify(PIDX_hz_index index)
+{
+  uint64_t errors = 0;
+  uint64_t xyz[PIDX_MAX_DIMENSIONS], ref[PIDX_MAX_DIMENSIONS];
+
+  for (uint64_t k = 0; k < dims[2]; k++)
+    for (uint64_t j = 0; j < dims[1]; j++)
+      for (uint64_t i = 0; i < dims[0]; i++)
+      {
+        Point3D p;
+        p.x = i;
+        p.y = j;
+        p.z = k;
+        uint64_t hz = xyz_to_HZ(bitPattern, maxh - 1, p);
+        if (PIDX_hz_index_xyz_to_hz(index, i, j, k) != hz)
+          errors++;
+
+        Hz_to_xyz(bitPattern, maxh - 1, hz, ref);
+        PIDX_hz_index_hz_to_xyz(index, hz, xyz);
+        if (xyz[0] != ref[0] || xyz[1] != ref[1] || xyz[2] != ref[2])
+          errors++;
+      }
+
+  if (errors != 0)
+    fprintf(stderr, "[%s] %" PRIu64 " mismatches\n", PIDX_hz_index_backend_name(index), errors);
+
+  return errors != 0;
+}
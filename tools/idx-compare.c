@@ -66,6 +66,18 @@
  *
  */
 
+// Offset and size of block (block + blocks_per_file * variable) of a binary header. The upper halves (words 3 and 5
+// of the block header) are kept since metadata version 6.2, the files of the earlier versions have them zeroed.
+static uint64_t block_offset(uint32_t* binheader, int block)
+{
+  return ((uint64_t) ntohl(binheader[block * 10 + 13]) << 32) | ntohl(binheader[block * 10 + 12]);
+}
+
+static uint64_t block_size(uint32_t* binheader, int block)
+{
+  return ((uint64_t) ntohl(binheader[block * 10 + 15]) << 32) | ntohl(binheader[block * 10 + 14]);
+}
+
 int main(int argc, char **argv) 
 {
   int i, j, var;
@@ -131,14 +143,14 @@ int main(int argc, char **argv)
   {
     for (j = 0 ; j < blocks_per_file; j++)
     {
-      data_length1 = ntohl(binheader1[(j + blocks_per_file * var) * 10 + 14]);
-      data_offset1 = ntohl(binheader1[(j + blocks_per_file * var) * 10 + 12]);
+      data_length1 = block_size(binheader1, j + blocks_per_file * var);
+      data_offset1 = block_offset(binheader1, j + blocks_per_file * var);
       data_buffer1 = (double*)malloc(data_length1);
       memset(data_buffer1, 0, data_length1);
       assert(data_buffer1 != NULL);
       
-      data_length2 = ntohl(binheader2[(j + blocks_per_file * var) * 10 + 14]);
-      data_offset2 = ntohl(binheader2[(j + blocks_per_file * var) * 10 + 12]);
+      data_length2 = block_size(binheader2, j + blocks_per_file * var);
+      data_offset2 = block_offset(binheader2, j + blocks_per_file * var);
       data_buffer2 = (double*)malloc(data_length2);
       memset(data_buffer2, 0, data_length2);
       assert(data_buffer2 != NULL);
@@ -65,6 +65,18 @@
  *
  */
 
+// Offset and size of block (block + blocks_per_file * variable) of a binary header. The upper halves (words 3 and 5
+// of the block header) are kept since metadata version 6.2, the files of the earlier versions have them zeroed.
+static uint64_t block_offset(uint32_t* binheader, int block)
+{
+  return ((uint64_t) ntohl(binheader[block * 10 + 13]) << 32) | ntohl(binheader[block * 10 + 12]);
+}
+
+static uint64_t block_size(uint32_t* binheader, int block)
+{
+  return ((uint64_t) ntohl(binheader[block * 10 + 15]) << 32) | ntohl(binheader[block * 10 + 14]);
+}
+
 int main(int argc, char **argv) 
 {
   int j, var;
@@ -108,8 +120,8 @@ int main(int argc, char **argv)
     {
       data_length1 = 0;
       data_offset1 = 0;
-      data_length1 = ntohl(binheader1[(j + blocks_per_file * var) * 10 + 14]);
-      data_offset1 = ntohl(binheader1[(j + blocks_per_file * var) * 10 + 12]);
+      data_length1 = block_size(binheader1, j + blocks_per_file * var);
+      data_offset1 = block_offset(binheader1, j + blocks_per_file * var);
       fprintf(stderr, "[%d] Block %d: Offset %lld Count %lld\n", var, j, (unsigned long long)data_offset1, (unsigned long long)data_length1);
 
       double *data_buffer = malloc(data_length1);
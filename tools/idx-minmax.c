@@ -274,6 +274,10 @@ static void set_pidx_file(int ts)
   ret = PIDX_file_open(output_file_name, PIDX_MODE_RDONLY, p_access, global_bounds, &file);
   if (ret != PIDX_success)  terminate_with_error_msg("PIDX_file_create");
 
+  // the whole box is scanned, the binary files are read from their mapped pages
+  PIDX_set_io_backend(file, PIDX_MMAP_IO_BACKEND);
+  PIDX_set_read_access_pattern(file, PIDX_READ_ACCESS_SEQUENTIAL);
+
   PIDX_set_point(global_size, global_box_size[X], global_box_size[Y], global_box_size[Z]);
 
   int last_ts;
@@ -86,6 +86,29 @@ static int compression_block_size[PIDX_MAX_DIMENSIONS] = {1, 1, 1, 1, 1};
 static int compression_bit_rate = 0;
 static int compression_type = 0;
 
+// Metadata versions before 6.2 only stored the lower 32 bits of the block offsets and sizes (words 2 and 4 of a block
+// header), 6.2 keeps the upper ones in words 3 and 5
+static int wide_blocks = 1;
+
+// Offset and size of block (block + blocks_per_file * variable) of a binary header
+static uint64_t block_offset(uint32_t* binheader, int block)
+{
+  uint64_t offset = ntohl(binheader[block * 10 + 12]);
+  if (wide_blocks)
+    offset = offset | ((uint64_t) ntohl(binheader[block * 10 + 13]) << 32);
+
+  return offset;
+}
+
+static uint64_t block_size(uint32_t* binheader, int block)
+{
+  uint64_t size = ntohl(binheader[block * 10 + 14]);
+  if (wide_blocks)
+    size = size | ((uint64_t) ntohl(binheader[block * 10 + 15]) << 32);
+
+  return size;
+}
+
 //static void revstr(char* str);
 //static void GuessBitmaskPattern(char* _bits, PointND dims);
 static int generate_file_name_template(int maxh, int bits_per_block, char* filename, int current_time_step, char* filename_template);
@@ -202,6 +225,8 @@ int main(int argc, char **argv)
     {
       if ( fgets(line, sizeof line, fp) == NULL)
         return 0;
+      line[strcspn(line, "\r\n")] = 0;
+      wide_blocks = !(strcmp(line, "6") == 0 || strcmp(line, "6.1") == 0);
     }
 
     if (strcmp(line, "(box)") == 0)
@@ -589,8 +614,8 @@ int main(int argc, char **argv)
           {
             if (is_block_present((bpf + (blocks_per_file * fi)), global_block_layout))
             {
-              data_offset = ntohl(binheader[(bpf + var * blocks_per_file)*10 + 12]);
-              data_size = ntohl(binheader[(bpf + var * blocks_per_file)*10 + 14]);
+              data_offset = block_offset(binheader, bpf + var * blocks_per_file);
+              data_size = block_size(binheader, bpf + var * blocks_per_file);
 
               fprintf(stderr, "[F %d %s] [V %d] [B %d] Offset %lld Count %ld\n", fi, bin_file, var, bpf, (long long)data_offset, (long)data_size);
 